@@ -13,6 +13,21 @@ extern "C" {
 #include <stdint.h>
 #include <stdio.h>
 
+/* engine instance
+*  all functions below act on the engine selected by the calling thread, the default engine without
+*  selection, so the existing single engine applications are not changed, independent engines (e.g.
+*  the reprocessing of time shards of an archive) run in parallel threads of one process, one thread
+*  (with its ingestion threads) for each engine at a time, the raw & log files of the engines have
+*  the same names (the time of the start), turn them off for parallel engines
+*/
+typedef struct engine_s engine_t;
+/* new engine with the default options, NULL: no memory */
+GNSSCORE_API engine_t* engine_new();
+/* free the engine (system_exit and the network), the default engine is not freed */
+GNSSCORE_API void engine_free(engine_t* engine);
+/* select the engine of the calling thread, NULL: default engine, return the previous engine */
+GNSSCORE_API engine_t* engine_select(engine_t* engine);
+
 /* interface to the raw data buffer (rtcm3 MSM) */
 
 /* set the rtcm data buffer to the engine 
@@ -35,6 +50,29 @@ extern "C" {
 */
 /* with base station coordinate */
 GNSSCORE_API int set_rtcm_data_buff(int staid, uint8_t* buffer, int nbyte, double *xyz);
+/* one complete frame with crc checked by the caller (replay of a framed file), the frame is
+*  decoded without the frame scan of the station stream and is not changed, do not mix with
+*  set_rtcm_data_buff for a station, return 1: processed (queued), 0: not processed */
+GNSSCORE_API int set_rtcm_data_frame(int staid, uint8_t* frame, int len, double* xyz);
+
+/* threaded ingestion
+*  nthread>0: the base stations are decoded by nthread worker threads (station index modulo nthread),
+*             set_rtcm_data_buff only queues the bytes of the station and returns the number of bytes
+*             queued (0: queue full, the block is dropped), one caller thread per station,
+*             the epochs are added to the network in get_vrs_rove_buff or flush_rtcm_data_buff,
+*             which must be called from one thread (network engine)
+*  nthread<0: one worker thread per cpu
+*  nthread=0: stop the worker threads, set_rtcm_data_buff decodes the data directly (default)
+*  return the number of worker threads started
+*/
+GNSSCORE_API int set_ingest_thread_option(int nthread);
+
+/* wait until the queued data are decoded and the epochs are added to the network (threaded ingestion) */
+GNSSCORE_API void flush_rtcm_data_buff();
+
+/* number of epochs kept for each base and rove station (default 3), call from the network engine thread
+*  return 1: ok, 0: no memory */
+GNSSCORE_API int set_epoch_depth_option(int depth);
 
 /* add vrs rove data */
 GNSSCORE_API int add_vrs_rover_data(int vrsid, double* xyz);
@@ -51,6 +89,31 @@ GNSSCORE_API int add_vrs_rover_data(int vrsid, double* xyz);
 */
 GNSSCORE_API int get_vrs_rove_buff(int vrsid, uint8_t*buffer);
 
+/* the same rtcm data without copy, the vrs epoch is encoded once and kept until the next epoch
+*  of the network, the other rovers of the same vrs get a copy with their station ID
+*  return the pointer to the data and its nbyte, NULL: unknown rover
+*  the data is not changed by the calls for the other rovers, it is valid until the next epoch of the
+*  network (the vrs is encoded again by the first get_vrs_rove_data/get_vrs_rove_buff/get_vrs_rove_iov
+*  of one of its rovers after the epoch), or until the rover or the network is deleted
+*/
+GNSSCORE_API const uint8_t* get_vrs_rove_data(int vrsid, int* nbyte);
+
+/* one rtcm message of the rover data (scatter/gather output, e.g. for writev), an asynchronous
+*  send (e.g. overlapped WSASend) must complete before the data is changed, see get_vrs_rove_data */
+typedef struct
+{
+	const uint8_t* buff; /* message frame (preamble to crc) */
+	int len; /* bytes of the frame */
+	int type; /* message type */
+}vrs_iov_t;
+
+/* the same rtcm data as the list of its messages (1005, msm frames of each system) in the
+*  vrs cache, no copy, niov: capacity of iov, size: max total bytes (0: no limit)
+*  return the number of messages, 0: no data or unknown rover, -1: the data exceeds niov or size
+*  (nothing returned), the messages are valid as the data of get_vrs_rove_data
+*/
+GNSSCORE_API int get_vrs_rove_iov(int vrsid, vrs_iov_t* iov, int niov, int size);
+
 /* delete rove station using ID */
 GNSSCORE_API void del_vrs_rove_data(int vrsid);
 
@@ -66,9 +129,23 @@ GNSSCORE_API void system_exit();
 /* set the approximate time for post-processing */
 GNSSCORE_API void set_appr_time(int year, int mon, int day, int hour);
 
-/* raw & log data options */
+/* deterministic replay (post-processing), opt=1: the decoder time (week rollover, time of messages
+*  without time) and the local time of the console output come from a virtual gps clock, started
+*  at the approximate time and advanced by the decoded data, instead of the cpu clock, the data
+*  are decoded directly in the order of the calls (no ingestion threads), so the vrs output does
+*  not depend on the host clock or the speed of the replay */
+GNSSCORE_API void set_replay_time_option(int opt);
+
+/* raw & log data options, raw data 1: one file (default), 2: one segment file for each station
+*  (<time>-<staid>.rtcm3) with the index of the frames (<time>.idx, see archive_idx_t in
+*  gnss_archive.h) for the replay of a station or time window */
 GNSSCORE_API void set_raw_data_option(int opt);
 GNSSCORE_API void set_log_data_option(int opt);
+/* the raw & log data are written by a background thread in large batches, the files are flushed
+*  every flush_ms (default 1000) or flush_bytes (default 0), 0: not used, both 0: flush each batch */
+GNSSCORE_API void set_raw_flush_option(int flush_ms, int flush_bytes);
+/* debug, decode the vrs rtcm output again and log the failures (default 0) */
+GNSSCORE_API void set_check_data_option(int opt);
 
 /* system status output */
 GNSSCORE_API void system_status_output(FILE* fout);
@@ -0,0 +1,101 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ sequential bit reader for rtcm3 messages
+ the fields are extracted with shifts and masks from a 64-bit big-endian word
+ loaded at the byte of the cursor, a field of up to 32 bits starting at any bit
+ offset always fits in this word, the result is bit-exact with getbitu/getbits
+*/
+#ifndef _BITSTREAM_H_
+#define _BITSTREAM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#define BS_INLINE static __inline
+#define BS_BSWAP64(x) _byteswap_uint64(x)
+#else
+#define BS_INLINE static inline
+#define BS_BSWAP64(x) __builtin_bswap64(x)
+#endif
+
+#if defined(__BYTE_ORDER__)&&(__BYTE_ORDER__==__ORDER_BIG_ENDIAN__)
+#define BS_BIG_ENDIAN
+#endif
+
+typedef struct
+{
+	const uint8_t* buff; /* byte data */
+	int nbyte;           /* number of readable bytes in buff */
+	int pos;             /* current bit position from start of data */
+}bitstream_t;
+
+/* initialize the cursor at bit position pos, nbyte is the readable size of buff */
+BS_INLINE void bs_init(bitstream_t* bs, const uint8_t* buff, int nbyte, int pos)
+{
+	bs->buff = buff;
+	bs->nbyte = nbyte;
+	bs->pos = pos;
+}
+
+/* 64 bits big-endian from byte k, bytes beyond the readable size are zero */
+BS_INLINE uint64_t bs_load(const bitstream_t* bs, int k)
+{
+	uint64_t w = 0;
+	int i;
+	if (k + 8 <= bs->nbyte)
+	{
+		memcpy(&w, bs->buff + k, 8);
+#ifndef BS_BIG_ENDIAN
+		w = BS_BSWAP64(w);
+#endif
+		return w;
+	}
+	for (i = 0; i < 8; ++i)
+	{
+		w = (w << 8) | (k + i < bs->nbyte ? bs->buff[k + i] : 0);
+	}
+	return w;
+}
+
+/* unsigned bits at bit position pos (len<=32), cursor not moved */
+BS_INLINE uint32_t bs_peeku(const bitstream_t* bs, int pos, int len)
+{
+	if (len <= 0) return 0;
+	return (uint32_t)((bs_load(bs, pos >> 3) << (pos & 7)) >> (64 - len));
+}
+
+/* read unsigned bits and move the cursor (len<=32) */
+BS_INLINE uint32_t bs_getu(bitstream_t* bs, int len)
+{
+	uint32_t bits = bs_peeku(bs, bs->pos, len);
+	bs->pos += len;
+	return bits;
+}
+
+/* read signed bits (two's complement) and move the cursor (len<=32) */
+BS_INLINE int32_t bs_gets(bitstream_t* bs, int len)
+{
+	uint32_t bits = bs_getu(bs, len);
+	if (len <= 0 || 32 <= len || !(bits & (1u << (len - 1)))) return (int32_t)bits;
+	return (int32_t)(bits | (~0u << len)); /* extend sign */
+}
+
+/* skip bits */
+BS_INLINE void bs_skip(bitstream_t* bs, int len)
+{
+	bs->pos += len;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ crc-24q engine shared by all rtcm3 paths
+ three kernels compute the same parity:
+ 1) byte-wise, one lookup in the rtklib table per byte (reference)
+ 2) slicing-by-8, eight bytes per step with 8 tables derived from the byte table
+ 3) carry-less multiply (pclmulqdq), folds 64/16 byte blocks modulo the polynomial
+    and finishes the last block and the tail with slicing-by-8, selected at run time
+    with cpuid
+*/
+#include <string.h>
+
+#include "crc24q.h"
+#include "gnss_thread.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRC24Q_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC24Q_TARGET
+#else
+#include <cpuid.h>
+#define CRC24Q_TARGET __attribute__((target("pclmul,ssse3")))
+#endif
+#endif
+
+#define CRC24Q_POLY     0x1864CFB /* x^24+x^23+x^18+x^17+x^14+x^11+x^10+x^7+x^6+x^5+x^4+x^3+x+1 */
+#define CRC24Q_CLMUL_MIN 64       /* min length for the carry-less multiply kernel */
+
+static const uint32_t tbl_CRC24Q[256]={
+    0x000000,0x864CFB,0x8AD50D,0x0C99F6,0x93E6E1,0x15AA1A,0x1933EC,0x9F7F17,
+    0xA18139,0x27CDC2,0x2B5434,0xAD18CF,0x3267D8,0xB42B23,0xB8B2D5,0x3EFE2E,
+    0xC54E89,0x430272,0x4F9B84,0xC9D77F,0x56A868,0xD0E493,0xDC7D65,0x5A319E,
+    0x64CFB0,0xE2834B,0xEE1ABD,0x685646,0xF72951,0x7165AA,0x7DFC5C,0xFBB0A7,
+    0x0CD1E9,0x8A9D12,0x8604E4,0x00481F,0x9F3708,0x197BF3,0x15E205,0x93AEFE,
+    0xAD50D0,0x2B1C2B,0x2785DD,0xA1C926,0x3EB631,0xB8FACA,0xB4633C,0x322FC7,
+    0xC99F60,0x4FD39B,0x434A6D,0xC50696,0x5A7981,0xDC357A,0xD0AC8C,0x56E077,
+    0x681E59,0xEE52A2,0xE2CB54,0x6487AF,0xFBF8B8,0x7DB443,0x712DB5,0xF7614E,
+    0x19A3D2,0x9FEF29,0x9376DF,0x153A24,0x8A4533,0x0C09C8,0x00903E,0x86DCC5,
+    0xB822EB,0x3E6E10,0x32F7E6,0xB4BB1D,0x2BC40A,0xAD88F1,0xA11107,0x275DFC,
+    0xDCED5B,0x5AA1A0,0x563856,0xD074AD,0x4F0BBA,0xC94741,0xC5DEB7,0x43924C,
+    0x7D6C62,0xFB2099,0xF7B96F,0x71F594,0xEE8A83,0x68C678,0x645F8E,0xE21375,
+    0x15723B,0x933EC0,0x9FA736,0x19EBCD,0x8694DA,0x00D821,0x0C41D7,0x8A0D2C,
+    0xB4F302,0x32BFF9,0x3E260F,0xB86AF4,0x2715E3,0xA15918,0xADC0EE,0x2B8C15,
+    0xD03CB2,0x567049,0x5AE9BF,0xDCA544,0x43DA53,0xC596A8,0xC90F5E,0x4F43A5,
+    0x71BD8B,0xF7F170,0xFB6886,0x7D247D,0xE25B6A,0x641791,0x688E67,0xEEC29C,
+    0x3347A4,0xB50B5F,0xB992A9,0x3FDE52,0xA0A145,0x26EDBE,0x2A7448,0xAC38B3,
+    0x92C69D,0x148A66,0x181390,0x9E5F6B,0x01207C,0x876C87,0x8BF571,0x0DB98A,
+    0xF6092D,0x7045D6,0x7CDC20,0xFA90DB,0x65EFCC,0xE3A337,0xEF3AC1,0x69763A,
+    0x578814,0xD1C4EF,0xDD5D19,0x5B11E2,0xC46EF5,0x42220E,0x4EBBF8,0xC8F703,
+    0x3F964D,0xB9DAB6,0xB54340,0x330FBB,0xAC70AC,0x2A3C57,0x26A5A1,0xA0E95A,
+    0x9E1774,0x185B8F,0x14C279,0x928E82,0x0DF195,0x8BBD6E,0x872498,0x016863,
+    0xFAD8C4,0x7C943F,0x700DC9,0xF64132,0x693E25,0xEF72DE,0xE3EB28,0x65A7D3,
+    0x5B59FD,0xDD1506,0xD18CF0,0x57C00B,0xC8BF1C,0x4EF3E7,0x426A11,0xC426EA,
+    0x2AE476,0xACA88D,0xA0317B,0x267D80,0xB90297,0x3F4E6C,0x33D79A,0xB59B61,
+    0x8B654F,0x0D29B4,0x01B042,0x87FCB9,0x1883AE,0x9ECF55,0x9256A3,0x141A58,
+    0xEFAAFF,0x69E604,0x657FF2,0xE33309,0x7C4C1E,0xFA00E5,0xF69913,0x70D5E8,
+    0x4E2BC6,0xC8673D,0xC4FECB,0x42B230,0xDDCD27,0x5B81DC,0x57182A,0xD154D1,
+    0x26359F,0xA07964,0xACE092,0x2AAC69,0xB5D37E,0x339F85,0x3F0673,0xB94A88,
+    0x87B4A6,0x01F85D,0x0D61AB,0x8B2D50,0x145247,0x921EBC,0x9E874A,0x18CBB1,
+    0xE37B16,0x6537ED,0x69AE1B,0xEFE2E0,0x709DF7,0xF6D10C,0xFA48FA,0x7C0401,
+    0x42FA2F,0xC4B6D4,0xC82F22,0x4E63D9,0xD11CCE,0x575035,0x5BC9C3,0xDD8538
+};
+
+/* tbl_slice[k][b]: parity of byte b followed by k zero bytes */
+static uint32_t tbl_slice[8][256];
+static gnss_once_t slice_once = 0; /* tables built */
+#ifdef CRC24Q_X86
+static int clmul_state = 0; /* 0: no, 1: yes */
+static gnss_once_t clmul_once = 0; /* cpu checked */
+#endif
+static uint64_t k_fold[4]; /* x^192, x^128, x^576, x^512 mod P */
+
+/* x^n mod P */
+static uint64_t xpow_mod(int n)
+{
+    uint32_t r=1;
+    while (n-->0) {
+        r<<=1;
+        if (r&0x1000000) r^=CRC24Q_POLY;
+    }
+    return r;
+}
+/* build the slicing tables and folding constants (once, see init_slice_table) */
+static void build_slice_table(void)
+{
+    uint32_t crc;
+    int i, k;
+    for (i=0;i<256;i++) {
+        tbl_slice[0][i]=crc=tbl_CRC24Q[i];
+        for (k=1;k<8;k++) {
+            crc=((crc<<8)&0xFFFFFF)^tbl_CRC24Q[crc>>16];
+            tbl_slice[k][i]=crc;
+        }
+    }
+    k_fold[0]=xpow_mod(128+64);
+    k_fold[1]=xpow_mod(128);
+    k_fold[2]=xpow_mod(512+64);
+    k_fold[3]=xpow_mod(512);
+}
+static void init_slice_table(void)
+{
+    gnss_once(&slice_once,build_slice_table);
+}
+static uint32_t crc_bytes(uint32_t crc, const uint8_t* buff, int len)
+{
+    int i;
+    for (i=0;i<len;i++) crc=((crc<<8)&0xFFFFFF)^tbl_CRC24Q[(crc>>16)^buff[i]];
+    return crc;
+}
+static uint32_t crc_slice8(uint32_t crc, const uint8_t* buff, int len)
+{
+    /* the 24 bit crc is merged into the first 3 bytes of each 8 byte step */
+    while (len>=8) {
+        crc=tbl_slice[7][buff[0]^(crc>>16)]^tbl_slice[6][buff[1]^((crc>>8)&0xFF)]^
+            tbl_slice[5][buff[2]^(crc&0xFF)]^tbl_slice[4][buff[3]]^
+            tbl_slice[3][buff[4]]^tbl_slice[2][buff[5]]^
+            tbl_slice[1][buff[6]]^tbl_slice[0][buff[7]];
+        buff+=8; len-=8;
+    }
+    return crc_bytes(crc,buff,len);
+}
+#ifdef CRC24Q_X86
+static int check_clmul(void)
+{
+    unsigned int ecx=0;
+#ifdef _MSC_VER
+    int info[4]={0};
+    __cpuid(info,1);
+    ecx=(unsigned int)info[2];
+#else
+    unsigned int eax=0,ebx=0,edx=0;
+    if (!__get_cpuid(1,&eax,&ebx,&ecx,&edx)) return 0;
+#endif
+    return (ecx&(1u<<1))&&(ecx&(1u<<9)); /* pclmulqdq, ssse3 */
+}
+static void init_clmul(void)
+{
+    clmul_state=check_clmul();
+}
+/* fold x (128 bits, most significant first) forward by the distance in k:
+*  x*x^d = x_hi*(x^(d+64) mod P) + x_lo*(x^d mod P) */
+CRC24Q_TARGET static __m128i fold_block(__m128i x, __m128i k)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(x,k,0x11),_mm_clmulepi64_si128(x,k,0x00));
+}
+/* len >= CRC24Q_CLMUL_MIN */
+CRC24Q_TARGET static uint32_t crc_clmul(const uint8_t* buff, int len)
+{
+    const __m128i bswap=_mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    const __m128i k128=_mm_set_epi64x((long long)k_fold[0],(long long)k_fold[1]);
+    const __m128i k512=_mm_set_epi64x((long long)k_fold[2],(long long)k_fold[3]);
+    __m128i x0,x1,x2,x3;
+    uint8_t last[16];
+    
+    /* the folded value is congruent to the message modulo P, so the parity of
+       the last 16 byte block and the tail gives the parity of the message */
+    x0=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff   )),bswap);
+    x1=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff+16)),bswap);
+    x2=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff+32)),bswap);
+    x3=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff+48)),bswap);
+    buff+=64; len-=64;
+    
+    /* four independent lanes, 64 bytes per step */
+    while (len>=64) {
+        x0=_mm_xor_si128(fold_block(x0,k512),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff   )),bswap));
+        x1=_mm_xor_si128(fold_block(x1,k512),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff+16)),bswap));
+        x2=_mm_xor_si128(fold_block(x2,k512),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff+32)),bswap));
+        x3=_mm_xor_si128(fold_block(x3,k512),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(buff+48)),bswap));
+        buff+=64; len-=64;
+    }
+    /* merge the lanes */
+    x1=_mm_xor_si128(x1,fold_block(x0,k128));
+    x2=_mm_xor_si128(x2,fold_block(x1,k128));
+    x3=_mm_xor_si128(x3,fold_block(x2,k128));
+    
+    /* remaining 16 byte blocks */
+    while (len>=16) {
+        x3=_mm_xor_si128(fold_block(x3,k128),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)buff),bswap));
+        buff+=16; len-=16;
+    }
+    _mm_storeu_si128((__m128i*)last,_mm_shuffle_epi8(x3,bswap));
+    return crc_slice8(crc_slice8(0,last,16),buff,len);
+}
+#endif
+extern int crc24q_has_clmul(void)
+{
+#ifdef CRC24Q_X86
+    gnss_once(&clmul_once,init_clmul);
+    return clmul_state;
+#else
+    return 0;
+#endif
+}
+extern const char* crc24q_kernel(void)
+{
+    return crc24q_has_clmul()?"pclmul":"slice8";
+}
+extern uint32_t crc24q_bytewise(const uint8_t* buff, int len)
+{
+    return crc_bytes(0,buff,len);
+}
+extern uint32_t crc24q_slice8(const uint8_t* buff, int len)
+{
+    init_slice_table();
+    return crc_slice8(0,buff,len);
+}
+extern uint32_t crc24q_clmul(const uint8_t* buff, int len)
+{
+    init_slice_table();
+#ifdef CRC24Q_X86
+    if (len>=CRC24Q_CLMUL_MIN&&crc24q_has_clmul()) return crc_clmul(buff,len);
+#endif
+    return crc_slice8(0,buff,len);
+}
+extern uint32_t crc24q_fast(const uint8_t* buff, int len)
+{
+    return crc24q_clmul(buff,len);
+}
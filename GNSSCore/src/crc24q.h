@@ -0,0 +1,36 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ crc-24q engine shared by all rtcm3 paths (decoder, framer, encoder)
+*/
+#ifndef _CRC24Q_H_
+#define _CRC24Q_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+
+#include <stdint.h>
+
+/* crc-24q parity (polynomial 0x1864CFB, init 0, no reflection) using the best
+*  kernel for the cpu (carry-less multiply if available, otherwise slicing-by-8) */
+GNSSCORE_API uint32_t crc24q_fast(const uint8_t* buff, int len);
+
+/* individual kernels, all return the same parity */
+GNSSCORE_API uint32_t crc24q_bytewise(const uint8_t* buff, int len); /* one table lookup per byte (reference) */
+GNSSCORE_API uint32_t crc24q_slice8(const uint8_t* buff, int len);   /* slicing-by-8 tables */
+GNSSCORE_API uint32_t crc24q_clmul(const uint8_t* buff, int len);    /* pclmulqdq folding, slicing-by-8 if not supported */
+
+/* 1: carry-less multiply kernel supported by the cpu */
+GNSSCORE_API int crc24q_has_clmul(void);
+/* name of the kernel selected by crc24q_fast */
+GNSSCORE_API const char* crc24q_kernel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
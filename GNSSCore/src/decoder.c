@@ -46,6 +46,8 @@
 *                           use integer types in stdint.h
 *-----------------------------------------------------------------------------*/
 #include "gnss.h"
+#include "bitstream.h"
+#include "ephemeris.h"
 
 /* function prototypes -------------------------------------------------------*/
 extern int decode_rtcm2(rtcm_t *rtcm, nav_t *nav);
@@ -86,6 +88,19 @@ extern int encode_rtcm3(rtcm_t *rtcm, nav_t *nav, int type, int subtype, int syn
 
 /* from rtcm2.c */
 
+/* current time of the decoder, the virtual clock of the replay or cpu time --*/
+static gtime_t rtcm_now(const rtcm_t *rtcm)
+{
+    return rtcm->vtime.time!=0?rtcm->vtime:utc2gpst(timeget());
+}
+/* adjust gps week number by the current time of the decoder -----------------*/
+static int adjgpsweek_rtcm(const rtcm_t *rtcm, int week)
+{
+    int w;
+    (void)time2gpst(rtcm_now(rtcm),&w);
+    if (w<1560) w=1560; /* use 2009/12/1 if time is earlier than 2009/12/1 */
+    return week+(w-week+1)/1024*1024;
+}
 /* adjust hourly rollover of rtcm 2 time -------------------------------------*/
 static void adjhour(rtcm_t *rtcm, double zcnt)
 {
@@ -93,7 +108,7 @@ static void adjhour(rtcm_t *rtcm, double zcnt)
     int week;
     
     /* if no time, get cpu time */
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tow=time2gpst(rtcm->time,&week);
     hour=floor(tow/3600.0);
     sec=tow-hour*3600.0;
@@ -181,7 +196,7 @@ static int decode_type14(rtcm_t *rtcm)
         trace(2,"rtcm2 14 length error: len=%d\n",rtcm->len);
         return -1;
     }
-    week=adjgpsweek(week);
+    week=adjgpsweek_rtcm(rtcm,week);
     rtcm->time=gpst2time(week,hour*3600.0+zcnt*0.6);
     //rtcm->nav.utc_gps[4]=leaps;
     return 6;
@@ -247,7 +262,7 @@ static int decode_type17(rtcm_t *rtcm, eph_t *eph)
     if (prn==0) prn=32;
     sat=satno(SYS_GPS,prn);
     eph->sat=sat;
-    eph->week=adjgpsweek(week);
+    eph->week=adjgpsweek_rtcm(rtcm,week);
     eph->toe=gpst2time(eph->week,eph->toes);
     eph->toc=gpst2time(eph->week,toc);
     eph->ttr=rtcm->time;
@@ -596,17 +611,17 @@ static void adjweek(rtcm_t *rtcm, double tow)
     int week;
     
     /* if no time, get cpu time */
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tow_p=time2gpst(rtcm->time,&week);
     if      (tow<tow_p-302400.0) tow+=604800.0;
     else if (tow>tow_p+302400.0) tow-=604800.0;
     rtcm->time=gpst2time(week,tow);
 }
 /* adjust weekly rollover of BDS time ----------------------------------------*/
-static int adjbdtweek(int week)
+static int adjbdtweek(const rtcm_t *rtcm, int week)
 {
     int w;
-    (void)time2bdt(gpst2bdt(utc2gpst(timeget())),&w);
+    (void)time2bdt(gpst2bdt(rtcm_now(rtcm)),&w);
     if (w<1) w=1; /* use 2006/1/1 if time is earlier than 2006/1/1 */
     return week+(w-week+512)/1024*1024;
 }
@@ -617,7 +632,7 @@ static void adjday_glot(rtcm_t *rtcm, double tod)
     double tow,tod_p;
     int week;
     
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     time=timeadd(gpst2utc(rtcm->time),10800.0); /* glonass time */
     tow=time2gpst(time,&week);
     tod_p=fmod(tow,86400.0); tow-=tod_p;
@@ -629,17 +644,20 @@ static void adjday_glot(rtcm_t *rtcm, double tod)
 /* adjust carrier-phase rollover ---------------------------------------------*/
 static double adjcp(rtcm_t *rtcm, int sat, int idx, double cp)
 {
-    if (rtcm->cp[sat-1][idx]==0.0) ;
-    else if (cp<rtcm->cp[sat-1][idx]-750.0) cp+=1500.0;
-    else if (cp>rtcm->cp[sat-1][idx]+750.0) cp-=1500.0;
-    rtcm->cp[sat-1][idx]=cp;
+    double *cp_p=rtcm->ctx?&rtcm->ctx->cp[sat-1][idx]:&rtcm->cp[sat-1][idx];
+    
+    if (*cp_p==0.0) ;
+    else if (cp<*cp_p-750.0) cp+=1500.0;
+    else if (cp>*cp_p+750.0) cp-=1500.0;
+    *cp_p=cp;
     return cp;
 }
 /* loss-of-lock indicator ----------------------------------------------------*/
 static int lossoflock(rtcm_t *rtcm, int sat, int idx, int lock)
 {
-    int lli=(!lock&&!rtcm->lock[sat-1][idx])||lock<rtcm->lock[sat-1][idx];
-    rtcm->lock[sat-1][idx]=(uint16_t)lock;
+    uint16_t *lock_p=rtcm->ctx?&rtcm->ctx->lock[sat-1][idx]:&rtcm->lock[sat-1][idx];
+    int lli=(!lock&&!*lock_p)||lock<*lock_p;
+    *lock_p=(uint16_t)lock;
     return lli;
 }
 /* S/N ratio -----------------------------------------------------------------*/
@@ -1219,8 +1237,8 @@ static int decode_type1019(rtcm_t *rtcm, eph_t *eph)
         return -1;
     }
     eph->sat=sat;
-    eph->week=adjgpsweek(week);
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    eph->week=adjgpsweek_rtcm(rtcm,week);
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tt=timediff(gpst2time(eph->week,eph->toes),rtcm->time);
     if      (tt<-302400.0) eph->week++;
     else if (tt>=302400.0) eph->week--;
@@ -1277,7 +1295,7 @@ static int decode_type1020(rtcm_t *rtcm, geph_t *geph)
     geph->sat=sat;
     geph->svh=bn;
     geph->iode=tb&0x7F;
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tow=time2gpst(gpst2utc(rtcm->time),&week);
     tod=fmod(tow,86400.0); tow-=tod;
     tof=tk_h*3600.0+tk_m*60.0+tk_s-10800.0; /* lt->utc */
@@ -1520,8 +1538,8 @@ static int decode_type1041(rtcm_t *rtcm, eph_t *eph)
         return -1;
     }
     eph->sat=sat;
-    eph->week=adjgpsweek(week);
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    eph->week=adjgpsweek_rtcm(rtcm,week);
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tt=timediff(gpst2time(eph->week,eph->toes),rtcm->time);
     if      (tt<-302400.0) eph->week++;
     else if (tt>=302400.0) eph->week--;
@@ -1586,8 +1604,8 @@ static int decode_type1044(rtcm_t *rtcm, eph_t *eph)
         return -1;
     }
     eph->sat=sat;
-    eph->week=adjgpsweek(week);
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    eph->week=adjgpsweek_rtcm(rtcm,week);
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tt=timediff(gpst2time(eph->week,eph->toes),rtcm->time);
     if      (tt<-302400.0) eph->week++;
     else if (tt>=302400.0) eph->week--;
@@ -1657,7 +1675,7 @@ static int decode_type1045(rtcm_t *rtcm, eph_t *eph)
     }
     eph->sat=sat;
     eph->week=week+1024; /* gal-week = gst-week + 1024 */
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tt=timediff(gpst2time(eph->week,eph->toes),rtcm->time);
     if      (tt<-302400.0) eph->week++;
     else if (tt>=302400.0) eph->week--;
@@ -1731,7 +1749,7 @@ static int decode_type1046(rtcm_t *rtcm, eph_t *eph)
     }
     eph->sat=sat;
     eph->week=week+1024; /* gal-week = gst-week + 1024 */
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tt=timediff(gpst2time(eph->week,eph->toes),rtcm->time);
     if      (tt<-302400.0) eph->week++;
     else if (tt>=302400.0) eph->week--;
@@ -1797,8 +1815,8 @@ static int decode_type1042(rtcm_t *rtcm, eph_t *eph)
         return -1;
     }
     eph->sat=sat;
-    eph->week=adjbdtweek(week);
-    if (rtcm->time.time==0) rtcm->time=utc2gpst(timeget());
+    eph->week=adjbdtweek(rtcm,week);
+    if (rtcm->time.time==0) rtcm->time=rtcm_now(rtcm);
     tt=timediff(bdt2gpst(bdt2time(eph->week,eph->toes)),rtcm->time);
     if      (tt<-302400.0) eph->week++;
     else if (tt>=302400.0) eph->week--;
@@ -2480,47 +2498,53 @@ static void save_msm_obs(rtcm_t *rtcm, nav_t *nav, int sys, msm_h_t *h, const do
 }
 /* decode type MSM message header --------------------------------------------*/
 static int decode_msm_head(rtcm_t *rtcm, int sys, int *sync, int *iod,
-                           msm_h_t *h, int *hsize)
+                           msm_h_t *h, bitstream_t *bs)
 {
     msm_h_t h0={0};
     double tow,tod;
     char *msg,tstr[64];
-    int i=24,j,dow,mask,staid,type,ncell=0;
+    int j,k,n,dow,staid,type,ncell=0;
+    uint32_t mask;
     
-    type=getbitu(rtcm->buff,i,12); i+=12;
+    bs_init(bs,rtcm->buff,sizeof(rtcm->buff),24);
+    type=bs_getu(bs,12);
     
     *h=h0;
-    if (i+157<=rtcm->len*8) {
-        staid     =getbitu(rtcm->buff,i,12);       i+=12;
+    if (bs->pos+157<=rtcm->len*8) {
+        staid     =bs_getu(bs,12);
         
         if (sys==SYS_GLO) {
-            dow   =getbitu(rtcm->buff,i, 3);       i+= 3;
-            tod   =getbitu(rtcm->buff,i,27)*0.001; i+=27;
+            dow   =bs_getu(bs, 3);
+            tod   =bs_getu(bs,27)*0.001;
             adjday_glot(rtcm,tod);
         }
         else if (sys==SYS_CMP) {
-            tow   =getbitu(rtcm->buff,i,30)*0.001; i+=30;
+            tow   =bs_getu(bs,30)*0.001;
             tow+=14.0; /* BDT -> GPST */
             adjweek(rtcm,tow);
         }
         else {
-            tow   =getbitu(rtcm->buff,i,30)*0.001; i+=30;
+            tow   =bs_getu(bs,30)*0.001;
             adjweek(rtcm,tow);
         }
-        *sync     =getbitu(rtcm->buff,i, 1);       i+= 1;
-        *iod      =getbitu(rtcm->buff,i, 3);       i+= 3;
-        h->time_s =getbitu(rtcm->buff,i, 7);       i+= 7;
-        h->clk_str=getbitu(rtcm->buff,i, 2);       i+= 2;
-        h->clk_ext=getbitu(rtcm->buff,i, 2);       i+= 2;
-        h->smooth =getbitu(rtcm->buff,i, 1);       i+= 1;
-        h->tint_s =getbitu(rtcm->buff,i, 3);       i+= 3;
-        for (j=1;j<=64;j++) {
-            mask=getbitu(rtcm->buff,i,1); i+=1;
-            if (mask) h->sats[h->nsat++]=j;
+        *sync     =bs_getu(bs, 1);
+        *iod      =bs_getu(bs, 3);
+        h->time_s =bs_getu(bs, 7);
+        h->clk_str=bs_getu(bs, 2);
+        h->clk_ext=bs_getu(bs, 2);
+        h->smooth =bs_getu(bs, 1);
+        h->tint_s =bs_getu(bs, 3);
+        mask=bs_getu(bs,32); /* satellite mask 1-32 */
+        for (j=1;j<=32;j++) {
+            if (mask&(1u<<(32-j))) h->sats[h->nsat++]=j;
+        }
+        mask=bs_getu(bs,32); /* satellite mask 33-64 */
+        for (j=33;j<=64;j++) {
+            if (mask&(1u<<(64-j))) h->sats[h->nsat++]=j;
         }
+        mask=bs_getu(bs,32); /* signal mask */
         for (j=1;j<=32;j++) {
-            mask=getbitu(rtcm->buff,i,1); i+=1;
-            if (mask) h->sigs[h->nsig++]=j;
+            if (mask&(1u<<(32-j))) h->sigs[h->nsig++]=j;
         }
     }
     else {
@@ -2535,16 +2559,19 @@ static int decode_msm_head(rtcm_t *rtcm, int sys, int *sync, int *iod,
               type,h->nsat,h->nsig);
         return -1;
     }
-    if (i+h->nsat*h->nsig>rtcm->len*8) {
+    if (bs->pos+h->nsat*h->nsig>rtcm->len*8) {
         trace(2,"rtcm3 %d length error: len=%d nsat=%d nsig=%d\n",type,
               rtcm->len,h->nsat,h->nsig);
         return -1;
     }
-    for (j=0;j<h->nsat*h->nsig;j++) {
-        h->cellmask[j]=getbitu(rtcm->buff,i,1); i+=1;
-        if (h->cellmask[j]) ncell++;
+    for (j=0;j<h->nsat*h->nsig;j+=32) { /* cell mask, 32 bits per read */
+        n=h->nsat*h->nsig-j<32?h->nsat*h->nsig-j:32;
+        mask=bs_getu(bs,n);
+        for (k=0;k<n;k++) {
+            h->cellmask[j+k]=(uint8_t)((mask>>(n-1-k))&1u);
+            if (h->cellmask[j+k]) ncell++;
+        }
     }
-    *hsize=i;
     
     time2str(rtcm->time,tstr,2);
     trace(4,"decode_head_msm: time=%s sys=%d staid=%d nsat=%d nsig=%d sync=%d iod=%d ncell=%d\n",
@@ -2561,8 +2588,9 @@ static int decode_msm_head(rtcm_t *rtcm, int sys, int *sync, int *iod,
 static int decode_msm0(rtcm_t *rtcm, nav_t *nav, int sys)
 {
     msm_h_t h={0};
-    int i,sync,iod;
-    if (decode_msm_head(rtcm,sys,&sync,&iod,&h,&i)<0) return -1;
+    bitstream_t bs;
+    int sync,iod;
+    if (decode_msm_head(rtcm,sys,&sync,&iod,&h,&bs)<0) return -1;
     rtcm->obsflag=!sync;
     return sync?0:1;
 }
@@ -2570,15 +2598,16 @@ static int decode_msm0(rtcm_t *rtcm, nav_t *nav, int sys)
 static int decode_msm4(rtcm_t *rtcm, nav_t *nav, int sys)
 {
     msm_h_t h={0};
+    bitstream_t bs;
     double r[64],pr[64],cp[64],cnr[64];
-    int i,j,type,sync,iod,ncell,rng,rng_m,prv,cpv,lock[64],half[64];
+    int j,type,sync,iod,ncell,rng,rng_m,prv,cpv,lock[64],half[64];
     
     type=getbitu(rtcm->buff,24,12);
     
     /* decode msm header */
-    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&i))<0) return -1;
+    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&bs))<0) return -1;
     
-    if (i+h.nsat*18+ncell*48>rtcm->len*8) {
+    if (bs.pos+h.nsat*18+ncell*48>rtcm->len*8) {
         trace(2,"rtcm3 %d length error: nsat=%d ncell=%d len=%d\n",type,h.nsat,
               ncell,rtcm->len);
         return -1;
@@ -2588,30 +2617,30 @@ static int decode_msm4(rtcm_t *rtcm, nav_t *nav, int sys)
     
     /* decode satellite data */
     for (j=0;j<h.nsat;j++) { /* range */
-        rng  =getbitu(rtcm->buff,i, 8); i+= 8;
+        rng  =bs_getu(&bs, 8);
         if (rng!=255) r[j]=rng*RANGE_MS;
     }
     for (j=0;j<h.nsat;j++) {
-        rng_m=getbitu(rtcm->buff,i,10); i+=10;
+        rng_m=bs_getu(&bs,10);
         if (r[j]!=0.0) r[j]+=rng_m*P2_10*RANGE_MS;
     }
     /* decode signal data */
     for (j=0;j<ncell;j++) { /* pseudorange */
-        prv=getbits(rtcm->buff,i,15); i+=15;
+        prv=bs_gets(&bs,15);
         if (prv!=-16384) pr[j]=prv*P2_24*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* phaserange */
-        cpv=getbits(rtcm->buff,i,22); i+=22;
+        cpv=bs_gets(&bs,22);
         if (cpv!=-2097152) cp[j]=cpv*P2_29*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* lock time */
-        lock[j]=getbitu(rtcm->buff,i,4); i+=4;
+        lock[j]=bs_getu(&bs,4);
     }
     for (j=0;j<ncell;j++) { /* half-cycle ambiguity */
-        half[j]=getbitu(rtcm->buff,i,1); i+=1;
+        half[j]=bs_getu(&bs,1);
     }
     for (j=0;j<ncell;j++) { /* cnr */
-        cnr[j]=getbitu(rtcm->buff,i,6)*1.0; i+=6;
+        cnr[j]=bs_getu(&bs,6)*1.0;
     }
     /* save obs data in msm message */
     save_msm_obs(rtcm,nav,sys,&h,r,pr,cp,NULL,NULL,cnr,lock,NULL,half);
@@ -2623,16 +2652,17 @@ static int decode_msm4(rtcm_t *rtcm, nav_t *nav, int sys)
 static int decode_msm5(rtcm_t *rtcm, nav_t* nav, int sys)
 {
     msm_h_t h={0};
+    bitstream_t bs;
     double r[64],rr[64],pr[64],cp[64],rrf[64],cnr[64];
-    int i,j,type,sync,iod,ncell,rng,rng_m,rate,prv,cpv,rrv,lock[64];
+    int j,type,sync,iod,ncell,rng,rng_m,rate,prv,cpv,rrv,lock[64];
     int ex[64],half[64];
     
     type=getbitu(rtcm->buff,24,12);
     
     /* decode msm header */
-    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&i))<0) return -1;
+    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&bs))<0) return -1;
     
-    if (i+h.nsat*36+ncell*63>rtcm->len*8) {
+    if (bs.pos+h.nsat*36+ncell*63>rtcm->len*8) {
         trace(2,"rtcm3 %d length error: nsat=%d ncell=%d len=%d\n",type,h.nsat,
               ncell,rtcm->len);
         return -1;
@@ -2644,40 +2674,40 @@ static int decode_msm5(rtcm_t *rtcm, nav_t* nav, int sys)
     
     /* decode satellite data */
     for (j=0;j<h.nsat;j++) { /* range */
-        rng  =getbitu(rtcm->buff,i, 8); i+= 8;
+        rng  =bs_getu(&bs, 8);
         if (rng!=255) r[j]=rng*RANGE_MS;
     }
     for (j=0;j<h.nsat;j++) { /* extended info */
-        ex[j]=getbitu(rtcm->buff,i, 4); i+= 4;
+        ex[j]=bs_getu(&bs, 4);
     }
     for (j=0;j<h.nsat;j++) {
-        rng_m=getbitu(rtcm->buff,i,10); i+=10;
+        rng_m=bs_getu(&bs,10);
         if (r[j]!=0.0) r[j]+=rng_m*P2_10*RANGE_MS;
     }
     for (j=0;j<h.nsat;j++) { /* phaserangerate */
-        rate =getbits(rtcm->buff,i,14); i+=14;
+        rate =bs_gets(&bs,14);
         if (rate!=-8192) rr[j]=rate*1.0;
     }
     /* decode signal data */
     for (j=0;j<ncell;j++) { /* pseudorange */
-        prv=getbits(rtcm->buff,i,15); i+=15;
+        prv=bs_gets(&bs,15);
         if (prv!=-16384) pr[j]=prv*P2_24*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* phaserange */
-        cpv=getbits(rtcm->buff,i,22); i+=22;
+        cpv=bs_gets(&bs,22);
         if (cpv!=-2097152) cp[j]=cpv*P2_29*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* lock time */
-        lock[j]=getbitu(rtcm->buff,i,4); i+=4;
+        lock[j]=bs_getu(&bs,4);
     }
     for (j=0;j<ncell;j++) { /* half-cycle ambiguity */
-        half[j]=getbitu(rtcm->buff,i,1); i+=1;
+        half[j]=bs_getu(&bs,1);
     }
     for (j=0;j<ncell;j++) { /* cnr */
-        cnr[j]=getbitu(rtcm->buff,i,6)*1.0; i+=6;
+        cnr[j]=bs_getu(&bs,6)*1.0;
     }
     for (j=0;j<ncell;j++) { /* phaserangerate */
-        rrv=getbits(rtcm->buff,i,15); i+=15;
+        rrv=bs_gets(&bs,15);
         if (rrv!=-16384) rrf[j]=rrv*0.0001;
     }
     /* save obs data in msm message */
@@ -2690,15 +2720,16 @@ static int decode_msm5(rtcm_t *rtcm, nav_t* nav, int sys)
 static int decode_msm6(rtcm_t *rtcm, nav_t* nav, int sys)
 {
     msm_h_t h={0};
+    bitstream_t bs;
     double r[64],pr[64],cp[64],cnr[64];
-    int i,j,type,sync,iod,ncell,rng,rng_m,prv,cpv,lock[64],half[64];
+    int j,type,sync,iod,ncell,rng,rng_m,prv,cpv,lock[64],half[64];
     
     type=getbitu(rtcm->buff,24,12);
     
     /* decode msm header */
-    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&i))<0) return -1;
+    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&bs))<0) return -1;
     
-    if (i+h.nsat*18+ncell*65>rtcm->len*8) {
+    if (bs.pos+h.nsat*18+ncell*65>rtcm->len*8) {
         trace(2,"rtcm3 %d length error: nsat=%d ncell=%d len=%d\n",type,h.nsat,
               ncell,rtcm->len);
         return -1;
@@ -2708,30 +2739,30 @@ static int decode_msm6(rtcm_t *rtcm, nav_t* nav, int sys)
     
     /* decode satellite data */
     for (j=0;j<h.nsat;j++) { /* range */
-        rng  =getbitu(rtcm->buff,i, 8); i+= 8;
+        rng  =bs_getu(&bs, 8);
         if (rng!=255) r[j]=rng*RANGE_MS;
     }
     for (j=0;j<h.nsat;j++) {
-        rng_m=getbitu(rtcm->buff,i,10); i+=10;
+        rng_m=bs_getu(&bs,10);
         if (r[j]!=0.0) r[j]+=rng_m*P2_10*RANGE_MS;
     }
     /* decode signal data */
     for (j=0;j<ncell;j++) { /* pseudorange */
-        prv=getbits(rtcm->buff,i,20); i+=20;
+        prv=bs_gets(&bs,20);
         if (prv!=-524288) pr[j]=prv*P2_29*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* phaserange */
-        cpv=getbits(rtcm->buff,i,24); i+=24;
+        cpv=bs_gets(&bs,24);
         if (cpv!=-8388608) cp[j]=cpv*P2_31*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* lock time */
-        lock[j]=getbitu(rtcm->buff,i,10); i+=10;
+        lock[j]=bs_getu(&bs,10);
     }
     for (j=0;j<ncell;j++) { /* half-cycle ambiguity */
-        half[j]=getbitu(rtcm->buff,i,1); i+=1;
+        half[j]=bs_getu(&bs,1);
     }
     for (j=0;j<ncell;j++) { /* cnr */
-        cnr[j]=getbitu(rtcm->buff,i,10)*0.0625; i+=10;
+        cnr[j]=bs_getu(&bs,10)*0.0625;
     }
     /* save obs data in msm message */
     save_msm_obs(rtcm,nav,sys,&h,r,pr,cp,NULL,NULL,cnr,lock,NULL,half);
@@ -2743,16 +2774,17 @@ static int decode_msm6(rtcm_t *rtcm, nav_t* nav, int sys)
 static int decode_msm7(rtcm_t *rtcm, nav_t* nav, int sys)
 {
     msm_h_t h={0};
+    bitstream_t bs;
     double r[64],rr[64],pr[64],cp[64],rrf[64],cnr[64];
-    int i,j,type,sync,iod,ncell,rng,rng_m,rate,prv,cpv,rrv,lock[64];
+    int j,type,sync,iod,ncell,rng,rng_m,rate,prv,cpv,rrv,lock[64];
     int ex[64],half[64];
     
     type=getbitu(rtcm->buff,24,12);
     
     /* decode msm header */
-    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&i))<0) return -1;
+    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&bs))<0) return -1;
     
-    if (i+h.nsat*36+ncell*80>rtcm->len*8) {
+    if (bs.pos+h.nsat*36+ncell*80>rtcm->len*8) {
         trace(2,"rtcm3 %d length error: nsat=%d ncell=%d len=%d\n",type,h.nsat,
               ncell,rtcm->len);
         return -1;
@@ -2764,40 +2796,40 @@ static int decode_msm7(rtcm_t *rtcm, nav_t* nav, int sys)
     
     /* decode satellite data */
     for (j=0;j<h.nsat;j++) { /* range */
-        rng  =getbitu(rtcm->buff,i, 8); i+= 8;
+        rng  =bs_getu(&bs, 8);
         if (rng!=255) r[j]=rng*RANGE_MS;
     }
     for (j=0;j<h.nsat;j++) { /* extended info */
-        ex[j]=getbitu(rtcm->buff,i, 4); i+= 4;
+        ex[j]=bs_getu(&bs, 4);
     }
     for (j=0;j<h.nsat;j++) {
-        rng_m=getbitu(rtcm->buff,i,10); i+=10;
+        rng_m=bs_getu(&bs,10);
         if (r[j]!=0.0) r[j]+=rng_m*P2_10*RANGE_MS;
     }
     for (j=0;j<h.nsat;j++) { /* phaserangerate */
-        rate =getbits(rtcm->buff,i,14); i+=14;
+        rate =bs_gets(&bs,14);
         if (rate!=-8192) rr[j]=rate*1.0;
     }
     /* decode signal data */
     for (j=0;j<ncell;j++) { /* pseudorange */
-        prv=getbits(rtcm->buff,i,20); i+=20;
+        prv=bs_gets(&bs,20);
         if (prv!=-524288) pr[j]=prv*P2_29*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* phaserange */
-        cpv=getbits(rtcm->buff,i,24); i+=24;
+        cpv=bs_gets(&bs,24);
         if (cpv!=-8388608) cp[j]=cpv*P2_31*RANGE_MS;
     }
     for (j=0;j<ncell;j++) { /* lock time */
-        lock[j]=getbitu(rtcm->buff,i,10); i+=10;
+        lock[j]=bs_getu(&bs,10);
     }
     for (j=0;j<ncell;j++) { /* half-cycle amiguity */
-        half[j]=getbitu(rtcm->buff,i,1); i+=1;
+        half[j]=bs_getu(&bs,1);
     }
     for (j=0;j<ncell;j++) { /* cnr */
-        cnr[j]=getbitu(rtcm->buff,i,10)*0.0625; i+=10;
+        cnr[j]=bs_getu(&bs,10)*0.0625;
     }
     for (j=0;j<ncell;j++) { /* phaserangerate */
-        rrv=getbits(rtcm->buff,i,15); i+=15;
+        rrv=bs_gets(&bs,15);
         if (rrv!=-16384) rrf[j]=rrv*0.0001;
     }
     /* save obs data in msm message */
@@ -2923,7 +2955,7 @@ extern int decode_rtcm3(rtcm_t *rtcm, nav_t* nav)
 	eph_t *eph=&new_eph;
 	geph_t *geph=&new_geph;
     double tow;
-    int ret=0,prn=0,type=getbitu(rtcm->buff,24,12),week;
+    int ret=0,type=getbitu(rtcm->buff,24,12),week;
     
     trace(3,"decode_rtcm3: len=%3d type=%d\n",rtcm->len,type);
     
@@ -2932,7 +2964,7 @@ extern int decode_rtcm3(rtcm_t *rtcm, nav_t* nav)
     }
     /* real-time input option */
     if (strstr(rtcm->opt,"-RT_INP")) {
-        tow=time2gpst(utc2gpst(timeget()),&week);
+        tow=time2gpst(rtcm_now(rtcm),&week);
         rtcm->time=gpst2time(week,floor(tow));
     }
     switch (type) {
@@ -3067,22 +3099,15 @@ extern int decode_rtcm3(rtcm_t *rtcm, nav_t* nav)
         case 4073: ret=decode_type4073(rtcm,nav); break;
         case 4076: ret=decode_type4076(rtcm,nav); break;
     }
-	if (ret==2&&eph->sat>0&&satsys(eph->sat,&prn)!=SYS_GLO)
+	if (ret==2&&eph->sat>0&&addeph(nav,eph))
 	{
-        if (type==1045)
-            nav->eph[prn-1+MAXSAT]=*eph;
-        else
-		    nav->eph[eph->sat-1]=*eph;
 		nav->ephsat=eph->sat;
 		nav->ephset=0;
-        nav->n=MAX_SAT_EPH;
 	}
-	if (ret==2&&geph->sat>0&&satsys(geph->sat,&prn)==SYS_GLO)
+	if (ret==2&&geph->sat>0&&addgeph(nav,geph))
 	{
-		nav->geph[prn-1]=*geph;
 		nav->ephsat=geph->sat;
 		nav->ephset=0;
-        nav->ng=MAX_GLO_EPH;
 	}
     if (ret>=0) {
         if      (1001<=type&&type<=1299) rtcm->nmsg3[type-1000]++; /*   1-299 */
@@ -4991,7 +5016,7 @@ static void gen_msm_sig(rtcm_t *rtcm, nav_t *nav, int sys, int nsat, int nsig, i
             if (!(sig=to_sigid(sys,data->code[j]))) continue;
             
             k=sat_ind[sat-1]-1;
-            if ((cell=cell_ind[sig_ind[sig-1]-1+k*nsig])>=64) continue;
+            if (!(cell=cell_ind[sig_ind[sig-1]-1+k*nsig])||cell>64) continue;
             
             freq=code2freq(sys,data->code[j],fcn-7);
             lambda=freq==0.0?0.0:CLIGHT/freq;
@@ -5018,6 +5043,25 @@ static void gen_msm_sig(rtcm_t *rtcm, nav_t *nav, int sys, int nsat, int nsig, i
         }
     }
 }
+/* MSM epoch time field -----------------------------------------------------*/
+static uint32_t msm_epoch_time(int sys, gtime_t time)
+{
+    double tow;
+    uint32_t dow;
+    
+    if (sys==SYS_GLO) {
+        /* GLONASS time (dow + tod-ms) */
+        tow=time2gpst(timeadd(gpst2utc(time),10800.0),NULL);
+        dow=(uint32_t)(tow/86400.0);
+        return (dow<<27)+ROUND_U(fmod(tow,86400.0)*1E3);
+    }
+    if (sys==SYS_CMP) {
+        /* BDS time (tow-ms) */
+        return ROUND_U(time2gpst(gpst2bdt(time),NULL)*1E3);
+    }
+    /* GPS, QZSS, Galileo and IRNSS time (tow-ms) */
+    return ROUND_U(time2gpst(time,NULL)*1E3);
+}
 /* encode MSM header ---------------------------------------------------------*/
 static int encode_msm_head(int type, rtcm_t *rtcm, nav_t *nav, int sys, int sync, int *nsat,
                            int *ncell, double *rrng, double *rrate,
@@ -5025,9 +5069,8 @@ static int encode_msm_head(int type, rtcm_t *rtcm, nav_t *nav, int sys, int sync
                            double *rate, double *lock, uint8_t *half,
                            float *cnr)
 {
-    double tow;
     uint8_t sat_ind[64]={0},sig_ind[32]={0},cell_ind[32*64]={0};
-    uint32_t dow,epoch;
+    uint32_t epoch;
     int i=24,j,nsig=0;
     
     switch (sys) {
@@ -5043,20 +5086,8 @@ static int encode_msm_head(int type, rtcm_t *rtcm, nav_t *nav, int sys, int sync
     /* generate msm satellite, signal and cell index */
     gen_msm_index(rtcm,sys,nsat,&nsig,ncell,sat_ind,sig_ind,cell_ind);
     
-    if (sys==SYS_GLO) {
-        /* GLONASS time (dow + tod-ms) */
-        tow=time2gpst(timeadd(gpst2utc(rtcm->time),10800.0),NULL);
-        dow=(uint32_t)(tow/86400.0);
-        epoch=(dow<<27)+ROUND_U(fmod(tow,86400.0)*1E3);
-    }
-    else if (sys==SYS_CMP) {
-        /* BDS time (tow-ms) */
-        epoch=ROUND_U(time2gpst(gpst2bdt(rtcm->time),NULL)*1E3);
-    }
-    else {
-        /* GPS, QZSS, Galileo and IRNSS time (tow-ms) */
-        epoch=ROUND_U(time2gpst(rtcm->time,NULL)*1E3);
-    }
+    epoch=msm_epoch_time(sys,rtcm->time);
+    
     /* encode msm header (ref [15] table 3.5-78) */
     setbitu(rtcm->buff,i,12,type       ); i+=12; /* message number */
     setbitu(rtcm->buff,i,12,rtcm->staid); i+=12; /* reference station id */
@@ -5091,7 +5122,7 @@ static int encode_msm_head(int type, rtcm_t *rtcm, nav_t *nav, int sys, int sync
     return i;
 }
 /* encode rough range integer ms ---------------------------------------------*/
-static int encode_msm_int_rrng(rtcm_t *rtcm, int i, const double *rrng,
+static int encode_msm_int_rrng(uint8_t *buff, int i, const double *rrng,
                                int nsat)
 {
     uint32_t int_ms;
@@ -5102,19 +5133,18 @@ static int encode_msm_int_rrng(rtcm_t *rtcm, int i, const double *rrng,
             int_ms=255;
         }
         else if (rrng[j]<0.0||rrng[j]>RANGE_MS*255.0) {
-            trace(2,"msm rough range overflow %s rrng=%.3f\n",
-                 time_str(rtcm->time,0),rrng[j]);
+            trace(2,"msm rough range overflow rrng=%.3f\n",rrng[j]);
             int_ms=255;
         }
         else {
             int_ms=ROUND_U(rrng[j]/RANGE_MS/P2_10)>>10;
         }
-        setbitu(rtcm->buff,i,8,int_ms); i+=8;
+        setbitu(buff,i,8,int_ms); i+=8;
     }
     return i;
 }
 /* encode rough range modulo 1 ms --------------------------------------------*/
-static int encode_msm_mod_rrng(rtcm_t *rtcm, int i, const double *rrng,
+static int encode_msm_mod_rrng(uint8_t *buff, int i, const double *rrng,
                                int nsat)
 {
     uint32_t mod_ms;
@@ -5127,40 +5157,39 @@ static int encode_msm_mod_rrng(rtcm_t *rtcm, int i, const double *rrng,
         else {
             mod_ms=ROUND_U(rrng[j]/RANGE_MS/P2_10)&0x3FFu;
         }
-        setbitu(rtcm->buff,i,10,mod_ms); i+=10;
+        setbitu(buff,i,10,mod_ms); i+=10;
     }
     return i;
 }
 /* encode extended satellite info --------------------------------------------*/
-static int encode_msm_info(rtcm_t *rtcm, int i, const uint8_t *info, int nsat)
+static int encode_msm_info(uint8_t *buff, int i, const uint8_t *info, int nsat)
 {
     int j;
     
     for (j=0;j<nsat;j++) {
-        setbitu(rtcm->buff,i,4,info[j]); i+=4;
+        setbitu(buff,i,4,info[j]); i+=4;
     }
     return i;
 }
 /* encode rough phase-range-rate ---------------------------------------------*/
-static int encode_msm_rrate(rtcm_t *rtcm, int i, const double *rrate, int nsat)
+static int encode_msm_rrate(uint8_t *buff, int i, const double *rrate, int nsat)
 {
     int j,rrate_val;
     
     for (j=0;j<nsat;j++) {
         if (fabs(rrate[j])>8191.0) {
-            trace(2,"msm rough phase-range-rate overflow %s rrate=%.4f\n",
-                 time_str(rtcm->time,0),rrate[j]);
+            trace(2,"msm rough phase-range-rate overflow rrate=%.4f\n",rrate[j]);
             rrate_val=-8192;
         }
         else {
             rrate_val=ROUND(rrate[j]/1.0);
         }
-        setbits(rtcm->buff,i,14,rrate_val); i+=14;
+        setbits(buff,i,14,rrate_val); i+=14;
     }
     return i;
 }
 /* encode fine pseudorange ---------------------------------------------------*/
-static int encode_msm_psrng(rtcm_t *rtcm, int i, const double *psrng, int ncell)
+static int encode_msm_psrng(uint8_t *buff, int i, const double *psrng, int ncell)
 {
     int j,psrng_val;
     
@@ -5169,19 +5198,18 @@ static int encode_msm_psrng(rtcm_t *rtcm, int i, const double *psrng, int ncell)
             psrng_val=-16384;
         }
         else if (fabs(psrng[j])>292.7) {
-            trace(2,"msm fine pseudorange overflow %s psrng=%.3f\n",
-                 time_str(rtcm->time,0),psrng[j]);
+            trace(2,"msm fine pseudorange overflow psrng=%.3f\n",psrng[j]);
             psrng_val=-16384;
         }
         else {
             psrng_val=ROUND(psrng[j]/RANGE_MS/P2_24);
         }
-        setbits(rtcm->buff,i,15,psrng_val); i+=15;
+        setbits(buff,i,15,psrng_val); i+=15;
     }
     return i;
 }
 /* encode fine pseudorange with extended resolution --------------------------*/
-static int encode_msm_psrng_ex(rtcm_t *rtcm, int i, const double *psrng,
+static int encode_msm_psrng_ex(uint8_t *buff, int i, const double *psrng,
                                int ncell)
 {
     int j,psrng_val;
@@ -5191,19 +5219,18 @@ static int encode_msm_psrng_ex(rtcm_t *rtcm, int i, const double *psrng,
             psrng_val=-524288;
         }
         else if (fabs(psrng[j])>292.7) {
-            trace(2,"msm fine pseudorange ext overflow %s psrng=%.3f\n",
-                 time_str(rtcm->time,0),psrng[j]);
+            trace(2,"msm fine pseudorange ext overflow psrng=%.3f\n",psrng[j]);
             psrng_val=-524288;
         }
         else {
             psrng_val=ROUND(psrng[j]/RANGE_MS/P2_29);
         }
-        setbits(rtcm->buff,i,20,psrng_val); i+=20;
+        setbits(buff,i,20,psrng_val); i+=20;
     }
     return i;
 }
 /* encode fine phase-range ---------------------------------------------------*/
-static int encode_msm_phrng(rtcm_t *rtcm, int i, const double *phrng, int ncell)
+static int encode_msm_phrng(uint8_t *buff, int i, const double *phrng, int ncell)
 {
     int j,phrng_val;
     
@@ -5212,19 +5239,18 @@ static int encode_msm_phrng(rtcm_t *rtcm, int i, const double *phrng, int ncell)
             phrng_val=-2097152;
         }
         else if (fabs(phrng[j])>1171.0) {
-            trace(2,"msm fine phase-range overflow %s phrng=%.3f\n",
-                 time_str(rtcm->time,0),phrng[j]);
+            trace(2,"msm fine phase-range overflow phrng=%.3f\n",phrng[j]);
             phrng_val=-2097152;
         }
         else {
             phrng_val=ROUND(phrng[j]/RANGE_MS/P2_29);
         }
-        setbits(rtcm->buff,i,22,phrng_val); i+=22;
+        setbits(buff,i,22,phrng_val); i+=22;
     }
     return i;
 }
 /* encode fine phase-range with extended resolution --------------------------*/
-static int encode_msm_phrng_ex(rtcm_t *rtcm, int i, const double *phrng,
+static int encode_msm_phrng_ex(uint8_t *buff, int i, const double *phrng,
                                int ncell)
 {
     int j,phrng_val;
@@ -5234,75 +5260,74 @@ static int encode_msm_phrng_ex(rtcm_t *rtcm, int i, const double *phrng,
             phrng_val=-8388608;
         }
         else if (fabs(phrng[j])>1171.0) {
-            trace(2,"msm fine phase-range ext overflow %s phrng=%.3f\n",
-                 time_str(rtcm->time,0),phrng[j]);
+            trace(2,"msm fine phase-range ext overflow phrng=%.3f\n",phrng[j]);
             phrng_val=-8388608;
         }
         else {
             phrng_val=ROUND(phrng[j]/RANGE_MS/P2_31);
         }
-        setbits(rtcm->buff,i,24,phrng_val); i+=24;
+        setbits(buff,i,24,phrng_val); i+=24;
     }
     return i;
 }
 /* encode lock-time indicator ------------------------------------------------*/
-static int encode_msm_lock(rtcm_t *rtcm, int i, const double *lock, int ncell)
+static int encode_msm_lock(uint8_t *buff, int i, const double *lock, int ncell)
 {
     int j,lock_val;
     
     for (j=0;j<ncell;j++) {
         lock_val=to_msm_lock(lock[j]);
-        setbitu(rtcm->buff,i,4,lock_val); i+=4;
+        setbitu(buff,i,4,lock_val); i+=4;
     }
     return i;
 }
 /* encode lock-time indicator with extended range and resolution -------------*/
-static int encode_msm_lock_ex(rtcm_t *rtcm, int i, const double *lock,
+static int encode_msm_lock_ex(uint8_t *buff, int i, const double *lock,
                               int ncell)
 {
     int j,lock_val;
     
     for (j=0;j<ncell;j++) {
         lock_val=to_msm_lock_ex(lock[j]);
-        setbitu(rtcm->buff,i,10,lock_val); i+=10;
+        setbitu(buff,i,10,lock_val); i+=10;
     }
     return i;
 }
 /* encode half-cycle-ambiguity indicator -------------------------------------*/
-static int encode_msm_half_amb(rtcm_t *rtcm, int i, const uint8_t *half,
+static int encode_msm_half_amb(uint8_t *buff, int i, const uint8_t *half,
                                int ncell)
 {
     int j;
     
     for (j=0;j<ncell;j++) {
-        setbitu(rtcm->buff,i,1,half[j]); i+=1;
+        setbitu(buff,i,1,half[j]); i+=1;
     }
     return i;
 }
 /* encode signal CNR ---------------------------------------------------------*/
-static int encode_msm_cnr(rtcm_t *rtcm, int i, const float *cnr, int ncell)
+static int encode_msm_cnr(uint8_t *buff, int i, const float *cnr, int ncell)
 {
     int j,cnr_val;
     
     for (j=0;j<ncell;j++) {
         cnr_val=ROUND(cnr[j]/1.0);
-        setbitu(rtcm->buff,i,6,cnr_val); i+=6;
+        setbitu(buff,i,6,cnr_val); i+=6;
     }
     return i;
 }
 /* encode signal CNR with extended resolution --------------------------------*/
-static int encode_msm_cnr_ex(rtcm_t *rtcm, int i, const float *cnr, int ncell)
+static int encode_msm_cnr_ex(uint8_t *buff, int i, const float *cnr, int ncell)
 {
     int j,cnr_val;
     
     for (j=0;j<ncell;j++) {
         cnr_val=ROUND(cnr[j]/0.0625);
-        setbitu(rtcm->buff,i,10,cnr_val); i+=10;
+        setbitu(buff,i,10,cnr_val); i+=10;
     }
     return i;
 }
 /* encode fine phase-range-rate ----------------------------------------------*/
-static int encode_msm_rate(rtcm_t *rtcm, int i, const double *rate, int ncell)
+static int encode_msm_rate(uint8_t *buff, int i, const double *rate, int ncell)
 {
     int j,rate_val;
     
@@ -5311,14 +5336,13 @@ static int encode_msm_rate(rtcm_t *rtcm, int i, const double *rate, int ncell)
             rate_val=-16384;
         }
         else if (fabs(rate[j])>1.6384) {
-            trace(2,"msm fine phase-range-rate overflow %s rate=%.3f\n",
-                 time_str(rtcm->time,0),rate[j]);
+            trace(2,"msm fine phase-range-rate overflow rate=%.3f\n",rate[j]);
             rate_val=-16384;
         }
         else {
             rate_val=ROUND(rate[j]/0.0001);
         }
-        setbitu(rtcm->buff,i,15,rate_val); i+=15;
+        setbitu(buff,i,15,rate_val); i+=15;
     }
     return i;
 }
@@ -5336,10 +5360,10 @@ static int encode_msm1(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
+    i=encode_msm_psrng   (rtcm->buff,i,psrng,ncell); /* fine pseudorange */
     
     rtcm->nbit=i;
     return 1;
@@ -5359,12 +5383,12 @@ static int encode_msm2(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
+    i=encode_msm_phrng   (rtcm->buff,i,phrng,ncell); /* fine phase-range */
+    i=encode_msm_lock    (rtcm->buff,i,lock ,ncell); /* lock-time indicator */
+    i=encode_msm_half_amb(rtcm->buff,i,half ,ncell); /* half-cycle-amb indicator */
     
     rtcm->nbit=i;
     return 1;
@@ -5384,13 +5408,13 @@ static int encode_msm3(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
+    i=encode_msm_psrng   (rtcm->buff,i,psrng,ncell); /* fine pseudorange */
+    i=encode_msm_phrng   (rtcm->buff,i,phrng,ncell); /* fine phase-range */
+    i=encode_msm_lock    (rtcm->buff,i,lock ,ncell); /* lock-time indicator */
+    i=encode_msm_half_amb(rtcm->buff,i,half ,ncell); /* half-cycle-amb indicator */
     
     rtcm->nbit=i;
     return 1;
@@ -5411,15 +5435,15 @@ static int encode_msm4(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_int_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range integer ms */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr     (rtcm,i,cnr  ,ncell); /* signal cnr */
+    i=encode_msm_psrng   (rtcm->buff,i,psrng,ncell); /* fine pseudorange */
+    i=encode_msm_phrng   (rtcm->buff,i,phrng,ncell); /* fine phase-range */
+    i=encode_msm_lock    (rtcm->buff,i,lock ,ncell); /* lock-time indicator */
+    i=encode_msm_half_amb(rtcm->buff,i,half ,ncell); /* half-cycle-amb indicator */
+    i=encode_msm_cnr     (rtcm->buff,i,cnr  ,ncell); /* signal cnr */
     rtcm->nbit=i;
     return 1;
 }
@@ -5439,18 +5463,18 @@ static int encode_msm5(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_info    (rtcm,i,info ,nsat ); /* extended satellite info */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
-    i=encode_msm_rrate   (rtcm,i,rrate,nsat ); /* rough phase-range-rate */
+    i=encode_msm_int_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range integer ms */
+    i=encode_msm_info    (rtcm->buff,i,info ,nsat ); /* extended satellite info */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_rrate   (rtcm->buff,i,rrate,nsat ); /* rough phase-range-rate */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr     (rtcm,i,cnr  ,ncell); /* signal cnr */
-    i=encode_msm_rate    (rtcm,i,rate ,ncell); /* fine phase-range-rate */
+    i=encode_msm_psrng   (rtcm->buff,i,psrng,ncell); /* fine pseudorange */
+    i=encode_msm_phrng   (rtcm->buff,i,phrng,ncell); /* fine phase-range */
+    i=encode_msm_lock    (rtcm->buff,i,lock ,ncell); /* lock-time indicator */
+    i=encode_msm_half_amb(rtcm->buff,i,half ,ncell); /* half-cycle-amb indicator */
+    i=encode_msm_cnr     (rtcm->buff,i,cnr  ,ncell); /* signal cnr */
+    i=encode_msm_rate    (rtcm->buff,i,rate ,ncell); /* fine phase-range-rate */
     rtcm->nbit=i;
     return 1;
 }
@@ -5470,15 +5494,15 @@ static int encode_msm6(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_int_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range integer ms */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng_ex(rtcm,i,psrng,ncell); /* fine pseudorange ext */
-    i=encode_msm_phrng_ex(rtcm,i,phrng,ncell); /* fine phase-range ext */
-    i=encode_msm_lock_ex (rtcm,i,lock ,ncell); /* lock-time indicator ext */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr_ex  (rtcm,i,cnr  ,ncell); /* signal cnr ext */
+    i=encode_msm_psrng_ex(rtcm->buff,i,psrng,ncell); /* fine pseudorange ext */
+    i=encode_msm_phrng_ex(rtcm->buff,i,phrng,ncell); /* fine phase-range ext */
+    i=encode_msm_lock_ex (rtcm->buff,i,lock ,ncell); /* lock-time indicator ext */
+    i=encode_msm_half_amb(rtcm->buff,i,half ,ncell); /* half-cycle-amb indicator */
+    i=encode_msm_cnr_ex  (rtcm->buff,i,cnr  ,ncell); /* signal cnr ext */
     rtcm->nbit=i;
     return 1;
 }
@@ -5498,18 +5522,18 @@ static int encode_msm7(rtcm_t *rtcm, nav_t* nav, int sys, int sync)
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_info    (rtcm,i,info ,nsat ); /* extended satellite info */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
-    i=encode_msm_rrate   (rtcm,i,rrate,nsat ); /* rough phase-range-rate */
+    i=encode_msm_int_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range integer ms */
+    i=encode_msm_info    (rtcm->buff,i,info ,nsat ); /* extended satellite info */
+    i=encode_msm_mod_rrng(rtcm->buff,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    i=encode_msm_rrate   (rtcm->buff,i,rrate,nsat ); /* rough phase-range-rate */
     
     /* encode msm signal data */
-    i=encode_msm_psrng_ex(rtcm,i,psrng,ncell); /* fine pseudorange ext */
-    i=encode_msm_phrng_ex(rtcm,i,phrng,ncell); /* fine phase-range ext */
-    i=encode_msm_lock_ex (rtcm,i,lock ,ncell); /* lock-time indicator ext */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr_ex  (rtcm,i,cnr  ,ncell); /* signal cnr ext */
-    i=encode_msm_rate    (rtcm,i,rate ,ncell); /* fine phase-range-rate */
+    i=encode_msm_psrng_ex(rtcm->buff,i,psrng,ncell); /* fine pseudorange ext */
+    i=encode_msm_phrng_ex(rtcm->buff,i,phrng,ncell); /* fine phase-range ext */
+    i=encode_msm_lock_ex (rtcm->buff,i,lock ,ncell); /* lock-time indicator ext */
+    i=encode_msm_half_amb(rtcm->buff,i,half ,ncell); /* half-cycle-amb indicator */
+    i=encode_msm_cnr_ex  (rtcm->buff,i,cnr  ,ncell); /* signal cnr ext */
+    i=encode_msm_rate    (rtcm->buff,i,rate ,ncell); /* fine phase-range-rate */
     rtcm->nbit=i;
     return 1;
 }
@@ -5632,12 +5656,12 @@ extern int encode_rtcm3(rtcm_t *rtcm, nav_t *nav, int type, int subtype, int syn
 		else if (type==1045)
 		{
 			if (satsys(nav->ephsat,&prn)!=SYS_GAL) return 0;
-		    eph=nav->eph+nav->ephsat-1+MAXSAT; /* F/NAV */
+		    eph=nav->eph+MAXSAT+prn-1; /* F/NAV */
 		}
 		else if (type==1046)
 		{
 			if (satsys(nav->ephsat,&prn)!=SYS_GAL) return 0;
-		    eph=nav->eph+nav->ephsat-1+MAXSAT; /* I/NAV */
+		    eph=nav->eph+nav->ephsat-1; /* I/NAV */
 		}
 	}
 
@@ -5880,9 +5904,81 @@ extern int input_rtcm3_buff(rtcm_t *rtcm, uint8_t *buff, int nbyte, nav_t *nav)
     /* decode rtcm3 message */
     return decode_rtcm3(rtcm,nav);
 }
-extern int check_rtcm3_type(uint8_t *buff, int nbyte, int *len, int *crc, int *staid, double *xyz)
+/* input complete rtcm3 frame without parity check (checked by the framer) ---*/
+extern int input_rtcm3_frame(rtcm_t *rtcm, uint8_t *buff, int len, nav_t *nav)
+{
+    if (buff[0]!=RTCM3PREAMB||len<6) return 0;
+    rtcm->len=getbitu(buff,14,10)+3; /* length without parity */
+    if (len<(rtcm->len+3)) return 0;
+    
+    memcpy(rtcm->buff,buff,sizeof(uint8_t)*(rtcm->len+3));
+    /* decode rtcm3 message */
+    return decode_rtcm3(rtcm,nav);
+}
+/* input complete rtcm3 frame of one station --------------------------------
+* decode a frame with the per-station context, rtcm is used as work area and can
+* be shared by all stations decoded on the same thread
+* args   : rtcm_t *rtcm     IO  rtcm control struct (work area)
+*          rtcm_ctx_t *ctx  IO  per-station context (time, lock and phase state)
+*          uint8_t *buff    I   complete frame (crc checked)
+*          int    len       I   frame length (bytes)
+*          nav_t  *nav      IO  navigation data
+* return : status as input_rtcm3()
+* notes  : rtcm->obs holds the observation data of this message only, the caller
+*          merges the messages of an epoch
+*-----------------------------------------------------------------------------*/
+extern int input_rtcm3_ctx(rtcm_t *rtcm, rtcm_ctx_t *ctx, uint8_t *buff, int len, nav_t *nav)
+{
+    int ret;
+    
+    rtcm->ctx=ctx;
+    if (ctx->time.time!=0) rtcm->time=ctx->time; /* else approximate time */
+    rtcm->staid=0;
+    rtcm->obs.n=0;
+    rtcm->obsflag=0;
+    
+    ret=input_rtcm3_frame(rtcm,buff,len,nav);
+    
+    if (rtcm->time.time!=0) ctx->time=rtcm->time;
+    if (rtcm->staid>0) ctx->staid=rtcm->staid;
+    rtcm->ctx=NULL;
+    return ret;
+}
+/* get message type, station id and position of a complete rtcm3 frame ------*/
+extern int check_rtcm3_head(uint8_t *buff, int *staid, double *xyz)
 {
     int type = 0, i = 0;
+    type = getbitu(buff, 24, 12);
+    if (type == 1071 || type == 1072 || type == 1073 || type == 1074 || type == 1075 || type == 1076 || type == 1077 || /* GPS */
+        type == 1081 || type == 1082 || type == 1083 || type == 1084 || type == 1085 || type == 1086 || type == 1087 || /* GLO */
+        type == 1091 || type == 1092 || type == 1093 || type == 1094 || type == 1095 || type == 1096 || type == 1097 || /* GAL */
+        type == 1101 || type == 1102 || type == 1103 || type == 1104 || type == 1105 || type == 1106 || type == 1107 || /* SBS */
+        type == 1111 || type == 1112 || type == 1113 || type == 1114 || type == 1115 || type == 1116 || type == 1117 || /* QZS */
+        type == 1121 || type == 1122 || type == 1123 || type == 1124 || type == 1125 || type == 1126 || type == 1127 || /* BDS */
+        type == 1131 || type == 1132 || type == 1133 || type == 1134 || type == 1135 || type == 1136 || type == 1137 || /* IRN */
+        type == 1001 || type == 1002 || type == 1003 || type == 1004 ||	/* RTCM 2.x */
+        type == 1009 || type == 1010 || type == 1011 || type == 1012 || /* RTCM 2.x */
+        type == 1005 || type == 1006 || type == 1007 || type == 1008 || type == 1033 || type == 1230)
+    {
+        *staid = getbitu(buff, 24 + 12, 12);
+    }
+    else
+    {
+        *staid = 0;
+    }
+    if (type == 1005 || type == 1006)
+    {
+        /* 24 => type, 24+12 => staid, 24+12+12+6+4 => pos */
+        i = 24 + 12 + 12 + 6 + 4;
+        xyz[0]=getbits_38(buff,i)*0.0001; i+=38+2;
+        xyz[1]=getbits_38(buff,i)*0.0001; i+=38+2;
+        xyz[2]=getbits_38(buff,i)*0.0001;
+    }
+    return type;
+}
+extern int check_rtcm3_type(uint8_t *buff, int nbyte, int *len, int *crc, int *staid, double *xyz)
+{
+    int type = 0;
     if (buff[0]!=RTCM3PREAMB||nbyte<6) return 0;
     *len = getbitu(buff, 14, 10) + 3; /* length without parity */
     if (nbyte<(*len + 3)) return 0;
@@ -5891,32 +5987,7 @@ extern int check_rtcm3_type(uint8_t *buff, int nbyte, int *len, int *crc, int *s
     else
     {
         *crc = 0;
-        type = getbitu(buff, 24, 12);
-        if (type == 1071 || type == 1072 || type == 1073 || type == 1074 || type == 1075 || type == 1076 || type == 1077 || /* GPS */
-            type == 1081 || type == 1082 || type == 1083 || type == 1084 || type == 1085 || type == 1086 || type == 1087 || /* GLO */
-            type == 1091 || type == 1092 || type == 1093 || type == 1094 || type == 1095 || type == 1096 || type == 1097 || /* GAL */
-            type == 1101 || type == 1102 || type == 1103 || type == 1104 || type == 1105 || type == 1106 || type == 1107 || /* SBS */
-            type == 1111 || type == 1112 || type == 1113 || type == 1114 || type == 1115 || type == 1116 || type == 1117 || /* QZS */
-            type == 1121 || type == 1122 || type == 1123 || type == 1124 || type == 1125 || type == 1126 || type == 1127 || /* BDS */
-            type == 1131 || type == 1132 || type == 1133 || type == 1134 || type == 1135 || type == 1136 || type == 1137 || /* IRN */
-            type == 1001 || type == 1002 || type == 1003 || type == 1004 ||	/* RTCM 2.x */
-            type == 1009 || type == 1010 || type == 1011 || type == 1012 || /* RTCM 2.x */
-            type == 1005 || type == 1006 || type == 1007 || type == 1008 || type == 1033 || type == 1230)
-        {
-            *staid = getbitu(buff, 24 + 12, 12);
-        }
-        else
-        {
-            *staid = 0;
-        }
-        if (type == 1005 || type == 1006)
-        {
-            /* 24 => type, 24+12 => staid, 24+12+12+6+4 => pos */
-            i = 24 + 12 + 12 + 6 + 4;
-            xyz[0]=getbits_38(buff,i)*0.0001; i+=38+2;
-            xyz[1]=getbits_38(buff,i)*0.0001; i+=38+2;
-            xyz[2]=getbits_38(buff,i)*0.0001;
-        }
+        type = check_rtcm3_head(buff, staid, xyz);
     }
     *len+=3; /* total len */
     return type; /* type */
@@ -6114,4 +6185,274 @@ extern int write_rtcm3(rtcm_t *out, nav_t* nav, int msg, int sync, uint8_t *rtcm
     }
     return nbyte;
 }
+typedef struct {        /* msm satellite of an epoch */
+    int idx;            /* index of the satellite in the epoch */
+    int satid;          /* msm satellite id */
+    int fcn;            /* GLONASS fcn+7 (-1: none) */
+    int sig[NFREQ+NEXOBS]; /* msm signal id (0: none) */
+    double freq[NFREQ+NEXOBS]; /* carrier frequency (Hz) */
+    uint32_t mask;      /* msm signals of the satellite (bit sig-1) */
+} msm_sat_t;
+
+/* number of msm signals in signal mask --------------------------------------*/
+static int msm_nsig(uint32_t mask)
+{
+    int n=0;
+    
+    for (;mask;mask&=mask-1) n++;
+    return n;
+}
+
+/* encode MSM message of epoch satellites ------------------------------------*/
+static int encode_msm_epoch(msm_enc_t *enc, const epoch_t *epoch, int sys, int msm,
+                            int staid, int sync, const msm_sat_t *msat, int n,
+                            uint8_t *buff, int size)
+{
+    const sat_obs_t *data;
+    gtime_t time;
+    double rrng[64],rrate[64],psrng[64],phrng[64],rate[64],lock[64];
+    double freq,lambda,psrng_s,phrng_s,rate_s;
+    float cnr[64];
+    uint8_t sat_ind[64]={0},sig_ind[32]={0},cell_ind[32*64]={0},info[64]={0},half[64];
+    uint32_t crc;
+    int i,j,k,sat,sig,cell,LLI,nsat=0,nsig=0,ncell=0,nbit,len,type;
+    int ext=msm==5||msm==7;
+    
+    switch (sys) {
+        case SYS_GPS: type=1070+msm; break;
+        case SYS_GLO: type=1080+msm; break;
+        case SYS_GAL: type=1090+msm; break;
+        case SYS_QZS: type=1110+msm; break;
+        case SYS_SBS: type=1100+msm; break;
+        case SYS_CMP: type=1120+msm; break;
+        case SYS_IRN: type=1130+msm; break;
+        default: return 0;
+    }
+    time=gpst2time(epoch->wk,epoch->ws);
+    
+    /* satellite, signal and cell index */
+    for (i=0;i<n;i++) {
+        if (!(sat=msat[i].satid)) continue;
+        
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (!(sig=msat[i].sig[j])) continue;
+            
+            sat_ind[sat-1]=sig_ind[sig-1]=1;
+        }
+    }
+    for (i=0;i<64;i++) {
+        if (sat_ind[i]) sat_ind[i]=++nsat;
+    }
+    for (i=0;i<32;i++) {
+        if (sig_ind[i]) sig_ind[i]=++nsig;
+    }
+    for (i=0;i<n;i++) {
+        if (!(sat=msat[i].satid)) continue;
+        
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (!(sig=msat[i].sig[j])) continue;
+            
+            cell_ind[sig_ind[sig-1]-1+(sat_ind[sat-1]-1)*nsig]=1;
+        }
+    }
+    for (i=0;i<nsat*nsig;i++) {
+        if (cell_ind[i]) cell_ind[i]=ncell<64?++ncell:0; /* cells 1..64, others not sent */
+    }
+    /* message length (header+data) (bytes) */
+    nbit=24+169+(nsat*nsig<64?nsat*nsig:64)+nsat*(ext?36:18)+
+         ncell*(msm==4?48:(msm==5?63:(msm==6?65:80)));
+    if ((len=(nbit+7)/8)>=3+1024) {
+        trace(2,"generate rtcm 3 message length error len=%d\n",len-3);
+        return -1;
+    }
+    if (len+3>size) return -1;
+    
+    /* satellite and signal data fields */
+    for (i=0;i<64;i++) rrng[i]=rrate[i]=psrng[i]=phrng[i]=rate[i]=0.0;
+    
+    for (i=0;i<n;i++) {
+        data=epoch->obs+msat[i].idx;
+        if (!(sat=msat[i].satid)) continue;
+        
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (!(sig=msat[i].sig[j])) continue;
+            k=sat_ind[sat-1]-1;
+            freq=msat[i].freq[j];
+            
+            /* rough range (ms) and rough phase-range-rate (m/s) */
+            if (rrng[k]==0.0&&data->P[j]!=0.0) {
+                rrng[k]=ROUND( data->P[j]/RANGE_MS/P2_10)*RANGE_MS*P2_10;
+            }
+            if (rrate[k]==0.0&&data->D[j]!=0.0&&freq>0.0) {
+                rrate[k]=ROUND(-data->D[j]*CLIGHT/freq)*1.0;
+            }
+            /* extended satellite info */
+            info[k]=sys!=SYS_GLO?0:(msat[i].fcn<0?15:msat[i].fcn);
+        }
+    }
+    for (i=0;i<n;i++) {
+        data=epoch->obs+msat[i].idx;
+        if (!(sat=msat[i].satid)) continue;
+        
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (!(sig=msat[i].sig[j])) continue;
+            
+            k=sat_ind[sat-1]-1;
+            if (!(cell=cell_ind[sig_ind[sig-1]-1+k*nsig])||cell>64) continue;
+            
+            freq=msat[i].freq[j];
+            lambda=freq==0.0?0.0:CLIGHT/freq;
+            psrng_s=data->P[j]==0.0?0.0:data->P[j]-rrng[k];
+            phrng_s=data->L[j]==0.0||lambda<=0.0?0.0: data->L[j]*lambda-rrng [k];
+            rate_s =data->D[j]==0.0||lambda<=0.0?0.0:-data->D[j]*lambda-rrate[k];
+            
+            /* subtract phase - psudorange integer cycle offset */
+            LLI=data->LLI[j];
+            if ((LLI&1)||fabs(phrng_s-enc->cp[data->sat-1][j])>1171.0) {
+                enc->cp[data->sat-1][j]=ROUND(phrng_s/lambda)*lambda;
+                LLI|=1;
+            }
+            phrng_s-=enc->cp[data->sat-1][j];
+            
+            if (psrng_s!=0.0) psrng[cell-1]=psrng_s;
+            if (phrng_s!=0.0) phrng[cell-1]=phrng_s;
+            if (rate_s !=0.0) rate [cell-1]=rate_s;
+            lock[cell-1]=locktime_d(time,enc->lltime[data->sat-1]+j,LLI);
+            half[cell-1]=(data->LLI[j]&2)?1:0;
+            cnr [cell-1]=(float)(data->SNR[j]*SNR_UNIT);
+        }
+    }
+    memset(buff,0,len+3);
+    
+    /* preamble, reserved and msm header (ref [15] table 3.5-78) */
+    i=0;
+    setbitu(buff,i, 8,RTCM3PREAMB); i+= 8;
+    setbitu(buff,i, 6,0          ); i+= 6;
+    setbitu(buff,i,10,len-3      ); i+=10;
+    setbitu(buff,i,12,type       ); i+=12; /* message number */
+    setbitu(buff,i,12,staid      ); i+=12; /* reference station id */
+    setbitu(buff,i,30,msm_epoch_time(sys,time)); i+=30; /* epoch time */
+    setbitu(buff,i, 1,sync       ); i+= 1; /* multiple message bit */
+    setbitu(buff,i, 3,enc->iod   ); i+= 3; /* issue of data station */
+    setbitu(buff,i, 7,0          ); i+= 7; /* reserved */
+    setbitu(buff,i, 2,0          ); i+= 2; /* clock streering indicator */
+    setbitu(buff,i, 2,0          ); i+= 2; /* external clock indicator */
+    setbitu(buff,i, 1,0          ); i+= 1; /* smoothing indicator */
+    setbitu(buff,i, 3,0          ); i+= 3; /* smoothing interval */
+    
+    for (j=0;j<64;j++) {
+        setbitu(buff,i,1,sat_ind[j]?1:0); i+=1; /* satellite mask */
+    }
+    for (j=0;j<32;j++) {
+        setbitu(buff,i,1,sig_ind[j]?1:0); i+=1; /* signal mask */
+    }
+    for (j=0;j<nsat*nsig&&j<64;j++) {
+        setbitu(buff,i,1,cell_ind[j]?1:0); i+=1; /* cell mask */
+    }
+    /* msm satellite data */
+    i=encode_msm_int_rrng(buff,i,rrng ,nsat); /* rough range integer ms */
+    if (ext) {
+        i=encode_msm_info(buff,i,info ,nsat); /* extended satellite info */
+    }
+    i=encode_msm_mod_rrng(buff,i,rrng ,nsat); /* rough range modulo 1 ms */
+    if (ext) {
+        i=encode_msm_rrate(buff,i,rrate,nsat); /* rough phase-range-rate */
+    }
+    /* msm signal data */
+    if (msm<6) {
+        i=encode_msm_psrng   (buff,i,psrng,ncell); /* fine pseudorange */
+        i=encode_msm_phrng   (buff,i,phrng,ncell); /* fine phase-range */
+        i=encode_msm_lock    (buff,i,lock ,ncell); /* lock-time indicator */
+        i=encode_msm_half_amb(buff,i,half ,ncell); /* half-cycle-amb indicator */
+        i=encode_msm_cnr     (buff,i,cnr  ,ncell); /* signal cnr */
+    }
+    else {
+        i=encode_msm_psrng_ex(buff,i,psrng,ncell); /* fine pseudorange ext */
+        i=encode_msm_phrng_ex(buff,i,phrng,ncell); /* fine phase-range ext */
+        i=encode_msm_lock_ex (buff,i,lock ,ncell); /* lock-time indicator ext */
+        i=encode_msm_half_amb(buff,i,half ,ncell); /* half-cycle-amb indicator */
+        i=encode_msm_cnr_ex  (buff,i,cnr  ,ncell); /* signal cnr ext */
+    }
+    if (ext) {
+        i=encode_msm_rate(buff,i,rate,ncell); /* fine phase-range-rate */
+    }
+    /* crc-24q */
+    crc=rtk_crc24q(buff,len);
+    setbitu(buff,len*8,24,crc);
+    
+    return len+3;
+}
+/* write msm of an epoch to stream ---------------------------------------------
+* encode the msm messages of one system directly from the engine epoch without
+* obs_t and rtcm_t, the phase-range offset and lock time of the signals are kept
+* in the encoder state of the stream, the satellites are binned by signal set and
+* each message is filled up to the 64 cells limit (nsat x nsig of the message),
+* the multiple message bit is set in all messages except the last one
+* args   : msm_enc_t *enc   IO  encoder state of the stream
+*          nav_t   *nav     I   navigation data (GLONASS fcn)
+*          epoch_t *epoch   I   epoch
+*          int     msg      I   msm message type (1074-1077,1084-1087,...)
+*          int     staid    I   reference station id
+*          int     sync     I   multiple message bit of the last message
+*          uint8_t *buff    IO  stream buffer
+*          int     nbyte    I   bytes in the stream buffer
+*          int     size     I   size of the stream buffer
+* return : bytes in the stream buffer (-1: buffer overflow)
+*-----------------------------------------------------------------------------*/
+extern int write_msm_epoch(msm_enc_t *enc, nav_t *nav, const epoch_t *epoch, int msg,
+                           int staid, int sync, uint8_t *buff, int nbyte, int size)
+{
+    const sat_obs_t *data;
+    msm_sat_t msat[MAX_SAT],tmp;
+    uint32_t sigs;
+    int i,j,k,m,sys,msm=msg%10,nsat=0,nmsg=0,first[MAX_SAT+1];
+    
+    if      (1074<=msg&&msg<=1077) sys=SYS_GPS;
+    else if (1084<=msg&&msg<=1087) sys=SYS_GLO;
+    else if (1094<=msg&&msg<=1097) sys=SYS_GAL;
+    else if (1104<=msg&&msg<=1107) sys=SYS_SBS;
+    else if (1114<=msg&&msg<=1117) sys=SYS_QZS;
+    else if (1124<=msg&&msg<=1127) sys=SYS_CMP;
+    else if (1134<=msg&&msg<=1137) sys=SYS_IRN;
+    else return nbyte;
+    
+    /* satellites of the system with msm signals, binned by signal set (insertion
+       sort by signal mask, epoch order within a bin) */
+    for (i=0;i<epoch->n&&i<MAX_SAT;i++) {
+        data=epoch->obs+i;
+        if (satsys(data->sat,NULL)!=sys) continue;
+        if (!(tmp.satid=to_satid(sys,data->sat))) continue;
+        tmp.idx=i;
+        tmp.fcn=fcn_glo(data->sat,nav);
+        tmp.mask=0;
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            tmp.sig[j]=to_sigid(sys,data->code[j]);
+            tmp.freq[j]=tmp.sig[j]?code2freq(sys,data->code[j],tmp.fcn-7):0.0;
+            if (tmp.sig[j]) tmp.mask|=1u<<(tmp.sig[j]-1);
+        }
+        if (!tmp.mask) continue;
+        for (k=nsat++;k>0&&msat[k-1].mask>tmp.mask;k--) msat[k]=msat[k-1];
+        msat[k]=tmp;
+    }
+    if (nsat==0) return nbyte;
+    
+    /* fill each message up to 64 cells (satellites x signals of the message) */
+    for (i=0,sigs=0;i<nsat;i++) {
+        if (i==0||msm_nsig(sigs|msat[i].mask)*(i-first[nmsg-1]+1)>64) {
+            first[nmsg++]=i;
+            sigs=0;
+        }
+        sigs|=msat[i].mask;
+    }
+    first[nmsg]=nsat;
+    
+    for (i=0;i<nmsg;i++) {
+        if ((m=encode_msm_epoch(enc,epoch,sys,msm,staid,i<nmsg-1?1:sync,msat+first[i],
+                                first[i+1]-first[i],buff+nbyte,size-nbyte))<0) {
+            return -1;
+        }
+        nbyte+=m;
+    }
+    return nbyte;
+}
 
@@ -72,6 +72,8 @@
 *                           use integer types in stdint.h
 *-----------------------------------------------------------------------------*/
 #include "ephemeris.h"
+#include "gnss_thread.h"
+#include "orbit_simd.h"
 
 #include <math.h>
 
@@ -112,6 +114,27 @@ static int eph_sel[]={ /* GPS,GLO,GAL,QZS,BDS,IRN,SBS */
     0,0,0,0,0,0,0
 };
 
+/* satellite orbit cache -------------------------------------------------------
+* one entry per satellite keyed by (sat,iode,toe) and a reference time t0, the
+* state at t0 holds position, velocity and acceleration and clock bias, drift and
+* drift rate, the satellite state of any transmission time within
+* ORBIT_CACHE_SPAN of t0 is the second order taylor extrapolation from t0
+*-----------------------------------------------------------------------------*/
+typedef struct {        /* orbit cache entry type */
+    gnss_lock_t lock;   /* entry lock (ingestion threads) */
+    int sat,iode;       /* satellite number, iode of ephemeris (0: empty) */
+    gtime_t toe;        /* toe of ephemeris */
+    gtime_t t0;         /* reference time (gpst) */
+    double rs[9];       /* position, velocity and acceleration at t0 (ecef) (m|m/s|m/s^2) */
+    double dts[3];      /* clock bias, drift and drift rate at t0 (s|s/s|s/s^2) */
+    double var;         /* position and clock error variance (m^2) */
+    uint64_t nhit,nmiss; /* statistics */
+} orbit_entry_t;
+
+struct orbit_cache_s {  /* orbit cache type */
+    orbit_entry_t data[MAXSAT];
+};
+
 /* variance by ura ephemeris -------------------------------------------------*/
 static double var_uraeph(int sys, int ura)
 {
@@ -243,6 +266,189 @@ extern void eph2pos(gtime_t time, const eph_t *eph, double *rs, double *dts, dou
     /* position and clock error variance */
     *var=var_uraeph(sys,eph->sva);
 }
+/* broadcast ephemeris to satellite position, velocity and clock ---------------
+* compute satellite position, velocity, clock bias and drift with broadcast
+* ephemeris (gps, galileo, qzss, beidou, irnss) by one solution of the kepler
+* equation
+* args   : gtime_t time     I   time (gpst)
+*          eph_t *eph       I   broadcast ephemeris
+*          double *rs       O   satellite position and velocity
+*                               {x,y,z,vx,vy,vz} (ecef) (m|m/s)
+*          double *dts      O   satellite clock bias and drift (s|s/s)
+*          double *var      O   satellite position and clock variance (m^2)
+* return : none
+* notes  : same as eph2pos() with the analytic time derivatives of the orbit
+*          and the clock (including relativity correction)
+*-----------------------------------------------------------------------------*/
+extern void eph2posvel(gtime_t time, const eph_t *eph, double *rs, double *dts, double *var)
+{
+    double tk,M,E,Ek,sinE,cosE,u,r,i,O,sin2u,cos2u,x,y,sinO,cosO,cosi,sini,mu,omge;
+    double xg,yg,zg,sino,coso,Ed,ud,rd,id,Od,xd,yd,xgd,ygd,zgd,dp,rel;
+    int j,n,sys,prn;
+    
+    trace(4,"eph2posvel: sat=%2d\n",eph->sat);
+    
+    for (j=0;j<6;j++) rs[j]=0.0;
+    dts[0]=dts[1]=*var=0.0;
+    
+    if (eph->A<=0.0) return;
+    
+    tk=timediff(time,eph->toe);
+    
+    switch ((sys=satsys(eph->sat,&prn))) {
+        case SYS_GAL: mu=MU_GAL; omge=OMGE_GAL; break;
+        case SYS_CMP: mu=MU_CMP; omge=OMGE_CMP; break;
+        default:      mu=MU_GPS; omge=OMGE;     break;
+    }
+    M=eph->M0+(sqrt(mu/(eph->A*eph->A*eph->A))+eph->deln)*tk;
+    
+    for (n=0,E=M,Ek=0.0;fabs(E-Ek)>RTOL_KEPLER&&n<MAX_ITER_KEPLER;n++) {
+        Ek=E; E-=(E-eph->e*sin(E)-M)/(1.0-eph->e*cos(E));
+    }
+    if (n>=MAX_ITER_KEPLER) {
+        trace(2,"eph2posvel: kepler iteration overflow sat=%2d\n",eph->sat);
+        return;
+    }
+    sinE=sin(E); cosE=cos(E);
+    
+    /* rates of eccentric anomaly and argument of latitude */
+    Ed=(sqrt(mu/(eph->A*eph->A*eph->A))+eph->deln)/(1.0-eph->e*cosE);
+    dp=sqrt(1.0-eph->e*eph->e)*Ed/(1.0-eph->e*cosE);
+    
+    u=atan2(sqrt(1.0-eph->e*eph->e)*sinE,cosE-eph->e)+eph->omg;
+    r=eph->A*(1.0-eph->e*cosE);
+    i=eph->i0+eph->idot*tk;
+    sin2u=sin(2.0*u); cos2u=cos(2.0*u);
+    ud=dp*(1.0+2.0*(eph->cus*cos2u-eph->cuc*sin2u));
+    rd=eph->A*eph->e*sinE*Ed+2.0*dp*(eph->crs*cos2u-eph->crc*sin2u);
+    id=eph->idot+2.0*dp*(eph->cis*cos2u-eph->cic*sin2u);
+    u+=eph->cus*sin2u+eph->cuc*cos2u;
+    r+=eph->crs*sin2u+eph->crc*cos2u;
+    i+=eph->cis*sin2u+eph->cic*cos2u;
+    x=r*cos(u); y=r*sin(u); cosi=cos(i); sini=sin(i);
+    xd=rd*cos(u)-y*ud;
+    yd=rd*sin(u)+x*ud;
+    
+    /* beidou geo satellite */
+    if (sys==SYS_CMP&&(prn<=5||prn>=59)) { /* ref [9] table 4-1 */
+        O=eph->OMG0+eph->OMGd*tk-omge*eph->toes;
+        Od=eph->OMGd;
+        sinO=sin(O); cosO=cos(O);
+        xg=x*cosO-y*cosi*sinO;
+        yg=x*sinO+y*cosi*cosO;
+        zg=y*sini;
+        xgd=xd*cosO-yd*cosi*sinO+y*sini*sinO*id-yg*Od;
+        ygd=xd*sinO+yd*cosi*cosO-y*sini*cosO*id+xg*Od;
+        zgd=yd*sini+y*cosi*id;
+        sino=sin(omge*tk); coso=cos(omge*tk);
+        rs[0]= xg*coso+yg*sino*COS_5+zg*sino*SIN_5;
+        rs[1]=-xg*sino+yg*coso*COS_5+zg*coso*SIN_5;
+        rs[2]=-yg*SIN_5+zg*COS_5;
+        rs[3]= xgd*coso+ygd*sino*COS_5+zgd*sino*SIN_5+omge*rs[1];
+        rs[4]=-xgd*sino+ygd*coso*COS_5+zgd*coso*SIN_5-omge*rs[0];
+        rs[5]=-ygd*SIN_5+zgd*COS_5;
+    }
+    else {
+        O=eph->OMG0+(eph->OMGd-omge)*tk-omge*eph->toes;
+        Od=eph->OMGd-omge;
+        sinO=sin(O); cosO=cos(O);
+        rs[0]=x*cosO-y*cosi*sinO;
+        rs[1]=x*sinO+y*cosi*cosO;
+        rs[2]=y*sini;
+        rs[3]=xd*cosO-yd*cosi*sinO+y*sini*sinO*id-rs[1]*Od;
+        rs[4]=xd*sinO+yd*cosi*cosO-y*sini*cosO*id+rs[0]*Od;
+        rs[5]=yd*sini+y*cosi*id;
+    }
+    tk=timediff(time,eph->toc);
+    dts[0]=eph->f0+eph->f1*tk+eph->f2*tk*tk;
+    dts[1]=eph->f1+2.0*eph->f2*tk;
+    
+    /* relativity correction */
+    rel=2.0*sqrt(mu*eph->A)*eph->e/SQR(CLIGHT);
+    dts[0]-=rel*sinE;
+    dts[1]-=rel*cosE*Ed;
+    
+    /* position and clock error variance */
+    *var=var_uraeph(sys,eph->sva);
+}
+/* broadcast ephemeris to satellite positions, velocities and clocks -----------
+* compute satellite positions, velocities, clock biases and drifts of the
+* satellites of an epoch with broadcast ephemerides, refer eph2posvel()
+* args   : int    n         I   number of satellites
+*          gtime_t *time    I   times (gpst) {time1,time2,...}
+*          eph_t  **eph     I   broadcast ephemerides {eph1,eph2,...} (NULL: none)
+*          double *rs       O   satellite positions and velocities
+*                               {x,y,z,vx,vy,vz} x n (ecef) (m|m/s)
+*          double *dts      O   satellite clock biases and drifts
+*                               {bias,drift} x n (s|s/s)
+*          double *var      O   satellite position and clock variances (m^2)
+* return : none
+* notes  : the satellites are processed in batches of ORBIT_SOA_MAX with the
+*          fastest kernel of orbit_soa_compute(), a satellite without a valid
+*          ephemeris or without convergence of the kepler equation gets zero
+*          outputs
+*-----------------------------------------------------------------------------*/
+extern void eph2posvels(int n, const gtime_t *time, const eph_t **eph, double *rs, double *dts, double *var)
+{
+    orbit_soa_t b;
+    const eph_t *p;
+    int i,j,k,m,sys,prn,ok[ORBIT_SOA_MAX],kernel=orbit_simd_kernel();
+    
+    trace(4,"eph2posvels: n=%d\n",n);
+    
+    for (i=0;i<n;i+=ORBIT_SOA_MAX) {
+        m=n-i<ORBIT_SOA_MAX?n-i:ORBIT_SOA_MAX;
+        
+        /* gather ephemerides of the batch, circular dummy orbit without ephemeris */
+        for (j=0;j<m;j++) {
+            p=eph[i+j];
+            ok[j]=p&&p->A>0.0;
+            sys=ok[j]?satsys(p->sat,&prn):SYS_NONE;
+            b.geo[j]=sys==SYS_CMP&&(prn<=5||prn>=59)?1.0:0.0; /* ref [9] table 4-1 */
+            switch (sys) {
+                case SYS_GAL: b.mu[j]=MU_GAL; b.omge[j]=OMGE_GAL; break;
+                case SYS_CMP: b.mu[j]=MU_CMP; b.omge[j]=OMGE_CMP; break;
+                default:      b.mu[j]=MU_GPS; b.omge[j]=OMGE;     break;
+            }
+            if (!ok[j]) {
+                b.tk[j]=b.tc[j]=b.e[j]=b.M0[j]=b.deln[j]=0.0;
+                b.A[j]=1.0;
+                b.omg[j]=b.i0[j]=b.idot[j]=b.OMG0[j]=b.OMGd[j]=b.toes[j]=0.0;
+                b.cuc[j]=b.cus[j]=b.crc[j]=b.crs[j]=b.cic[j]=b.cis[j]=0.0;
+                b.f0[j]=b.f1[j]=b.f2[j]=0.0;
+                var[i+j]=0.0;
+                continue;
+            }
+            b.tk[j]=timediff(time[i+j],p->toe);
+            b.tc[j]=timediff(time[i+j],p->toc);
+            b.A[j]=p->A; b.e[j]=p->e; b.M0[j]=p->M0; b.deln[j]=p->deln;
+            b.omg[j]=p->omg; b.i0[j]=p->i0; b.idot[j]=p->idot;
+            b.OMG0[j]=p->OMG0; b.OMGd[j]=p->OMGd; b.toes[j]=p->toes;
+            b.cuc[j]=p->cuc; b.cus[j]=p->cus; b.crc[j]=p->crc;
+            b.crs[j]=p->crs; b.cic[j]=p->cic; b.cis[j]=p->cis;
+            b.f0[j]=p->f0; b.f1[j]=p->f1; b.f2[j]=p->f2;
+            var[i+j]=var_uraeph(sys,p->sva);
+        }
+        b.n=m;
+        
+        orbit_soa_compute(&b,kernel);
+        
+        /* scatter */
+        for (j=0;j<m;j++) {
+            if (!ok[j]||!b.ok[j]) {
+                if (ok[j]) {
+                    trace(2,"eph2posvels: kepler iteration overflow sat=%2d\n",eph[i+j]->sat);
+                }
+                for (k=0;k<6;k++) rs[k+(i+j)*6]=0.0;
+                dts[(i+j)*2]=dts[1+(i+j)*2]=var[i+j]=0.0;
+                continue;
+            }
+            for (k=0;k<6;k++) rs[k+(i+j)*6]=b.rs[k][j];
+            dts[  (i+j)*2]=b.dts[0][j];
+            dts[1+(i+j)*2]=b.dts[1][j];
+        }
+    }
+}
 /* glonass orbit differential equations --------------------------------------*/
 static void deq(const double *x, double *xdot, const double *acc)
 {
@@ -273,6 +479,21 @@ static void glorbit(double t, double *x, const double *acc)
     deq(w,k4,acc);
     for (i=0;i<6;i++) x[i]+=(k1[i]+2.0*k2[i]+2.0*k3[i]+k4[i])*t/6.0;
 }
+/* glonass position and velocity at t (s) from toe -------------------------*/
+static void glostate(double t, const geph_t *geph, double *x)
+{
+    double tt;
+    int i;
+    
+    for (i=0;i<3;i++) {
+        x[i  ]=geph->pos[i];
+        x[i+3]=geph->vel[i];
+    }
+    for (tt=t<0.0?-TSTEP:TSTEP;fabs(t)>1E-9;t-=tt) {
+        if (fabs(t)<TSTEP) tt=t;
+        glorbit(tt,x,geph->acc);
+    }
+}
 /* glonass ephemeris to satellite clock bias -----------------------------------
 * compute satellite clock bias with glonass ephemeris
 * args   : gtime_t time     I   time by satellite clock (gpst)
@@ -306,7 +527,7 @@ extern double geph2clk(gtime_t time, const geph_t *geph)
 *-----------------------------------------------------------------------------*/
 extern void geph2pos(gtime_t time, const geph_t *geph, double *rs, double *dts, double *var)
 {
-    double t,tt,x[6];
+    double t,x[6];
     int i;
     
     trace(4,"geph2pos: time=%s sat=%2d\n",time_str(time,3),geph->sat);
@@ -315,78 +536,303 @@ extern void geph2pos(gtime_t time, const geph_t *geph, double *rs, double *dts,
     
     *dts=-geph->taun+geph->gamn*t;
     
+    glostate(t,geph,x);
+    
+    for (i=0;i<3;i++) rs[i]=x[i];
+    
+    *var=SQR(ERREPH_GLO);
+}
+/* glonass orbit fit at t (s) from start of fit -----------------------------*/
+static int fiteval(const glofit_t *fit, double t, double *rs)
+{
+    const double *c;
+    double L=fit->tseg,x,T[GLOFIT_NDEG+1],dT[GLOFIT_NDEG+1],ddT[GLOFIT_NDEG+1];
+    int i,j,m;
+    
+    if (fit->n<=0||t<0.0||t>fit->n*L) return 0;
+    
+    if ((m=(int)(t/L))>=fit->n) m=fit->n-1;
+    x=2.0*(t-m*L)/L-1.0;
+    
+    /* chebyshev polynomials and their derivatives */
+    T[0]=1.0; dT[0]=0.0; ddT[0]=0.0;
+    T[1]=x;   dT[1]=1.0; ddT[1]=0.0;
+    for (j=2;j<=GLOFIT_NDEG;j++) {
+        T  [j]=2.0*x*T[j-1]-T[j-2];
+        dT [j]=2.0*T[j-1]+2.0*x*dT[j-1]-dT[j-2];
+        ddT[j]=4.0*dT[j-1]+2.0*x*ddT[j-1]-ddT[j-2];
+    }
     for (i=0;i<3;i++) {
-        x[i  ]=geph->pos[i];
-        x[i+3]=geph->vel[i];
+        c=fit->c[m][i];
+        rs[i]=rs[i+3]=rs[i+6]=0.0;
+        for (j=0;j<=GLOFIT_NDEG;j++) {
+            rs[i  ]+=c[j]*T[j];
+            rs[i+3]+=c[j]*dT[j];
+            rs[i+6]+=c[j]*ddT[j];
+        }
+        rs[i+3]*=2.0/L;
+        rs[i+6]*=4.0/(L*L);
     }
-    for (tt=t<0.0?-TSTEP:TSTEP;fabs(t)>1E-9;t-=tt) {
-        if (fabs(t)<TSTEP) tt=t;
-        glorbit(tt,x,geph->acc);
+    return 1;
+}
+/* fit glonass orbit -----------------------------------------------------------
+* integrate the GLONASS orbit of the ephemeris once over its validity window and
+* fit piecewise chebyshev polynomials to the positions
+* args   : geph_t *geph     I   GLONASS ephemeris
+*          glofit_t *fit    O   orbit fit
+* return : status (1:ok,0:error)
+* notes  : the window is toe +/- (MAXDTOE_GLO+GLOFIT_MARGIN) in GLOFIT_NSEG
+*          segments with polynomials of degree GLOFIT_NDEG fitted at the
+*          chebyshev nodes of the segments.
+*          fit->err is the max deviation of the fit from the integrated orbit
+*          (geph2pos) at 4*GLOFIT_NDEG+1 check points over the window, a fit with
+*          err > GLOFIT_MAXERR is rejected (fit->n=0).
+*          with 2 segments of degree 10 the deviation is below 0.1 mm, the level
+*          of the RK4 step error of the integration itself, and the deviation of
+*          the analytic velocity from the integrated velocity is below 0.1 mm/s.
+*-----------------------------------------------------------------------------*/
+extern int gephfit(const geph_t *geph, glofit_t *fit)
+{
+    double f[3][GLOFIT_NDEG+1],x[6],rs[9],t0,t,d,err;
+    int i,j,k,m,nchk=4*GLOFIT_NDEG;
+    
+    trace(4,"gephfit : sat=%2d\n",geph->sat);
+    
+    t0=-(MAXDTOE_GLO+GLOFIT_MARGIN); /* start of fit from toe (s) */
+    fit->n=GLOFIT_NSEG;
+    fit->ts=timeadd(geph->toe,t0);
+    fit->tseg=-2.0*t0/GLOFIT_NSEG;
+    
+    for (m=0;m<fit->n;m++) {
+        
+        /* integrated orbit at chebyshev nodes */
+        for (k=0;k<=GLOFIT_NDEG;k++) {
+            t=t0+fit->tseg*(m+0.5*(1.0+cos(PI*(k+0.5)/(GLOFIT_NDEG+1))));
+            glostate(t,geph,x);
+            for (i=0;i<3;i++) f[i][k]=x[i];
+        }
+        for (i=0;i<3;i++) for (j=0;j<=GLOFIT_NDEG;j++) {
+            for (k=0,d=0.0;k<=GLOFIT_NDEG;k++) {
+                d+=f[i][k]*cos(PI*j*(k+0.5)/(GLOFIT_NDEG+1));
+            }
+            fit->c[m][i][j]=(j==0?1.0:2.0)*d/(GLOFIT_NDEG+1);
+        }
     }
-    for (i=0;i<3;i++) rs[i]=x[i];
+    /* deviation from integrated orbit at check points */
+    for (k=0,fit->err=0.0;k<=nchk;k++) {
+        t=-2.0*t0*k/nchk;
+        glostate(t0+t,geph,x);
+        fiteval(fit,t,rs);
+        for (i=0,err=0.0;i<3;i++) err+=SQR(rs[i]-x[i]);
+        if ((err=sqrt(err))>fit->err) fit->err=err;
+    }
+    if (fit->err>GLOFIT_MAXERR) {
+        trace(2,"glonass orbit fit error: sat=%2d err=%.4f\n",geph->sat,fit->err);
+        fit->n=0;
+        return 0;
+    }
+    return 1;
+}
+/* glonass ephemeris to satellite position and clock by orbit fit --------------
+* compute satellite position, velocity and clock from the orbit fit of the
+* GLONASS ephemeris
+* args   : gtime_t time     I   time (gpst)
+*          geph_t *geph     I   GLONASS ephemeris
+*          glofit_t *fit    I   orbit fit of the ephemeris (gephfit())
+*          double *rs       O   satellite position and velocity {x,y,z,vx,vy,vz}
+*                               (ecef) (m|m/s)
+*          double *dts      O   satellite clock bias and drift (s|s/s)
+*          double *var      O   satellite position and clock variance (m^2)
+* return : status (1:ok,0:time out of the fit window)
+* notes  : the velocity is the analytic derivative of the fit
+*-----------------------------------------------------------------------------*/
+extern int glofit2pos(gtime_t time, const geph_t *geph, const glofit_t *fit, double *rs, double *dts, double *var)
+{
+    double r[9],t;
+    int i;
+    
+    trace(4,"glofit2pos: sat=%2d\n",geph->sat);
+    
+    if (!fiteval(fit,timediff(time,fit->ts),r)) return 0;
+    
+    t=timediff(time,geph->toe);
     
+    for (i=0;i<6;i++) rs[i]=r[i];
+    dts[0]=-geph->taun+geph->gamn*t;
+    dts[1]=geph->gamn;
     *var=SQR(ERREPH_GLO);
+    return 1;
+}
+/* select ephemeris in the sets of a satellite ------------------------------*/
+static const eph_t *selset(const ephset_t *set, gtime_t time, int iode, int code,
+                           int aod, double tmax, double *tmin)
+{
+    const eph_t *eph,*sel=NULL;
+    double t;
+    int i;
+    
+    for (i=0;i<set->n;i++) { /* latest first */
+        eph=set->data+(set->head-i+MAXEPHSET)%MAXEPHSET;
+        if (iode>=0&&eph->iode!=iode) continue;
+        if (code&&!(eph->code&code)) continue;
+        if (aod&&timediff(eph->toe,time)>=0.0) continue; /* AOD<=0 */
+        if ((t=fabs(timediff(eph->toe,time)))>tmax) continue;
+        if (iode>=0) return eph;
+        if (t<*tmin) {sel=eph; *tmin=t;} /* toe closest to time */
+    }
+    return sel;
 }
 /* select ephememeris --------------------------------------------------------*/
 static const eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
 {
-    double t,tmax,tmin;
-    int i,j=-1,sys,sel;
+    const eph_t *eph=NULL,*fnav;
+    double tmax,tmin;
+    int sys,sel,prn;
     
     trace(4,"seleph  : time=%s sat=%2d iode=%d\n",time_str(time,3),sat,iode);
     
-    sys=satsys(sat,NULL);
+    sys=satsys(sat,&prn);
     switch (sys) {
         case SYS_GPS: tmax=MAXDTOE+1.0    ; sel=eph_sel[0]; break;
         case SYS_GAL: tmax=MAXDTOE_GAL    ; sel=eph_sel[2]; break;
         case SYS_QZS: tmax=MAXDTOE_QZS+1.0; sel=eph_sel[3]; break;
         case SYS_CMP: tmax=MAXDTOE_CMP+1.0; sel=eph_sel[4]; break;
         case SYS_IRN: tmax=MAXDTOE_IRN+1.0; sel=eph_sel[5]; break;
+        case SYS_NONE: return NULL;
         default: tmax=MAXDTOE+1.0; break;
     }
     tmin=tmax+1.0;
     
-    for (i=0;i<nav->n;i++) {
-        if (nav->eph[i].sat!=sat) continue;
-        if (iode>=0&&nav->eph[i].iode!=iode) continue;
-        if (sys==SYS_GAL) {
-            sel=getseleph(SYS_GAL);
-            if (sel==0&&!(nav->eph[i].code&(1<<9))) continue; /* I/NAV */
-            if (sel==1&&!(nav->eph[i].code&(1<<8))) continue; /* F/NAV */
-            if (timediff(nav->eph[i].toe,time)>=0.0) continue; /* AOD<=0 */
+    if (sys!=SYS_GAL) {
+        eph=selset(nav->ephs+sat-1,time,iode,0,0,tmax,&tmin);
+    }
+    else { /* I/NAV sets by satellite, F/NAV sets by prn */
+        if (sel!=1) {
+            eph=selset(nav->ephs+sat-1,time,iode,sel==0?1<<9:0,1,tmax,&tmin);
+        }
+        if (sel!=0&&!(iode>=0&&eph)) {
+            fnav=selset(nav->ephf+prn-1,time,iode,sel==1?1<<8:0,1,tmax,&tmin);
+            if (fnav) eph=fnav;
         }
-        if ((t=fabs(timediff(nav->eph[i].toe,time)))>tmax) continue;
-        if (iode>=0) return nav->eph+i;
-        if (t<=tmin) {j=i; tmin=t;} /* toe closest to time */
     }
-    if (iode>=0||j<0) {
+    if (!eph) {
         trace(3,"no broadcast ephemeris: %s sat=%2d iode=%3d\n",
               time_str(time,0),sat,iode);
-        return NULL;
     }
-    return nav->eph+j;
+    return eph;
 }
 /* select glonass ephememeris ------------------------------------------------*/
 static const geph_t *selgeph(gtime_t time, int sat, int iode, const nav_t *nav)
 {
+    const gephset_t *set;
+    const geph_t *geph;
     double t,tmax=MAXDTOE_GLO,tmin=tmax+1.0;
-    int i,j=-1;
+    int i,j=-1,prn;
     
     trace(4,"selgeph : time=%s sat=%2d iode=%2d\n",time_str(time,3),sat,iode);
     
-    for (i=0;i<nav->ng;i++) {
-        if (nav->geph[i].sat!=sat) continue;
-        if (iode>=0&&nav->geph[i].iode!=iode) continue;
-        if ((t=fabs(timediff(nav->geph[i].toe,time)))>tmax) continue;
-        if (iode>=0) return nav->geph+i;
-        if (t<=tmin) {j=i; tmin=t;} /* toe closest to time */
+    if (satsys(sat,&prn)!=SYS_GLO) return NULL;
+    set=nav->gephs+prn-1;
+    
+    for (i=0;i<set->n;i++) { /* latest first */
+        geph=set->data+(set->head-i+MAXEPHSET)%MAXEPHSET;
+        if (iode>=0&&geph->iode!=iode) continue;
+        if ((t=fabs(timediff(geph->toe,time)))>tmax) continue;
+        if (iode>=0) return geph;
+        if (t<tmin) {j=(set->head-i+MAXEPHSET)%MAXEPHSET; tmin=t;} /* toe closest to time */
     }
     if (iode>=0||j<0) {
         trace(3,"no glonass ephemeris  : %s sat=%2d iode=%2d\n",time_str(time,0),
               sat,iode);
         return NULL;
     }
-    return nav->geph+j;
+    return set->data+j;
+}
+/* orbit fit of selected glonass ephemeris -----------------------------------*/
+static const glofit_t *selgfit(const geph_t *geph, const nav_t *nav)
+{
+    const gephset_t *set;
+    int prn,i;
+    
+    if (!nav->glofit||satsys(geph->sat,&prn)!=SYS_GLO) return NULL;
+    set=nav->gephs+prn-1;
+    i=(int)(geph-set->data);
+    if (i<0||i>=MAXEPHSET||set->fit[i].n<=0) return NULL;
+    return set->fit+i;
+}
+/* fill orbit cache entry at reference time t0 -------------------------------*/
+static void cachefill(orbit_entry_t *e, gtime_t t0, const eph_t *eph, const geph_t *geph,
+                      const glofit_t *fit)
+{
+    double rs[2][6],dts[2][2],var=0.0,h=ORBIT_CACHE_STEP,x[6],xdot[6],t;
+    int i,j;
+    
+    if (eph) {
+        /* analytic velocity of kepler orbit, acceleration by difference */
+        for (j=0;j<2;j++) {
+            eph2posvel(timeadd(t0,j*h),eph,rs[j],dts[j],&var);
+        }
+        for (i=0;i<3;i++) {
+            e->rs[i  ]=rs[0][i];
+            e->rs[i+3]=rs[0][i+3];
+            e->rs[i+6]=(rs[1][i+3]-rs[0][i+3])/h;
+        }
+        e->dts[0]=dts[0][0];
+        e->dts[1]=dts[0][1];
+        e->dts[2]=(dts[1][1]-dts[0][1])/h;
+        e->var=var;
+        e->sat=eph->sat; e->iode=eph->iode; e->toe=eph->toe;
+    }
+    else {
+        /* state vector and its derivative of glonass orbit */
+        t=timediff(t0,geph->toe);
+        if (!fit||!fiteval(fit,timediff(t0,fit->ts),e->rs)) {
+            glostate(t,geph,x);
+            deq(x,xdot,geph->acc);
+            for (i=0;i<3;i++) {
+                e->rs[i  ]=x[i];
+                e->rs[i+3]=x[i+3];
+                e->rs[i+6]=xdot[i+3];
+            }
+        }
+        e->dts[0]=-geph->taun+geph->gamn*t;
+        e->dts[1]=geph->gamn;
+        e->dts[2]=0.0;
+        e->var=SQR(ERREPH_GLO);
+        e->sat=geph->sat; e->iode=geph->iode; e->toe=geph->toe;
+    }
+    e->t0=t0;
+}
+/* satellite position and clock by orbit cache -------------------------------*/
+static void cachepos(orbit_cache_t *cache, gtime_t time, const eph_t *eph, const geph_t *geph,
+                     const glofit_t *fit, double *rs, double *dts, double *var)
+{
+    orbit_entry_t *e;
+    double dt=0.0;
+    int i,sat=eph?eph->sat:geph->sat,iode=eph?eph->iode:geph->iode;
+    gtime_t toe=eph?eph->toe:geph->toe;
+    
+    e=cache->data+sat-1;
+    
+    gnss_lock(&e->lock);
+    
+    if (e->sat!=sat||e->iode!=iode||timediff(e->toe,toe)!=0.0||
+        fabs(dt=timediff(time,e->t0))>ORBIT_CACHE_SPAN) {
+        cachefill(e,time,eph,geph,fit);
+        dt=0.0;
+        e->nmiss++;
+    }
+    else e->nhit++;
+    
+    for (i=0;i<3;i++) {
+        rs[i  ]=e->rs[i]+e->rs[i+3]*dt+0.5*e->rs[i+6]*dt*dt;
+        rs[i+3]=e->rs[i+3]+e->rs[i+6]*dt;
+    }
+    dts[0]=e->dts[0]+e->dts[1]*dt+0.5*e->dts[2]*dt*dt;
+    dts[1]=e->dts[1]+e->dts[2]*dt;
+    *var=e->var;
+    
+    gnss_unlock(&e->lock);
 }
 /* satellite clock with broadcast ephemeris ----------------------------------*/
 static int ephclk(gtime_t time, gtime_t teph, int sat, const nav_t *nav, double *dts)
@@ -416,6 +862,7 @@ static int ephpos(gtime_t time, gtime_t teph, int sat, const nav_t *nav, int iod
 {
     const eph_t  *eph;
     const geph_t *geph;
+    const glofit_t *fit;
     double rst[3],dtst[1],tt=1E-3;
     int i,sys;
     
@@ -427,13 +874,27 @@ static int ephpos(gtime_t time, gtime_t teph, int sat, const nav_t *nav, int iod
     
     if (sys==SYS_GPS||sys==SYS_GAL||sys==SYS_QZS||sys==SYS_CMP||sys==SYS_IRN) {
         if (!(eph=seleph(teph,sat,iode,nav))) return 0;
-        eph2pos(time,eph,rs,dts,var);
-        time=timeadd(time,tt);
-        eph2pos(time,eph,rst,dtst,var);
+        if (nav->orbc) {
+            cachepos(nav->orbc,time,eph,NULL,NULL,rs,dts,var);
+            *svh=eph->svh;
+            return 1;
+        }
+        eph2posvel(time,eph,rs,dts,var);
         *svh=eph->svh;
+        return 1;
     }
     else if (sys==SYS_GLO) {
         if (!(geph=selgeph(teph,sat,iode,nav))) return 0;
+        fit=selgfit(geph,nav);
+        if (nav->orbc) {
+            cachepos(nav->orbc,time,NULL,geph,fit,rs,dts,var);
+            *svh=geph->svh;
+            return 1;
+        }
+        if (fit&&glofit2pos(time,geph,fit,rs,dts,var)) {
+            *svh=geph->svh;
+            return 1;
+        }
         geph2pos(time,geph,rs,dts,var);
         time=timeadd(time,tt);
         geph2pos(time,geph,rst,dtst,var);
@@ -600,9 +1061,10 @@ extern int satpos(gtime_t time, gtime_t teph, int sat, int ephopt, const nav_t *
 *-----------------------------------------------------------------------------*/
 extern void satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav, int ephopt, double *rs, double *dts, double *var, int *svh)
 {
-    gtime_t time[2*MAXOBS]={{0}};
-    double dt,pr;
-    int i,j;
+    gtime_t time[2*MAXOBS]={{0}},tb[2*MAXOBS];
+    const eph_t *eb[2*MAXOBS];
+    double dt,pr,rb[2*MAXOBS*6],db[2*MAXOBS*2],vb[2*MAXOBS];
+    int i,j,k,ib[2*MAXOBS],nb=0,sys;
     
     trace(3,"satposs : teph=%s n=%d ephopt=%d\n",time_str(teph,3),n,ephopt);
     
@@ -628,6 +1090,20 @@ extern void satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav, in
         }
         time[i]=timeadd(time[i],-dt);
         
+        /* broadcast orbits without orbit cache computed in a batch */
+        sys=satsys(obs[i].sat,NULL);
+        if (ephopt==EPHOPT_BRDC&&!nav->orbc&&
+            (sys==SYS_GPS||sys==SYS_GAL||sys==SYS_QZS||sys==SYS_CMP||sys==SYS_IRN)) {
+            if (!(eb[nb]=seleph(teph,obs[i].sat,-1,nav))) {
+                trace(3,"no ephemeris %s sat=%2d\n",time_str(time[i],3),obs[i].sat);
+                svh[i]=-1;
+                continue;
+            }
+            svh[i]=eb[nb]->svh;
+            tb[nb]=time[i];
+            ib[nb++]=i;
+            continue;
+        }
         /* satellite position and clock at transmission time */
         if (!satpos(time[i],teph,obs[i].sat,ephopt,nav,rs+i*6,dts+i*2,var+i,
                     svh+i)) {
@@ -641,6 +1117,23 @@ extern void satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav, in
             *(var+i)=SQR(STD_BRDCCLK);
         }
     }
+    if (nb>0) {
+        eph2posvels(nb,tb,eb,rb,db,vb);
+        
+        for (k=0;k<nb;k++) {
+            i=ib[k];
+            for (j=0;j<6;j++) rs[j+i*6]=rb[j+k*6];
+            for (j=0;j<2;j++) dts[j+i*2]=db[j+k*2];
+            var[i]=vb[k];
+            
+            /* if no precise clock available, use broadcast clock instead */
+            if (dts[i*2]==0.0) {
+                if (!ephclk(time[i],teph,obs[i].sat,nav,dts+i*2)) continue;
+                dts[1+i*2]=0.0;
+                *(var+i)=SQR(STD_BRDCCLK);
+            }
+        }
+    }
     for (i=0;i<n&&i<2*MAXOBS;i++) {
         trace(4,"%s sat=%2d rs=%13.3f %13.3f %13.3f dts=%12.3f var=%7.3f svh=%02X\n",
               time_str(time[i],6),obs[i].sat,rs[i*6],rs[1+i*6],rs[2+i*6],
@@ -689,3 +1182,128 @@ extern int getseleph(int sys)
     }
     return 0;
 }
+/* add broadcast ephemeris ----------------------------------------------------
+* Add a broadcast ephemeris to the ephemeris sets of the satellite and set it as
+* the latest ephemeris of the satellite.
+* args   : nav_t  *nav      IO  navigation data
+*          eph_t  *eph      I   broadcast ephemeris (GPS,GAL,QZS,BDS,IRN)
+* return : status (1:ok,0:error)
+* notes  : the sets of a satellite keep the MAXEPHSET sets received last, a set
+*          with the same iode and toe as a stored set replaces the stored set.
+*          Galileo F/NAV (code bit 8) is kept apart from I/NAV in nav->ephf.
+*-----------------------------------------------------------------------------*/
+extern int addeph(nav_t *nav, const eph_t *eph)
+{
+    ephset_t *set;
+    eph_t *p;
+    int i,prn,sys,fnav;
+    
+    sys=satsys(eph->sat,&prn);
+    if (sys==SYS_NONE||sys==SYS_GLO) return 0;
+    
+    fnav=sys==SYS_GAL&&(eph->code&(1<<8));
+    
+    nav->eph[fnav?MAXSAT+prn-1:eph->sat-1]=*eph;
+    nav->n=MAX_SAT_EPH;
+    
+    set=fnav?nav->ephf+prn-1:nav->ephs+eph->sat-1;
+    
+    for (i=0;i<set->n;i++) {
+        p=set->data+(set->head-i+MAXEPHSET)%MAXEPHSET;
+        if (p->iode==eph->iode&&timediff(p->toe,eph->toe)==0.0) {
+            *p=*eph;
+            return 1;
+        }
+    }
+    set->head=(set->head+1)%MAXEPHSET;
+    set->data[set->head]=*eph;
+    if (set->n<MAXEPHSET) set->n++;
+    return 1;
+}
+/* orbit fit of glonass ephemeris set ----------------------------------------*/
+static void setgfit(const nav_t *nav, const geph_t *geph, glofit_t *fit)
+{
+    if (nav->glofit) gephfit(geph,fit); else fit->n=0;
+}
+/* add glonass broadcast ephemeris ---------------------------------------------
+* Add a GLONASS broadcast ephemeris to the ephemeris sets of the satellite and
+* set it as the latest ephemeris of the satellite, refer addeph().
+* With nav->glofit, the orbit of a new set is fitted by gephfit() and the fit
+* serves the satellite positions of the set.
+* args   : nav_t  *nav      IO  navigation data
+*          geph_t *geph     I   GLONASS broadcast ephemeris
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+extern int addgeph(nav_t *nav, const geph_t *geph)
+{
+    gephset_t *set;
+    geph_t *p;
+    int i,j,prn,refit;
+    
+    if (satsys(geph->sat,&prn)!=SYS_GLO) return 0;
+    
+    nav->geph[prn-1]=*geph;
+    nav->ng=MAX_GLO_EPH;
+    
+    set=nav->gephs+prn-1;
+    
+    for (i=0;i<set->n;i++) {
+        j=(set->head-i+MAXEPHSET)%MAXEPHSET;
+        p=set->data+j;
+        if (p->iode==geph->iode&&timediff(p->toe,geph->toe)==0.0) {
+            refit=memcmp(p->pos,geph->pos,sizeof(p->pos))||
+                  memcmp(p->vel,geph->vel,sizeof(p->vel))||
+                  memcmp(p->acc,geph->acc,sizeof(p->acc));
+            *p=*geph;
+            if (refit||(nav->glofit&&set->fit[j].n<=0)) setgfit(nav,p,set->fit+j);
+            return 1;
+        }
+    }
+    set->head=(set->head+1)%MAXEPHSET;
+    set->data[set->head]=*geph;
+    setgfit(nav,set->data+set->head,set->fit+set->head);
+    if (set->n<MAXEPHSET) set->n++;
+    return 1;
+}
+/* create orbit cache ----------------------------------------------------------
+* create satellite orbit cache, set it to nav->orbc to use it in satposs()
+* args   : none
+* return : orbit cache (NULL: no memory)
+*-----------------------------------------------------------------------------*/
+extern orbit_cache_t *orbit_cache_new(void)
+{
+    orbit_cache_t *cache;
+    int i;
+    
+    if (!(cache=(orbit_cache_t *)calloc(1,sizeof(orbit_cache_t)))) return NULL;
+    
+    for (i=0;i<MAXSAT;i++) gnss_lock_init(&cache->data[i].lock);
+    return cache;
+}
+/* free orbit cache ----------------------------------------------------------*/
+extern void orbit_cache_free(orbit_cache_t *cache)
+{
+    int i;
+    
+    if (!cache) return;
+    for (i=0;i<MAXSAT;i++) gnss_lock_free(&cache->data[i].lock);
+    free(cache);
+}
+/* orbit cache statistics ------------------------------------------------------
+* args   : orbit_cache_t *cache I orbit cache
+*          uint64_t *nhit   O   number of states extrapolated from the cache
+*          uint64_t *nmiss  O   number of states computed from the ephemeris
+*-----------------------------------------------------------------------------*/
+extern void orbit_cache_stat(orbit_cache_t *cache, uint64_t *nhit, uint64_t *nmiss)
+{
+    int i;
+    
+    *nhit=*nmiss=0;
+    if (!cache) return;
+    for (i=0;i<MAXSAT;i++) {
+        gnss_lock(&cache->data[i].lock);
+        *nhit +=cache->data[i].nhit;
+        *nmiss+=cache->data[i].nmiss;
+        gnss_unlock(&cache->data[i].lock);
+    }
+}
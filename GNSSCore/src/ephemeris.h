@@ -37,16 +37,33 @@ extern "C" {
 #define EPHOPT_SSRAPC 3                 /* ephemeris option: broadcast + SSR_APC */
 #define EPHOPT_SSRCOM 4                 /* ephemeris option: broadcast + SSR_COM */
 
+#define ORBIT_CACHE_SPAN 0.5            /* max extrapolation of cached satellite state (s) */
+#define ORBIT_CACHE_STEP 0.1            /* step of numerical derivatives of cached state (s) */
+
+#define GLOFIT_MARGIN 60.0              /* margin of GLONASS orbit fit beyond MAXDTOE_GLO (s) */
+#define GLOFIT_MAXERR 0.01              /* max deviation of GLONASS orbit fit from integration (m) */
+
 
 /* ephemeris and clock functions ---------------------------------------------*/
 EXPORT double eph2clk (gtime_t time, const eph_t  *eph);
 EXPORT double geph2clk(gtime_t time, const geph_t *geph);
 EXPORT void eph2pos (gtime_t time, const eph_t  *eph,  double *rs, double *dts, double *var);
+EXPORT void eph2posvel (gtime_t time, const eph_t *eph, double *rs, double *dts, double *var);
+EXPORT void eph2posvels(int n, const gtime_t *time, const eph_t **eph, double *rs, double *dts, double *var);
 EXPORT void geph2pos(gtime_t time, const geph_t *geph, double *rs, double *dts, double *var);
+EXPORT int  gephfit (const geph_t *geph, glofit_t *fit);
+EXPORT int  glofit2pos(gtime_t time, const geph_t *geph, const glofit_t *fit, double *rs, double *dts, double *var);
 EXPORT int  satpos(gtime_t time, gtime_t teph, int sat, int ephopt, const nav_t *nav, double *rs, double *dts, double *var, int *svh);
 EXPORT void satposs(gtime_t time, const obsd_t *obs, int n, const nav_t *nav, int sateph, double *rs, double *dts, double *var, int *svh);
 EXPORT void setseleph(int sys, int sel);
 EXPORT int  getseleph(int sys);
+EXPORT int  addeph (nav_t *nav, const eph_t  *eph);
+EXPORT int  addgeph(nav_t *nav, const geph_t *geph);
+
+/* satellite orbit cache, set nav->orbc to share the broadcast orbits of the epoch by all stations */
+EXPORT orbit_cache_t *orbit_cache_new(void);
+EXPORT void orbit_cache_free(orbit_cache_t *cache);
+EXPORT void orbit_cache_stat(orbit_cache_t *cache, uint64_t *nhit, uint64_t *nmiss);
 
 #ifdef __cplusplus
 }
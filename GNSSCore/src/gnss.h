@@ -9,6 +9,8 @@
 #include <stdarg.h>
 #include <stdlib.h>
 
+#include "gnss_obs.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -478,6 +480,33 @@ typedef struct
 
 #define MAX_SAT_EPH MAXSAT+NSATGAL
 #define MAX_GLO_EPH NSATGLO
+#define MAXEPHSET   4                   /* max ephemeris sets kept per satellite */
+
+typedef struct {        /* recent ephemeris sets of a satellite (ring buffer) */
+    int n;              /* number of sets */
+    int head;           /* ring index of the latest set */
+    eph_t data[MAXEPHSET];
+} ephset_t;
+
+#define GLOFIT_NSEG 2                   /* number of segments of GLONASS orbit fit */
+#define GLOFIT_NDEG 10                  /* degree of chebyshev polynomials of GLONASS orbit fit */
+
+typedef struct {        /* GLONASS orbit fit type (piecewise chebyshev polynomials) */
+    int n;              /* number of segments (0: no fit) */
+    gtime_t ts;         /* start time of fit (gpst) */
+    double tseg;        /* length of segment (s) */
+    double err;         /* max deviation from integrated orbit at check points (m) */
+    double c[GLOFIT_NSEG][3][GLOFIT_NDEG+1]; /* coefficients of position (ecef) (m) */
+} glofit_t;
+
+typedef struct {        /* recent GLONASS ephemeris sets of a satellite (ring buffer) */
+    int n;              /* number of sets */
+    int head;           /* ring index of the latest set */
+    geph_t data[MAXEPHSET];
+    glofit_t fit[MAXEPHSET]; /* orbit fit of the sets (nav->glofit) */
+} gephset_t;
+
+typedef struct orbit_cache_s orbit_cache_t; /* satellite orbit cache (ephemeris.c) */
 
 typedef struct {        /* navigation data type */
     int n,nmax;         /* number of broadcast ephemeris */
@@ -487,8 +516,11 @@ typedef struct {        /* navigation data type */
     int nc,ncmax;       /* number of precise clock */
     int na,namax;       /* number of almanac data */
     int nt,ntmax;       /* number of tec grid data */
-    eph_t eph[MAX_SAT_EPH];         /* GPS/QZS/GAL/BDS/IRN ephemeris */
-    geph_t geph[MAX_GLO_EPH];       /* GLONASS ephemeris */
+    eph_t eph[MAX_SAT_EPH];         /* latest GPS/QZS/GAL/BDS/IRN ephemeris (sat-1, Galileo F/NAV: MAXSAT+prn-1) */
+    geph_t geph[MAX_GLO_EPH];       /* latest GLONASS ephemeris (prn-1) */
+    ephset_t ephs[MAXSAT];          /* ephemeris sets by satellite (Galileo: I/NAV) */
+    ephset_t ephf[NSATGAL];         /* Galileo F/NAV ephemeris sets by prn */
+    gephset_t gephs[MAX_GLO_EPH];   /* GLONASS ephemeris sets by prn */
     double utc_gps[8];  /* GPS delta-UTC parameters {A0,A1,Tot,WNt,dt_LS,WN_LSF,DN,dt_LSF} */
     double utc_glo[8];  /* GLONASS UTC time parameters {tau_C,tau_GPS} */
     double utc_gal[8];  /* Galileo UTC parameters */
@@ -507,6 +539,8 @@ typedef struct {        /* navigation data type */
     ssr_t ssr[MAXSAT];  /* SSR corrections */
     int ephsat;         /* input ephemeris satellite number */
     int ephset;         /* input ephemeris set (0-1) */
+    orbit_cache_t *orbc; /* orbit cache shared by all stations (NULL: no cache) */
+    int glofit;         /* GLONASS orbit fit at ephemeris input (0:off,1:on) */
 } nav_t;
 
 typedef struct {        /* station parameter type */
@@ -531,6 +565,19 @@ typedef struct {        /* station parameter type */
 #define MAX_OBS_BUF 3
 #endif
 
+typedef struct {        /* RTCM per-station decode context type */
+    int staid;          /* station id */
+    gtime_t time;       /* last message time */
+    double cp[MAXSAT][NFREQ+NEXOBS]; /* carrier-phase measurement (1002/1004) */
+    uint16_t lock[MAXSAT][NFREQ+NEXOBS]; /* lock time indicator (msm) */
+} rtcm_ctx_t;
+
+typedef struct {        /* RTCM MSM encoder state of an output stream type */
+    int iod;            /* issue of data station */
+    double cp[MAXSAT][NFREQ+NEXOBS]; /* phase-range - pseudorange integer cycle offset (m) */
+    gtime_t lltime[MAXSAT][NFREQ+NEXOBS]; /* last lock time */
+} msm_enc_t;
+
 typedef struct {        /* RTCM control struct type */
     int id;
     int staid;          /* station id */
@@ -563,6 +610,8 @@ typedef struct {        /* RTCM control struct type */
     char opt[256];      /* RTCM dependent options */
     int mark;
     int type;
+    rtcm_ctx_t *ctx;    /* per-station context (NULL: use cp/lock above) */
+    gtime_t vtime;      /* virtual clock of the replay (gpst), time=0: cpu time */
 } rtcm_t;
 
 /* satellites, systems, codes functions --------------------------------------*/
@@ -675,11 +724,15 @@ EXPORT uint16_t rtk_crc16 (const uint8_t *buff, int len);
 
 int input_rtcm3(rtcm_t *rtcm, uint8_t data, nav_t *nav);
 int input_rtcm3_buff(rtcm_t *rtcm, uint8_t *buff, int nbyte, nav_t *nav);
+int input_rtcm3_frame(rtcm_t *rtcm, uint8_t *buff, int len, nav_t *nav);
+int input_rtcm3_ctx(rtcm_t *rtcm, rtcm_ctx_t *ctx, uint8_t *buff, int len, nav_t *nav);
 int check_rtcm3_type(uint8_t *buff, int nbyte, int *len, int *crc, int *staid, double* xyz);
+int check_rtcm3_head(uint8_t *buff, int *staid, double* xyz);
 int change_rtcm3_id (uint8_t *buff, int nbyte, int rcvid);
 int update_rtcm3_pos(uint8_t *buff, int nbyte, int staid, double* p);
 int write_rtcm3_msm (rtcm_t *out, nav_t *nav, int msg, int sync, uint8_t *rtcm_buff, int nbyte);
 int write_rtcm3     (rtcm_t *out, nav_t* nav, int msg, int sync, uint8_t* rtcm_buff, int nbyte);
+int write_msm_epoch (msm_enc_t *enc, nav_t *nav, const epoch_t *epoch, int msg, int staid, int sync, uint8_t *buff, int nbyte, int size);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,351 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ asynchronous data archive
+ each producer pushes complete blocks (frames, log lines) into its own byte ring, so a
+ ring read short of the requested size ends at a block boundary, the archive thread
+ empties all rings in one cycle into the batch buffer (written when full and at the
+ end of the cycle), the file hour is taken once per cycle so a block never spans two
+ files
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gnss_archive.h"
+
+/* local time (year, day of year and hour) as the file key */
+static int archive_hour(struct tm* ltm)
+{
+	time_t now = time(0);
+#ifdef _WIN32
+	localtime_s(ltm, &now);
+#else
+	localtime_r(&now, ltm);
+#endif
+	return ((ltm->tm_year * 366) + ltm->tm_yday) * 24 + ltm->tm_hour;
+}
+
+/* close the files of the hour */
+static void archive_close(archive_t* ar)
+{
+	int i = 0;
+	for (i = 0; i < ar->nseg; ++i)
+	{
+		if (ar->seg[i].fp) fclose(ar->seg[i].fp);
+	}
+	ar->nseg = 0;
+	if (ar->fp) fclose(ar->fp);
+	ar->fp = NULL;
+}
+
+/* file of the hour (index file in segment mode), start new files when the hour changes */
+static FILE* archive_open(archive_t* ar, int hour)
+{
+	struct tm ltm = { 0 };
+	char fname[128] = { 0 };
+	if (ar->fp && ar->hour != hour) archive_close(ar);
+	if (!ar->fp)
+	{
+		archive_hour(&ltm);
+		snprintf(ar->stamp, sizeof(ar->stamp), "%04d-%0d-%0d-%02d-%02d-%02d", (int)(1900 + ltm.tm_year), (int)(1 + ltm.tm_mon), (int)(ltm.tm_mday), (int)(ltm.tm_hour), (int)(ltm.tm_min), (int)(ltm.tm_sec));
+		snprintf(fname, sizeof(fname), "%s.%s", ar->stamp, ar->segment ? "idx" : ar->ext);
+		ar->fp = fopen(fname, ar->segment ? "wb" : ar->mode);
+		ar->hour = hour;
+		ar->nunflushed = 0;
+	}
+	return ar->fp;
+}
+
+/* segment file of the station, opened on its first frame of the hour */
+static archive_seg_t* archive_segment(archive_t* ar, int staid)
+{
+	archive_seg_t* seg = NULL;
+	char fname[128] = { 0 };
+	int i = 0;
+	for (i = 0; i < ar->nseg; ++i)
+	{
+		if (ar->seg[i].staid == staid) return ar->seg[i].fp ? ar->seg + i : NULL;
+	}
+	if (ar->nseg == ar->nmax)
+	{
+		seg = (archive_seg_t*)realloc(ar->seg, sizeof(archive_seg_t) * (ar->nmax + 16));
+		if (!seg) return NULL;
+		ar->seg = seg;
+		ar->nmax += 16;
+	}
+	seg = ar->seg + ar->nseg++;
+	snprintf(fname, sizeof(fname), "%s-%04d.%s", ar->stamp, staid, ar->ext);
+	seg->staid = staid;
+	seg->fp = fopen(fname, ar->mode);
+	seg->offset = 0;
+	return seg->fp ? seg : NULL;
+}
+
+/* write the batch to the file of the hour */
+static void archive_write(archive_t* ar, int hour)
+{
+	if (ar->nbatch <= 0) return;
+	if (archive_open(ar, hour))
+	{
+		fwrite(ar->batch, 1, ar->nbatch, ar->fp);
+		ar->nbyte += ar->nbatch;
+		ar->nunflushed += ar->nbatch;
+	}
+	ar->nbatch = 0;
+}
+
+/* segment mode, write the complete frames of the batch to the segment files of their
+   stations and the index, the incomplete frame at the end is kept for the next read */
+static void archive_write_frames(archive_t* ar, int hour)
+{
+	archive_idx_t rec = { 0 };
+	archive_seg_t* seg = NULL;
+	int pos = 0, len = 0;
+	FILE* fidx = NULL;
+	if (ar->nbatch <= 0) return;
+	fidx = archive_open(ar, hour);
+	while (ar->nbatch - pos >= (int)sizeof(archive_idx_t))
+	{
+		memcpy(&rec, ar->batch + pos, sizeof(archive_idx_t));
+		len = rec.len;
+		if (ar->nbatch - pos < (int)sizeof(archive_idx_t) + len) break;
+		if (fidx && (seg = archive_segment(ar, rec.staid)))
+		{
+			rec.offset = seg->offset;
+			fwrite(ar->batch + pos + sizeof(archive_idx_t), 1, len, seg->fp);
+			fwrite(&rec, sizeof(archive_idx_t), 1, fidx);
+			seg->offset += len;
+			ar->nbyte += len;
+			ar->nunflushed += len;
+		}
+		pos += (int)sizeof(archive_idx_t) + len;
+	}
+	ar->nbatch -= pos;
+	if (ar->nbatch > 0) memmove(ar->batch, ar->batch + pos, ar->nbatch);
+}
+
+/* collect the data of all rings, return the number of bytes */
+static int archive_drain(archive_t* ar)
+{
+	struct tm ltm = { 0 };
+	int i = 0, n = 0, total = 0, hour = archive_hour(&ltm);
+	for (i = 0; i < ar->nring; ++i)
+	{
+		while ((n = spsc_pop(ar->ring + i, ar->batch + ar->nbatch, ARCHIVE_BATCH_SIZE - ar->nbatch)) > 0)
+		{
+			ar->nbatch += n;
+			total += n;
+			if (ar->segment) archive_write_frames(ar, hour);
+			else if (ar->nbatch == ARCHIVE_BATCH_SIZE) archive_write(ar, hour);
+		}
+	}
+	if (!ar->segment) archive_write(ar, hour);
+	return total;
+}
+
+/* flush the file by the durability policy */
+static void archive_flush(archive_t* ar, int force)
+{
+	int64_t now = gnss_clock_ms();
+	int i = 0;
+	long ms = gnss_atomic_get(&ar->flush_ms);
+	long bytes = gnss_atomic_get(&ar->flush_bytes);
+	if (!ar->fp || ar->nunflushed == 0) return;
+	if (force || (ms <= 0 && bytes <= 0) || (ms > 0 && now - ar->flush_time >= ms) || (bytes > 0 && ar->nunflushed >= (uint64_t)bytes))
+	{
+		for (i = 0; i < ar->nseg; ++i)
+		{
+			if (ar->seg[i].fp) fflush(ar->seg[i].fp);
+		}
+		fflush(ar->fp);
+		ar->nunflushed = 0;
+		ar->flush_time = now;
+	}
+}
+
+static void archive_thread(void* arg)
+{
+	archive_t* ar = (archive_t*)arg;
+	long ms = 0;
+	while (!gnss_atomic_get(&ar->stop))
+	{
+		if (archive_drain(ar) == 0)
+		{
+			ms = gnss_atomic_get(&ar->flush_ms);
+			gnss_lock(&ar->lock);
+			gnss_atomic_set(&ar->sleeping, 1);
+			if (!gnss_atomic_get(&ar->stop)) gnss_cond_wait(&ar->cond, &ar->lock, ms > 0 && ms < ARCHIVE_POLL_MS ? (int)ms : ARCHIVE_POLL_MS);
+			gnss_atomic_set(&ar->sleeping, 0);
+			gnss_unlock(&ar->lock);
+		}
+		archive_flush(ar, 0);
+	}
+	archive_drain(ar);
+	archive_flush(ar, 1);
+}
+
+extern int archive_start(archive_t* ar, const char* ext, const char* mode, int segment, int nring, uint32_t size, int flush_ms, int flush_bytes)
+{
+	int i = 0;
+	if (gnss_atomic_get(&ar->running)) return 1;
+	if (!ar->ring)
+	{
+		if (!(ar->ring = (spsc_queue_t*)calloc(nring, sizeof(spsc_queue_t)))) return 0;
+		for (i = 0; i < nring; ++i)
+		{
+			if (!spsc_init(ar->ring + i, size))
+			{
+				archive_free(ar);
+				return 0;
+			}
+		}
+		ar->nring = nring;
+	}
+	if (!ar->batch && !(ar->batch = (uint8_t*)malloc(ARCHIVE_BATCH_SIZE))) return 0;
+	strncpy(ar->ext, ext, sizeof(ar->ext) - 1);
+	strncpy(ar->mode, mode, sizeof(ar->mode) - 1);
+	ar->segment = segment;
+	ar->fp = NULL;
+	ar->nseg = 0;
+	ar->hour = -1;
+	ar->nbatch = 0;
+	ar->nunflushed = 0;
+	ar->flush_time = gnss_clock_ms();
+	archive_set_flush(ar, flush_ms, flush_bytes);
+	gnss_atomic_set(&ar->stop, 0);
+	gnss_atomic_set(&ar->sleeping, 0);
+	gnss_lock_init(&ar->lock);
+	gnss_cond_init(&ar->cond);
+	if (!gnss_thread_create(&ar->thread, archive_thread, ar))
+	{
+		gnss_cond_free(&ar->cond);
+		gnss_lock_free(&ar->lock);
+		return 0;
+	}
+	gnss_atomic_set(&ar->running, 1); /* publish, the producers push from now on */
+	return 1;
+}
+
+extern void archive_stop(archive_t* ar)
+{
+	if (!gnss_atomic_get(&ar->running)) return;
+	gnss_atomic_set(&ar->running, 0);
+	gnss_lock(&ar->lock);
+	gnss_atomic_set(&ar->stop, 1);
+	gnss_cond_signal(&ar->cond);
+	gnss_unlock(&ar->lock);
+	gnss_thread_join(&ar->thread);
+	gnss_cond_free(&ar->cond);
+	gnss_lock_free(&ar->lock);
+	archive_close(ar);
+}
+
+extern void archive_free(archive_t* ar)
+{
+	int i = 0;
+	archive_stop(ar);
+	if (ar->ring)
+	{
+		for (i = 0; i < ar->nring; ++i) spsc_free(ar->ring + i);
+		free(ar->ring);
+	}
+	if (ar->batch) free(ar->batch);
+	if (ar->seg) free(ar->seg);
+	memset(ar, 0, sizeof(archive_t));
+}
+
+extern int archive_push(archive_t* ar, int ring, const uint8_t* data, int nbyte)
+{
+	spsc_queue_t* q = NULL;
+	int n = 0;
+	if (!gnss_atomic_get(&ar->running) || ring < 0 || ring >= ar->nring) return 0;
+	q = ar->ring + ring;
+	n = spsc_push(q, data, nbyte);
+	/* the archive thread polls, wake it early when the ring is half full */
+	if (gnss_atomic_get(&ar->sleeping) && (uint32_t)spsc_count(q) > q->size / 2)
+	{
+		gnss_lock(&ar->lock);
+		gnss_cond_signal(&ar->cond);
+		gnss_unlock(&ar->lock);
+	}
+	return n;
+}
+
+extern int archive_push_frame(archive_t* ar, int ring, int staid, int type, double time, const uint8_t* data, int nbyte)
+{
+	uint8_t buff[sizeof(archive_idx_t) + ARCHIVE_MAX_BLOCK];
+	archive_idx_t rec = { 0 };
+	if (nbyte <= 0 || nbyte > ARCHIVE_MAX_BLOCK) return 0;
+	if (time < 0.0) time = 0.0; /* unknown time, kept at the start of the index */
+	rec.sec = (uint32_t)time;
+	rec.ms = (uint16_t)((time - rec.sec) * 1000.0 + 0.5);
+	if (rec.ms >= 1000)
+	{
+		++rec.sec;
+		rec.ms -= 1000;
+	}
+	rec.type = (uint16_t)type;
+	rec.staid = (uint16_t)staid;
+	rec.len = (uint16_t)nbyte;
+	memcpy(buff, &rec, sizeof(archive_idx_t));
+	memcpy(buff + sizeof(archive_idx_t), data, nbyte);
+	return archive_push(ar, ring, buff, (int)sizeof(archive_idx_t) + nbyte) > 0 ? nbyte : 0;
+}
+
+extern void archive_set_flush(archive_t* ar, int flush_ms, int flush_bytes)
+{
+	gnss_atomic_set(&ar->flush_ms, flush_ms > 0 ? flush_ms : 0);
+	gnss_atomic_set(&ar->flush_bytes, flush_bytes > 0 ? flush_bytes : 0);
+}
+
+extern uint64_t archive_dropped(const archive_t* ar)
+{
+	uint64_t n = 0;
+	int i = 0;
+	for (i = 0; i < ar->nring; ++i) n += ar->ring[i].noverflow;
+	return n;
+}
+
+extern archive_idx_t* archive_index_load(const char* fname, int* n)
+{
+	archive_idx_t* idx = NULL;
+	FILE* fp = fopen(fname, "rb");
+	long size = 0;
+	*n = 0;
+	if (!fp) return NULL;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size >= (long)sizeof(archive_idx_t) && (idx = (archive_idx_t*)malloc(size)))
+	{
+		*n = (int)fread(idx, sizeof(archive_idx_t), size / sizeof(archive_idx_t), fp);
+	}
+	fclose(fp);
+	return idx;
+}
+
+extern void archive_index_free(archive_idx_t* idx)
+{
+	free(idx);
+}
+
+extern int archive_index_select(const archive_idx_t* idx, int n, int staid, uint32_t sec0, uint32_t sec1, int* out)
+{
+	int i = 0, m = 0;
+	for (i = 0; i < n; ++i)
+	{
+		if (staid >= 0 && idx[i].staid != staid) continue;
+		if (idx[i].sec < sec0 || (sec1 > 0 && idx[i].sec >= sec1)) continue;
+		out[m++] = i;
+	}
+	return m;
+}
+
+extern int archive_segment_name(const char* idxname, int staid, const char* ext, char* fname, int size)
+{
+	int n = (int)strlen(idxname);
+	if (n < 4 || strcmp(idxname + n - 4, ".idx") != 0) return 0;
+	return snprintf(fname, size, "%.*s-%04d.%s", n - 4, idxname, staid, ext) < size;
+}
@@ -0,0 +1,121 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ asynchronous data archive, the producers (decode threads) copy the data into their
+ own byte ring without lock or system call, one archive thread collects the rings
+ into large batches, writes them with one call per batch and starts a new file every
+ hour, the file is flushed by time or size (durability policy)
+ segment mode (rtcm archive), each frame is queued with its index record and written
+ to the segment file of its station, the index file of the hour lists the frames
+ (gps time, station, message type, offset in the segment file) so a replay reads only
+ the stations and time window it needs
+*/
+#ifndef _GNSS_ARCHIVE_H_
+#define _GNSS_ARCHIVE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+#include "gnss_queue.h"
+#include "gnss_thread.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef ARCHIVE_BATCH_SIZE
+#define ARCHIVE_BATCH_SIZE (1 << 20) /* bytes written by one call */
+#endif
+
+#ifndef ARCHIVE_POLL_MS
+#define ARCHIVE_POLL_MS 50 /* wait of the archive thread without data (ms) */
+#endif
+
+#ifndef ARCHIVE_MAX_BLOCK
+#define ARCHIVE_MAX_BLOCK 2048 /* largest frame of the segment mode (bytes) */
+#endif
+
+/* index record of a frame in segment mode, files <time>-<staid>.<ext> (segments) and
+*  <time>.idx (index), <time> is the local time of the first frame of the hour */
+typedef struct
+{
+	uint32_t sec; /* gps time of the frame, seconds since 1980/1/6 */
+	uint16_t ms; /* milliseconds of the gps time */
+	uint16_t type; /* message type */
+	uint16_t staid; /* station ID */
+	uint16_t len; /* frame bytes */
+	uint32_t offset; /* byte offset of the frame in the segment file of the station */
+}archive_idx_t;
+
+/* segment file of a station */
+typedef struct
+{
+	int staid;
+	FILE* fp;
+	uint32_t offset; /* bytes written */
+}archive_seg_t;
+
+typedef struct
+{
+	spsc_queue_t* ring; /* data of each producer */
+	int nring;
+	char ext[16]; /* file extension */
+	char mode[4]; /* file open mode ("wb": binary, "w": text) */
+	int segment; /* 1: segment files by station with index */
+	FILE* fp; /* current file (index file in segment mode) */
+	archive_seg_t* seg; /* segment files of the hour */
+	int nseg, nmax;
+	char stamp[80]; /* local time of the files of the hour */
+	int hour; /* local hour of the current file (year, day and hour) */
+	uint8_t* batch; /* data collected from the rings */
+	int nbatch;
+	uint64_t nbyte; /* bytes written */
+	uint64_t nunflushed; /* bytes written after the last flush */
+	int64_t flush_time; /* time of the last flush (ms) */
+	gnss_atomic_t flush_ms; /* flush interval (ms), 0: not used */
+	gnss_atomic_t flush_bytes; /* flush size (bytes), 0: not used, both 0: flush each batch */
+	gnss_thread_t thread;
+	gnss_atomic_t stop;
+	gnss_atomic_t running;
+	gnss_atomic_t sleeping;
+	gnss_lock_t lock;
+	gnss_cond_t cond;
+}archive_t;
+
+/* start the archive thread, nring producers with a ring of size bytes each, the files are
+*  named by the local time of creation with extension ext and opened with mode, segment=1
+*  writes the frames by station with index (archive_push_frame), the rings of a previous
+*  start are reused, return 1: ok, 0: error */
+GNSSCORE_API int  archive_start(archive_t* ar, const char* ext, const char* mode, int segment, int nring, uint32_t size, int flush_ms, int flush_bytes);
+/* stop the archive thread after the queued data are written, close the file, the rings are kept */
+GNSSCORE_API void archive_stop(archive_t* ar);
+/* stop and free the rings, no producer may be running */
+GNSSCORE_API void archive_free(archive_t* ar);
+/* producer ring, the data block is queued completely or dropped (ring full), never blocks,
+*  return bytes queued */
+GNSSCORE_API int  archive_push(archive_t* ar, int ring, const uint8_t* data, int nbyte);
+/* the same for a frame in segment mode, time is the gps time (s since 1980/1/6), negative: unknown (stored as 0) */
+GNSSCORE_API int  archive_push_frame(archive_t* ar, int ring, int staid, int type, double time, const uint8_t* data, int nbyte);
+/* durability policy, flush every flush_ms or flush_bytes (0: not used, both 0: each batch) */
+GNSSCORE_API void archive_set_flush(archive_t* ar, int flush_ms, int flush_bytes);
+/* bytes dropped by the producers (ring full) */
+GNSSCORE_API uint64_t archive_dropped(const archive_t* ar);
+
+/* replay, read the index file, return the records (free by archive_index_free), NULL: error */
+GNSSCORE_API archive_idx_t* archive_index_load(const char* fname, int* n);
+GNSSCORE_API void archive_index_free(archive_idx_t* idx);
+/* records of station staid (-1: all) within gps time [sec0, sec1) (0: open end), idx[out[i]]
+*  in file order (the order the archive thread collected the rings, not the time order of the
+*  stations), return the number of records */
+GNSSCORE_API int  archive_index_select(const archive_idx_t* idx, int n, int staid, uint32_t sec0, uint32_t sec1, int* out);
+/* segment file of station staid for the index file (<time>.idx => <time>-<staid>.<ext>),
+*  return 1: ok, 0: not an index file name or fname too small */
+GNSSCORE_API int  archive_segment_name(const char* idxname, int staid, const char* ext, char* fname, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
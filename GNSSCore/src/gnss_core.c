@@ -1,10 +1,13 @@
 #include "gnss_core.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "gmodel.h"
 #include "gtime.h"
+#include "orbit_simd.h"
+#include "rtcm_framer.h"
 
 #define TIME_TOL 0.001
 
@@ -257,7 +260,7 @@ extern int make_vrs_measurement(sat_obs_t *src_obs, sat_vec_t *src_vec, double*
 		double src_tro = tropmodel_(src_pos, src_azel, 0.7);
 		/* calculate the target/new vector information, unit vector, azimuth/elevation, and troposheric */
 		double new_dist = geodist_(new_vec[nobs].rs, new_xyz, new_vec[nobs].e);
-		satazel_(new_pos, new_vec[i].e, new_azel);
+		satazel_(new_pos, new_vec[nobs].e, new_azel);
 		double new_tro = tropmodel_(new_pos, new_azel, 0.7);
 		double dela_dist = (new_dist + new_tro) - (src_dist + src_tro);
 		double dt = dela_dist / CLIGHT;
@@ -269,7 +272,7 @@ extern int make_vrs_measurement(sat_obs_t *src_obs, sat_vec_t *src_vec, double*
 			new_vec[nobs].rs[2] = src_vec[i].rs[2] + src_vec[i].rs[5] * dt;
 
 			new_dist = geodist_(new_vec[nobs].rs, new_xyz, new_vec[nobs].e);
-			satazel_(new_pos, new_vec[i].e, new_azel);
+			satazel_(new_pos, new_vec[nobs].e, new_azel);
 			new_tro = tropmodel_(new_pos, new_azel, 0.7);
 			dela_dist = (new_dist + new_tro) - (src_dist + src_tro);
 			dt = dela_dist / CLIGHT;
@@ -295,43 +298,326 @@ extern int make_vrs_measurement(sat_obs_t *src_obs, sat_vec_t *src_vec, double*
 	return nobs;
 }
 
-static int add_sta_to_network(network_t* network, int staid)
+/* per site constants of the vrs, the saastamoinen delay (humidity 0.7) of the site is trp/sin(el)
+*  with sin(el) the up component of the line-of-sight vector, no azimuth is needed */
+typedef struct
 {
-	int index = -1, ib = 0;
-	base_t* base = network->bases + ib;
-	if (staid == 0) return index; /* ID can not be 0, and need satellites */
-	/* check existing station or not */
-	for (ib = 0, base = network->bases + ib; ib < network->nb; ++base, ++ib)
+	double xyz[3];
+	double up[3]; /* local up direction (ecef), third row of the enu rotation */
+	double trp; /* zenith delay (m) */
+}vrs_site_t;
+
+static void vrs_site(const double* xyz, vrs_site_t* site)
+{
+	const double temp0 = 15.0, humi = 0.7;
+	double pos[3] = { 0 }, hgt = 0.0, pres = 0.0, temp = 0.0, e = 0.0;
+	ecef2pos(xyz, pos);
+	memcpy(site->xyz, xyz, sizeof(double) * 3);
+	site->up[0] = cos(pos[0]) * cos(pos[1]);
+	site->up[1] = cos(pos[0]) * sin(pos[1]);
+	site->up[2] = sin(pos[0]);
+	site->trp = 0.0;
+	if (pos[2] < -100.0 || 1E4 < pos[2]) return;
+	hgt = pos[2] < 0.0 ? 0.0 : pos[2];
+	pres = 1013.25 * pow(1.0 - 2.2557E-5 * hgt, 5.2568);
+	temp = temp0 - 6.5E-3 * hgt + 273.16;
+	e = 6.108 * humi * exp((17.15 * temp - 4684.0) / (temp - 38.45));
+	site->trp = 0.0022768 * pres / (1.0 - 0.00266 * cos(2.0 * pos[0]) - 0.00028 * hgt / 1E3) + 0.002277 * (1255.0 / temp + 0.05) * e;
+}
+
+/* range with sagnac correction plus troposphere delay from the site to n satellites, and the
+*  line-of-sight vectors, simd lanes of the best kernel of the cpu */
+static void vrs_range(const vrs_site_t* site, int n, const double* x, const double* y, const double* z, double* ex, double* ey, double* ez, double* rho)
+{
+	orbit_range_soa(site->xyz, site->up, site->trp, n, x, y, z, ex, ey, ez, rho, orbit_simd_kernel());
+}
+
+/* satellites of src with orbit, return the number of satellites in idx */
+static int vrs_pack(const epoch_soa_t* src, int* idx)
+{
+	int i = 0, n = 0;
+	for (i = 0; i < src->n; ++i)
+	{
+		if (!soa_is_valid(src, i)) continue;
+		if (src->rs[0][i] * src->rs[0][i] + src->rs[1][i] * src->rs[1][i] + src->rs[2][i] * src->rs[2][i] < RE_WGS84 * RE_WGS84) continue;
+		idx[n++] = i;
+	}
+	return n;
+}
+
+/* vrs geometry of the satellites idx[0..n-1] of src, x,y,z: satellite position corrected for the
+*  light-time of the new site, ex,ey,ez: line-of-sight of the new site, rho: range change (m) */
+static void vrs_solve(const epoch_soa_t* src, const int* idx, int n, const double* new_xyz, double* x, double* y, double* z, double* ex, double* ey, double* ez, double* rho)
+{
+	vrs_site_t src_site, new_site;
+	double x0[MAX_SAT], y0[MAX_SAT], z0[MAX_SAT], vx[MAX_SAT], vy[MAX_SAT], vz[MAX_SAT];
+	double src_rho[MAX_SAT], dt[MAX_SAT];
+	int i = 0, it = 0;
+	vrs_site(src->pos, &src_site);
+	vrs_site(new_xyz, &new_site);
+	for (i = 0; i < n; ++i)
+	{
+		x0[i] = src->rs[0][idx[i]];
+		y0[i] = src->rs[1][idx[i]];
+		z0[i] = src->rs[2][idx[i]];
+		vx[i] = src->rs[3][idx[i]];
+		vy[i] = src->rs[4][idx[i]];
+		vz[i] = src->rs[5][idx[i]];
+		dt[i] = 0.0;
+	}
+	/* source site, the line-of-sight vectors are overwritten by the new site */
+	vrs_range(&src_site, n, x0, y0, z0, ex, ey, ez, src_rho);
+	/* new site, light-time correction of the satellite position with a fixed number of iterations */
+	for (it = 0; it <= VRS_NITER; ++it)
 	{
-		if (base->ID == staid)
+		for (i = 0; i < n; ++i)
 		{
-			index = ib;
-			break;
+			x[i] = x0[i] + vx[i] * dt[i];
+			y[i] = y0[i] + vy[i] * dt[i];
+			z[i] = z0[i] + vz[i] * dt[i];
+		}
+		vrs_range(&new_site, n, x, y, z, ex, ey, ez, rho);
+		for (i = 0; i < n; ++i)
+		{
+			rho[i] -= src_rho[i];
+			dt[i] = rho[i] / CLIGHT;
 		}
 	}
-	if (ib == network->nb) /* new staton */
+}
+
+extern int make_vrs_measurement_soa(const epoch_soa_t* src, const double* new_xyz, epoch_soa_t* dst)
+{
+	double rho[MAX_SAT];
+	double* P = NULL, * L = NULL;
+	const double* wave = NULL;
+	int idx[MAX_SAT], i = 0, j = 0, n = vrs_pack(src, idx);
+	soa_select(dst, src, idx, n);
+	dst->wk = src->wk;
+	dst->ws = src->ws;
+	memcpy(dst->pos, new_xyz, sizeof(double) * 3);
+	vrs_solve(src, idx, n, new_xyz, dst->rs[0], dst->rs[1], dst->rs[2], dst->e[0], dst->e[1], dst->e[2], rho);
+	for (j = 0; j < MAX_FRQ; ++j)
 	{
-		if (network->nb < MAX_BASE)
+		P = dst->P[j];
+		L = dst->L[j];
+		wave = dst->wave[j];
+		for (i = 0; i < n; ++i)
 		{
-			/* new station */
-			base->ID = staid;
-			index = network->nb;
-			++network->nb;
+			P[i] = P[i] != 0.0 ? P[i] + rho[i] : 0.0;
+			L[i] = L[i] != 0.0 && wave[i] > 0.0 ? L[i] + rho[i] / wave[i] : 0.0;
 		}
-		else
+		memset(dst->D[j], 0, sizeof(float) * n);
+	}
+	return n;
+}
+
+extern int make_vrs_measurement_epoch(const epoch_soa_t* src, const epoch_t* epoch, const double* new_xyz, epoch_t* dst)
+{
+	double x[MAX_SAT], y[MAX_SAT], z[MAX_SAT], ex[MAX_SAT], ey[MAX_SAT], ez[MAX_SAT], rho[MAX_SAT];
+	sat_obs_t* obs = NULL;
+	sat_vec_t* vec = NULL;
+	int idx[MAX_SAT], i = 0, j = 0, n = vrs_pack(src, idx);
+	vrs_solve(src, idx, n, new_xyz, x, y, z, ex, ey, ez, rho);
+	dst->n = n;
+	dst->wk = epoch->wk;
+	dst->ws = epoch->ws;
+	memcpy(dst->pos, new_xyz, sizeof(double) * 3);
+	for (i = 0; i < n; ++i)
+	{
+		obs = dst->obs + i;
+		vec = dst->vec + i;
+		*obs = epoch->obs[idx[i]];
+		*vec = epoch->vec[idx[i]];
+		vec->rs[0] = x[i];
+		vec->rs[1] = y[i];
+		vec->rs[2] = z[i];
+		vec->e[0] = ex[i];
+		vec->e[1] = ey[i];
+		vec->e[2] = ez[i];
+		for (j = 0; j < MAX_FRQ; ++j)
 		{
-			/* find the recycle location */
-			for (ib = 0, base = network->bases + ib; ib < network->nb; ++base, ++ib)
-			{
-				if (base->ID == 0)
-				{
-					base->ID = staid;
-					index = ib;
-					break;
-				}
-			}
+			if (obs->P[j] != 0.0) obs->P[j] += rho[i];
+			obs->L[j] = obs->L[j] != 0.0 && obs->wave[j] > 0.0 ? obs->L[j] + rho[i] / obs->wave[j] : 0.0;
+			obs->D[j] = 0.0;
 		}
 	}
+	return n;
+}
+
+static int is_xyz_valid(double* xyz)
+{
+	return !(fabs(xyz[0]) < 0.001 || fabs(xyz[1]) < 0.001 || fabs(xyz[2]) < 0.001);
+}
+
+/* epoch history -------------------------------------------------------------*/
+static epoch_t* hist_epoch(const epoch_hist_t* hist, int age)
+{
+	return hist->data + hist->slot[(hist->head - age + hist->depth) % hist->depth];
+}
+
+static void hist_free(epoch_hist_t* hist)
+{
+	if (hist->data) free(hist->data);
+	if (hist->slot) free(hist->slot);
+	memset(hist, 0, sizeof(epoch_hist_t));
+}
+
+static void rove_free(rove_t* rove)
+{
+	int i = 0;
+	hist_free(&rove->hist);
+	if (rove->rtcm) free(rove->rtcm);
+	rove->rtcm = NULL;
+	rove->nrtcm = rove->szrtcm = 0;
+	rove->rtcm_epoch = 0;
+	if (rove->enc) free(rove->enc);
+	rove->enc = NULL;
+	for (i = 0; i < rove->nout; ++i)
+	{
+		if (rove->out[i].data) free(rove->out[i].data);
+	}
+	if (rove->out) free(rove->out);
+	rove->out = NULL;
+	rove->nout = 0;
+}
+
+/* the rover leaves the vrs, its rtcm copy is released */
+static void del_rove_rtcm(rove_t* rove, int staid)
+{
+	int i = 0;
+	for (i = 0; i < rove->nout; ++i)
+	{
+		if (rove->out[i].staid != staid) continue;
+		if (rove->out[i].data) free(rove->out[i].data);
+		rove->out[i] = rove->out[--rove->nout];
+		break;
+	}
+}
+
+static void base_free(base_t* base)
+{
+	hist_free(&base->hist);
+	if (base->soa) free(base->soa);
+	base->soa = NULL;
+	base->soa_ok = 0;
+}
+
+/* resize the history, the newest epochs are kept, return 1: ok, 0: no memory */
+static int hist_resize(epoch_hist_t* hist, int depth)
+{
+	epoch_hist_t tmp = { 0 };
+	int i = 0;
+	if (depth < 1) depth = 1;
+	if (depth == hist->depth) return 1;
+	tmp.data = (epoch_t*)calloc(depth, sizeof(epoch_t));
+	tmp.slot = (int*)malloc(sizeof(int) * depth);
+	if (!tmp.data || !tmp.slot)
+	{
+		hist_free(&tmp);
+		return 0;
+	}
+	tmp.depth = depth;
+	tmp.head = depth - 1;
+	for (i = 0; i < depth; ++i) tmp.slot[i] = i;
+	for (i = 0; i < depth && i < hist->depth; ++i) *hist_epoch(&tmp, i) = *hist_epoch(hist, i);
+	hist_free(hist);
+	*hist = tmp;
+	return 1;
+}
+
+/* storage of a new newest epoch, the oldest epoch is dropped */
+static epoch_t* hist_push(epoch_hist_t* hist)
+{
+	hist->head = (hist->head + 1) % hist->depth;
+	return hist_epoch(hist, 0);
+}
+
+/* storage of an epoch inserted at age (1..depth-1), the older epochs move back and the oldest is dropped */
+static epoch_t* hist_insert(epoch_hist_t* hist, int age)
+{
+	int a = hist->depth - 1, free_slot = hist->slot[(hist->head - a + hist->depth) % hist->depth];
+	for (; a > age; --a)
+	{
+		hist->slot[(hist->head - a + hist->depth) % hist->depth] = hist->slot[(hist->head - a + 1 + hist->depth) % hist->depth];
+	}
+	hist->slot[(hist->head - age + hist->depth) % hist->depth] = free_slot;
+	return hist->data + free_slot;
+}
+
+static int network_depth(network_t* network)
+{
+	return network->depth > 0 ? network->depth : MAX_EPOCH;
+}
+
+/* registry and indexes of a network which was not initialized by network_init */
+static void check_network(network_t* network)
+{
+	if (network->bases.size == 0) pool_init(&network->bases, sizeof(base_t));
+	if (network->roves.size == 0) pool_init(&network->roves, sizeof(rove_t));
+	if (network->bidx.cell <= 0.0) grid_init(&network->bidx, BASE_GRID_CELL);
+	if (network->ridx.cell <= 0.0) grid_init(&network->ridx, ROVE_GRID_CELL);
+}
+
+static base_t* get_base(network_t* network, int ib)
+{
+	return (base_t*)pool_get(&network->bases, ib);
+}
+
+static rove_t* get_rove(network_t* network, int ir)
+{
+	return (rove_t*)pool_get(&network->roves, ir);
+}
+
+/* update the index entry of the base station, coordinate of the newest epoch or assigned coordinate */
+static void update_base_index(network_t* network, int ib)
+{
+	base_t* base = get_base(network, ib);
+	epoch_t* epoch = base ? hist_epoch(&base->hist, 0) : NULL;
+	if (base && epoch->n > 0 && is_xyz_valid(epoch->pos))
+	{
+		grid_update(&network->bidx, ib, epoch->pos);
+	}
+	else if (base && is_xyz_valid(base->xyz))
+	{
+		grid_update(&network->bidx, ib, base->xyz);
+	}
+	else
+	{
+		grid_remove(&network->bidx, ib);
+	}
+}
+
+/* new station in the registry, return the slot, -1: no memory */
+static int new_sta_in_network(gnss_pool_t* pool, id_map_t* ids, int staid)
+{
+	int index = pool_alloc(pool);
+	if (index < 0) return index;
+	if (!idmap_set(ids, staid, index))
+	{
+		pool_release(pool, index);
+		return -1;
+	}
+	return index;
+}
+
+static int add_sta_to_network(network_t* network, int staid)
+{
+	int index = -1;
+	if (staid == 0) return index; /* ID can not be 0, and need satellites */
+	check_network(network);
+	/* check existing station or not */
+	index = idmap_get(&network->base_ids, staid);
+	if (index < 0) /* new staton */
+	{
+		index = new_sta_in_network(&network->bases, &network->base_ids, staid);
+		if (index >= 0 && !hist_resize(&get_base(network, index)->hist, network_depth(network)))
+		{
+			idmap_del(&network->base_ids, staid);
+			pool_release(&network->bases, index);
+			index = -1;
+		}
+		if (index >= 0) get_base(network, index)->ID = staid;
+	}
 	return index;
 }
 
@@ -339,102 +625,59 @@ static int add_sta_to_network(network_t* network, int staid)
 extern int add_obs_to_network(network_t* network, int staid, epoch_t *epoch)
 {
 	int ret = 0;
-	int ib = 0, i = 0, j = 0;
+	int i = 0;
 	int index = add_sta_to_network(network, staid);
-	base_t *base = network->bases + 0;
-	double new_time = 0;
+	base_t *base = NULL;
+	epoch_t *stored = NULL;
 	if (staid == 0 || index < 0 || epoch->n == 0) return ret; /* ID can not be 0, and need satellites */
-	base = network->bases + index;
-	/* existing station */
-	for (i = 0; i < MAX_EPOCH; ++i)
+	base = get_base(network, index);
+	/* existing station, find the place of the epoch from the newest one */
+	for (i = 0; i < base->hist.depth; ++i)
 	{
-		if (base->epochs[i].n == 0) continue;
-		if (is_time_same(epoch->ws, base->epochs[i].ws))
+		stored = hist_epoch(&base->hist, i);
+		if (stored->n == 0)
+		{
+			/* no older data */
+			break;
+		}
+		if (is_time_same(epoch->ws, stored->ws))
 		{
 			/* exist epoch, update data */
-			base->epochs[i] = *epoch; /* may consider to merge the epoch, instead of replace */
+			*stored = *epoch; /* may consider to merge the epoch, instead of replace */
 			ret = 4;
 			break;
 		}
-		if (is_time_less(epoch->ws, base->epochs[i].ws))
+		if (is_time_less(stored->ws, epoch->ws))
 		{
-			/* new epoch later then the previous epochs */
-			/* insert if not the first epoch */
-			if (i > 0)
-			{
-				/* left shift data before the current location */
-				for (j = 1; j < i; ++j)
-				{
-					base->epochs[j - 1] = base->epochs[j];
-				}
-				/* inert the data which arrived late, do not update the time tag */
-				base->epochs[i - 1] = *epoch;
-				++base->numofepoch;
-				ret = 5;
-			}
+			/* epoch later than the stored epoch */
+			break;
 		}
 	}
-	if (i == MAX_EPOCH) /* newest epoch, append at the end */
+	if (ret == 0 && i == 0) /* newest epoch, append at the end */
 	{
-		/* new epoch */
-		/* left shift data before the current location */
-		for (j = 1; j < i; ++j)
-		{
-			base->epochs[j - 1] = base->epochs[j];
-		}
-		base->epochs[i - 1] = *epoch;
+		*hist_push(&base->hist) = *epoch;
 		++base->numofepoch;
 		ret = 1;
 	}
+	else if (ret == 0 && i < base->hist.depth)
+	{
+		/* insert the data which arrived late, do not update the time tag */
+		*hist_insert(&base->hist, i) = *epoch;
+		++base->numofepoch;
+		ret = 5;
+	}
 
 	if (ret > 0)
+	{
+		update_base_index(network, index);
+	}
+	if (ret == 1 || ret == 4)
 	{
 		if (fabs(epoch->ws - network->time) > 0.001)
 		{
-#if 0
-			if (network->numofepoch > 0)
-			{
-				/* update network time tag */
-				i = 0;
-				new_time = 0.0;
-				max_time = 0.0;
-				for (ib = 0, base = network->bases + ib; ib < network->nb; ++base, ++ib)
-				{
-					if (base->epochs[MAX_EPOCH - 1].n > 0)
-					{
-						if (i == 0)
-						{
-							new_time = base->epochs[MAX_EPOCH - 1].ws;
-						}
-						network->ws[i] = base->epochs[MAX_EPOCH - 1].ws - new_time;
-						network->ws[i] -= floor(network->ws[i] / (7 * 24 * 3600.0) + 0.5) * (7 * 24 * 3600.0);
-						++i;
-					}
-				}
-				if (i > 5)
-				{
-					new_time += median_data(network->ws, i);
-					new_time -= floor(network->ws[i] / (7 * 24 * 3600.0) + 0.5) * (7 * 24 * 3600.0);
-				}
-				else
-				{
-
-				}
-				if (fabs(new_time - network->time) > 0.001)
-				{
-					/* new epoch */
-					network_processor(network);
-					network->time = new_time;
-					network->status = 0;
-				}
-			}
-			else
-#endif
-			{
-				network_processor(network);
-				network->time = epoch->ws;
-				network->status = 0;
-			}
+			network_processor(network);
+			network->time = epoch->ws;
+			network->status = 0;
 			++network->numofepoch;
 		}
 		else
@@ -449,28 +692,36 @@ extern int add_vrs_to_network(network_t* network, int vrsid, double* xyz)
 {
 	int ret =-1;
 	int ir = 0, bestLoc = 0;
-	rove_t* rove = network->roves + ir;
+	rove_t* rove = NULL;
 	double bestDis = 0.0;
 	double cur_dis = 0.0;
 	if (vrsid == 0 || fabs(xyz[0]) < 0.001 || fabs(xyz[1]) < 0.001 || fabs(xyz[2]) < 0.001) return ret; /* ID can not be 0, need valid coordinate */
-	for (ir=0, rove = network->roves+ir;ir<network->nr;++ir, ++rove)
-	{
-		if (rove->ID == vrsid) break;
-	}
-	if (ir < network->nr) /* existing rove */
+	check_network(network);
+	ir = idmap_get(&network->rove_ids, vrsid);
+	if (ir >= 0) /* existing rove */
 	{
+		rove = get_rove(network, ir);
+		/* update vrs coordinate or not ? */
+		cur_dis = baseline_distance(xyz, rove->vrs_xyz);
+		if (cur_dis > 2500.0 && rove->nref > 1)
+		{
+			/* shared vrs, the rover leaves it for a vrs near its new coordinate */
+			--rove->nref;
+			del_rove_rtcm(rove, vrsid);
+			idmap_del(&network->rove_ids, vrsid);
+			return add_vrs_to_network(network, vrsid, xyz);
+		}
 		/* update coordinate */
 		rove->cur_xyz[0] = xyz[0];
 		rove->cur_xyz[1] = xyz[1];
 		rove->cur_xyz[2] = xyz[2];
-		/* update vrs coordinate or not ? */
-		cur_dis = baseline_distance(rove->cur_xyz, rove->vrs_xyz);
 		if (cur_dis > 2500.0)
 		{
 			/* update vrs location using the newest position */
 			rove->vrs_xyz[0] = rove->cur_xyz[0];
 			rove->vrs_xyz[1] = rove->cur_xyz[1];
 			rove->vrs_xyz[2] = rove->cur_xyz[2];
+			grid_update(&network->ridx, ir, rove->vrs_xyz);
 		}
 		ret = ir;
 	}
@@ -478,54 +729,35 @@ extern int add_vrs_to_network(network_t* network, int vrsid, double* xyz)
 	{
 		/* new vrs statation */
 		/* search nearby coordinate with 2.5 km */
-		bestLoc = -1;
-		for (ir = 0, rove = network->roves+ir; ir < network->nr; ++ir, ++rove)
+		if (!grid_nearest(&network->ridx, xyz, 1, 2500.0, NULL, NULL, &bestLoc, &bestDis)) bestLoc = -1;
+		if (bestLoc >= 0 && bestDis <= 2500.0) /* find a better ID */
 		{
-			if (rove->ID == 0) continue;
-			cur_dis = baseline_distance(xyz, rove->vrs_xyz);
-			if (bestLoc < 0 || cur_dis < bestDis)
+			/* use the current vrs, shared with its rovers */
+			if (idmap_set(&network->rove_ids, vrsid, bestLoc))
 			{
-				bestLoc = ir;
-				bestDis = cur_dis;
+				++get_rove(network, bestLoc)->nref;
+				ret = bestLoc;
 			}
 		}
-		if (bestLoc >= 0 && bestDis <= 2500.0) /* find a better ID */
+		else if ((ir = new_sta_in_network(&network->roves, &network->rove_ids, vrsid)) >= 0 && !hist_resize(&get_rove(network, ir)->hist, network_depth(network)))
+		{
+			idmap_del(&network->rove_ids, vrsid);
+			pool_release(&network->roves, ir);
+		}
+		else if (ir >= 0)
 		{
-			/* use the current rover */
-			rove = network->roves + bestLoc;	//add
-			ret = bestLoc;
+			rove = get_rove(network, ir);
+			rove->ID = vrsid;
+			rove->nref = 1;
+			rove->vrs_xyz[0] = xyz[0];
+			rove->vrs_xyz[1] = xyz[1];
+			rove->vrs_xyz[2] = xyz[2];
+			grid_update(&network->ridx, ir, rove->vrs_xyz);
+			ret = ir;
 		}
 		else
 		{
-			/* find the recycle location */
-			for (ir = 0, rove = network->roves + ir; ir < network->nr; ++ir, ++rove)
-			{
-				if (rove->ID == 0)
-				{
-					rove->ID = vrsid;
-					rove->vrs_xyz[0] = xyz[0];
-					rove->vrs_xyz[1] = xyz[1];
-					rove->vrs_xyz[2] = xyz[2];
-					ret = ir;
-					break;
-				}
-			}
-			if (ir == network->nr) /* new location */
-			{
-				if (network->nr < MAX_ROVE)
-				{
-					rove->ID = vrsid;
-					rove->vrs_xyz[0] = xyz[0];
-					rove->vrs_xyz[1] = xyz[1];
-					rove->vrs_xyz[2] = xyz[2];
-					ret = network->nr;
-					++network->nr;
-				}
-				else
-				{
-					/* can not add the rove station */
-				}
-			}
+			/* can not add the rove station */
 		}
 	}
 	return ret;
@@ -535,94 +767,51 @@ extern int add_bas_to_network(network_t* network, int staid, double* xyz)
 {
 	int ret =-1;
 	int ib = 0;
-	base_t* base = network->bases + ib;
+	base_t* base = NULL;
 	if (xyz == 0 || staid == 0 || fabs(xyz[0]) < 0.01 || fabs(xyz[1]) < 0.01 || fabs(xyz[2]) < 0.01) return ret; /* ID cannot be 0 */
-	for (ib = 0, base = network->bases + ib; ib < network->nb; ++ib, ++base)
-	{
-		if (base->ID == staid) break;
-	}
-	if (ib < network->nb) /* existing station */
+	if ((ib = add_sta_to_network(network, staid)) >= 0)
 	{
+		base = get_base(network, ib);
 		base->xyz[0] = xyz[0];
 		base->xyz[1] = xyz[1];
 		base->xyz[2] = xyz[2];
+		update_base_index(network, ib);
 		ret = ib;
 	}
-	else /* new station */
-	{
-		/* find the location for new station */
-		for (ib = 0, base = network->bases + ib; ib < network->nb; ++ib, ++base)
-		{
-			if (base->ID == 0)
-			{
-				base->ID = staid;
-				base->xyz[0] = xyz[0];
-				base->xyz[1] = xyz[1];
-				base->xyz[2] = xyz[2];
-				ret = ib;
-				break;
-			}
-		}
-		if (ib == network->nb) /* no recycle locations, need to add new */
-		{
-			if (network->nb < MAX_BASE)
-			{
-				base->ID = staid;
-				base->xyz[0] = xyz[0];
-				base->xyz[1] = xyz[1];
-				base->xyz[2] = xyz[2];
-				ret = network->nb;
-				++network->nb;
-			}else
-			{
-				/* reach maxium, can not add */
-			}
-		}
-	}
 	return ret;
 }
 
-/* delete bas station from network database */
+/* delete bas station from network database, the slot and its memory are released */
 extern void del_bas_from_network(network_t *network, int staid)
 {
-	int ib = 0;
-	base_t* base = network->bases + ib;
-	for (; ib<network->nb; ++ib, ++base)
-	{
-		if (base->ID == staid)
-		{
-			memset(base, 0, sizeof(base_t));
-			break;
-		}
-	}
+	int ib = idmap_get(&network->base_ids, staid);
+	if (ib < 0) return;
+	base_free(get_base(network, ib));
+	grid_remove(&network->bidx, ib);
+	idmap_del(&network->base_ids, staid);
+	pool_release(&network->bases, ib);
 }
 
-/* delete the vrs rove data from network database */
+/* delete the vrs rove data from network database, the vrs is released with its last rover */
 extern void del_vrs_from_network(network_t* network, int vrsid)
 {
-	int ir = 0;
-	rove_t* rove = network->roves + ir;
-	for (; ir < network->nr; ++ir, ++rove)
-	{
-		if (rove->ID == vrsid)
-		{
-			memset(rove, 0, sizeof(rove_t));
-			break;
-		}
-	}
+	int ir = idmap_get(&network->rove_ids, vrsid);
+	rove_t* rove = get_rove(network, ir);
+	if (!rove) return;
+	idmap_del(&network->rove_ids, vrsid);
+	del_rove_rtcm(rove, vrsid);
+	if (--rove->nref > 0) return;
+	rove_free(rove);
+	grid_remove(&network->ridx, ir);
+	pool_release(&network->roves, ir);
 }
 /* output */
 extern int get_vrs_from_network(network_t* network, int vrsid, epoch_t* epoch)
 {
-	int ir = 0;
-	rove_t* rove = network->roves + ir;
-	for (; ir < network->nr; ++ir, ++rove)
-	{
-		if (rove->ID == vrsid) break;
-	}
-	if (ir < network->nr)
+	rove_t* rove = get_rove(network, idmap_get(&network->rove_ids, vrsid));
+	if (rove)
 	{
-		*epoch = rove->epochs[MAX_EPOCH - 1];
+		*epoch = *hist_epoch(&rove->hist, 0);
 		return epoch->n;
 	}
 	else
@@ -631,6 +820,74 @@ extern int get_vrs_from_network(network_t* network, int vrsid, epoch_t* epoch)
 	}
 }
 
+extern rove_t* get_vrs_rove_from_network(network_t* network, int vrsid)
+{
+	return get_rove(network, idmap_get(&network->rove_ids, vrsid));
+}
+
+extern const epoch_t* get_vrs_epoch_of_rove(const rove_t* rove)
+{
+	return hist_epoch(&rove->hist, 0);
+}
+
+extern int set_vrs_rtcm_of_rove(rove_t* rove, const uint8_t* buff, int nbyte, int staid)
+{
+	uint8_t* rtcm = NULL;
+	int size = 0;
+	rove->rtcm_epoch = 0;
+	if (nbyte > rove->szrtcm)
+	{
+		for (size = rove->szrtcm > 0 ? rove->szrtcm : 1024; size < nbyte; size *= 2);
+		if (!(rtcm = (uint8_t*)realloc(rove->rtcm, size))) return 0;
+		rove->rtcm = rtcm;
+		rove->szrtcm = size;
+	}
+	if (nbyte > 0) memcpy(rove->rtcm, buff, nbyte);
+	rove->nrtcm = nbyte;
+	rove->rtcm_staid = staid;
+	rove->rtcm_epoch = rove->numofepoch;
+	return 1;
+}
+
+extern const uint8_t* get_vrs_rtcm_of_rove(rove_t* rove, int staid, int* nbyte)
+{
+	rove_rtcm_t* out = NULL;
+	uint8_t* data = NULL;
+	int i = 0, size = 0;
+	*nbyte = 0;
+	if (rove->rtcm_epoch == 0) return NULL;
+	if (staid == rove->rtcm_staid)
+	{
+		*nbyte = rove->nrtcm;
+		return rove->rtcm;
+	}
+	for (i = 0; i < rove->nout && rove->out[i].staid != staid; ++i);
+	if (i == rove->nout)
+	{
+		if (!(out = (rove_rtcm_t*)realloc(rove->out, sizeof(rove_rtcm_t) * (rove->nout + 1)))) return NULL;
+		rove->out = out;
+		memset(rove->out + rove->nout, 0, sizeof(rove_rtcm_t));
+		rove->out[rove->nout++].staid = staid;
+	}
+	out = rove->out + i;
+	if (out->epoch != rove->rtcm_epoch || out->data == NULL)
+	{
+		if (rove->nrtcm > out->size)
+		{
+			for (size = out->size > 0 ? out->size : 1024; size < rove->nrtcm; size *= 2);
+			if (!(data = (uint8_t*)realloc(out->data, size))) return NULL;
+			out->data = data;
+			out->size = size;
+		}
+		if (rove->nrtcm > 0) memcpy(out->data, rove->rtcm, rove->nrtcm);
+		rtcm_set_staid(out->data, rove->nrtcm, staid);
+		out->nbyte = rove->nrtcm;
+		out->epoch = rove->rtcm_epoch;
+	}
+	*nbyte = out->nbyte;
+	return out->data;
+}
+
 /* process the network data */
 /* 1. evaluate the satellite orbit (position, velocity, acceleration, clock bias, clock drift) */
 /* 2. receiver based GNSS data processing */
@@ -659,73 +916,82 @@ static void network_vrs_modeling(network_t* network)
 
 }
 
+/* base station with data within 1.5 seconds of the current time tag */
+static int is_base_in_time(network_t* network, base_t* base)
+{
+	epoch_t* epoch = hist_epoch(&base->hist, 0);
+	double dt = 0;
+	if (base->ID == 0 || epoch->n == 0) return 0;
+	dt = fabs(epoch->ws - network->time);
+	dt -= floor(dt / (7 * 24 * 3600.0) + 0.5) * (7 * 24 * 3600.0);
+	return fabs(dt) <= 1.5;
+}
+
+static int accept_base(void* arg, int ib)
+{
+	network_t* network = (network_t*)arg;
+	base_t* base = get_base(network, ib);
+	return base && is_base_in_time(network, base);
+}
+
+/* newest epoch of the base as structure of arrays, converted once per vrs generation, NULL: no memory */
+static epoch_soa_t* base_soa(base_t* base)
+{
+	if (!base->soa && !(base->soa = (epoch_soa_t*)malloc(sizeof(epoch_soa_t)))) return NULL;
+	if (!base->soa_ok)
+	{
+		epoch2soa(hist_epoch(&base->hist, 0), base->soa);
+		base->soa_ok = 1;
+	}
+	return base->soa;
+}
+
 static void network_vrs_generate(network_t* network)
 {
 	int ir = 0;
 	int ib = 0;
-	rove_t* rove = network->roves + ir;
-	int i = 0;
-	int j = 0;
-	base_t* base = network->bases + 0;
-	base_t* base_can = network->bases + 0;
-	epoch_t* epoch = 0;
+	rove_t* rove = NULL;
+	base_t* base = NULL;
 	int bestLoc = 0;
+	int passLoc = -1;
 	double bestDis = 0;
-	double currDis = 0;
-	double dt = 0;
-	for (ir = 0; ir < network->nr; ++ir, ++rove)
+	check_network(network);
+	/* base station without coordinate, the data are used for all the rovers without change */
+	for (ib = 0; ib < network->bases.nslot; ++ib)
+	{
+		if (!(base = get_base(network, ib))) continue;
+		base->soa_ok = 0;
+		if (is_base_in_time(network, base) && !is_xyz_valid(hist_epoch(&base->hist, 0)->pos)) passLoc = ib;
+	}
+	for (ir = 0; ir < network->roves.nslot; ++ir)
 	{
+		if (!(rove = get_rove(network, ir))) continue;
 		rove->status = 0;
-		if (rove->ID == 0) continue;
-		/* search the best two stations within 1 seconds of the current time tag */
-		bestLoc = -1;
-		bestDis = 0;
-		for (ib = 0, base = network->bases + ib; ib < network->nb; ++ib, ++base)
-		{
-			epoch = base->epochs + (MAX_EPOCH - 1);
-			if (epoch->n > 0 )
-				dt = fabs(epoch->ws - network->time);
-			dt -= floor(dt / (7 * 24 * 3600.0) + 0.5) * (7 * 24 * 3600.0);
-			if (fabs(dt) > 1.5) continue;
-			/* check distance */
-			if (fabs(epoch->pos[0]) < 0.001 || fabs(epoch->pos[1]) < 0.001 || fabs(epoch->pos[2]) < 0.001)
-			{
-				currDis = -1.0;
-			}
-			else
-			{
-				currDis = baseline_distance(rove->vrs_xyz, epoch->pos);
-			}
-			if (bestLoc < 0 || currDis < bestDis || currDis < 0.0)
-			{
-				bestLoc = ib;
-				bestDis = currDis;
-			}
-		}
+		/* search the nearest station within 1 seconds of the current time tag */
+		bestLoc = passLoc;
+		if (bestLoc < 0 && !grid_nearest(&network->bidx, rove->vrs_xyz, 1, 0.0, accept_base, network, &bestLoc, &bestDis)) bestLoc = -1;
 		if (bestLoc >= 0) /* can set maximum limitation here */
 		{
 			/* find the best base station */
 			/* generate the correction for the rove */
-			base = network->bases + bestLoc;
+			base = get_base(network, bestLoc);
 			rove->baseID = base->ID;
 			/* generate vrs data */
-			for (j = 1; j < MAX_EPOCH; ++j)
+			epoch_t* rov_epoch = hist_push(&rove->hist);
+			epoch_t* bas_epoch = hist_epoch(&base->hist, 0);
+			if (!is_xyz_valid(bas_epoch->pos))
 			{
-				rove->epochs[j - 1] = rove->epochs[j];
+				*rov_epoch = *bas_epoch;
 			}
-			epoch_t* rov_epoch = rove->epochs + (MAX_EPOCH - 1);
-			epoch_t* bas_epoch = base->epochs + (MAX_EPOCH - 1);
-			if (fabs(bas_epoch->pos[0]) < 0.001 || fabs(bas_epoch->pos[1]) < 0.001 || fabs(bas_epoch->pos[2]) < 0.001)
+			else if (base_soa(base))
 			{
-				*rov_epoch = *bas_epoch;
+				make_vrs_measurement_epoch(base->soa, bas_epoch, rove->vrs_xyz, rov_epoch);
 			}
 			else
 			{
-				rov_epoch->pos[0] = rove->vrs_xyz[0];
-				rov_epoch->pos[1] = rove->vrs_xyz[1];
-				rov_epoch->pos[2] = rove->vrs_xyz[2];
-				rov_epoch->n = make_vrs_measurement(bas_epoch->obs, bas_epoch->vec, bas_epoch->pos, bas_epoch->n, rove->vrs_xyz, rov_epoch->obs, rov_epoch->vec);
+				rov_epoch->n = 0;
 			}
+			++rove->numofepoch;
 			rove->status = 1;
 		}
 	}
@@ -752,12 +1018,45 @@ extern void network_processor(network_t* network)
 /* initize network */
 extern void network_init(network_t* network)
 {
-	memset(network->bases, 0, sizeof(base_t) * MAX_BASE);
-	memset(network->roves, 0, sizeof(rove_t) * MAX_ROVE);
-	network->nb = 0;
-	network->nr = 0;
+	int i = 0;
+	base_t* base = NULL;
+	rove_t* rove = NULL;
+	for (i = 0; i < network->bases.nslot; ++i)
+	{
+		if ((base = get_base(network, i)) != NULL) base_free(base);
+	}
+	for (i = 0; i < network->roves.nslot; ++i)
+	{
+		if ((rove = get_rove(network, i)) != NULL) rove_free(rove);
+	}
+	pool_free(&network->bases);
+	pool_free(&network->roves);
+	idmap_free(&network->base_ids);
+	idmap_free(&network->rove_ids);
+	grid_free(&network->bidx);
+	grid_free(&network->ridx);
+	pool_init(&network->bases, sizeof(base_t));
+	pool_init(&network->roves, sizeof(rove_t));
+	grid_init(&network->bidx, BASE_GRID_CELL);
+	grid_init(&network->ridx, ROVE_GRID_CELL);
 	network->numofepoch = 0;
 	network->time = 0;
 	network->status = 0;
-	memset(network->ws, 0, sizeof(network->ws));
-}
\ No newline at end of file
+}
+/* number of epochs kept for each station */
+extern int network_set_depth(network_t* network, int depth)
+{
+	int i = 0, ret = 1;
+	base_t* base = NULL;
+	rove_t* rove = NULL;
+	network->depth = depth > 0 ? depth : MAX_EPOCH;
+	for (i = 0; i < network->bases.nslot; ++i)
+	{
+		if ((base = get_base(network, i)) != NULL && !hist_resize(&base->hist, network->depth)) ret = 0;
+	}
+	for (i = 0; i < network->roves.nslot; ++i)
+	{
+		if ((rove = get_rove(network, i)) != NULL && !hist_resize(&rove->hist, network->depth)) ret = 0;
+	}
+	return ret;
+}
@@ -12,6 +12,9 @@ extern "C" {
 #endif
 
 #include "gnss_obs.h"
+#include "gnss_grid.h"
+#include "gnss_pool.h"
+#include "gnss_soa.h"
 #include "GNSSCore_Api.h"
 
 /* global constants */
@@ -56,15 +59,19 @@ GNSSCORE_API double week_second(double time);
 GNSSCORE_API double median_data(double *data, int n);
 
 #ifndef MAX_EPOCH
-#define MAX_EPOCH 3
+#define MAX_EPOCH 3 /* default number of epochs kept for each station */
 #endif
 
-#ifndef MAX_BASE
-#define MAX_BASE 20
+#ifndef BASE_GRID_CELL
+#define BASE_GRID_CELL 50000.0 /* cell size of the base station index (m) */
 #endif
 
-#ifndef MAX_ROVE
-#define MAX_ROVE 200
+#ifndef ROVE_GRID_CELL
+#define ROVE_GRID_CELL 2500.0 /* cell size of the vrs index (m) */
+#endif
+
+#ifndef VRS_NITER
+#define VRS_NITER 2 /* light-time iterations of the vrs, the range changes by less than 1 nm after the second */
 #endif
 
 #define OMGE        7.2921151467E-5     /* earth angular velocity (IS-GPS) (rad/s) */
@@ -75,6 +82,25 @@ GNSSCORE_API double median_data(double *data, int n);
 
 /* generate VRS measurement by offset */
 GNSSCORE_API int make_vrs_measurement(sat_obs_t* src_obs, sat_vec_t* src_vec, double* src_xyz, int n, double* new_xyz, sat_obs_t* new_obs, sat_vec_t* new_vec);
+/* the same on the structure of arrays store, all satellites of the epoch are processed together
+*  (simd lanes) with VRS_NITER light-time iterations and the site constants computed once,
+*  the satellites of src without position or velocity are dropped, dst gets the new position
+*  and the time of src, return dst->n */
+GNSSCORE_API int make_vrs_measurement_soa(const epoch_soa_t* src, const double* new_xyz, epoch_soa_t* dst);
+/* the same with the vrs epoch as epoch_t for the rtcm encoders, src is epoch converted by epoch2soa,
+*  the satellite records are copied from epoch and the vrs fields replaced, return dst->n */
+GNSSCORE_API int make_vrs_measurement_epoch(const epoch_soa_t* src, const epoch_t* epoch, const double* new_xyz, epoch_t* dst);
+
+/* epoch history of a station, ring of depth epochs addressed by age (0: newest),
+*  the ring holds the storage index of each epoch, so an epoch is written once and
+*  stays in place until it is dropped as the oldest, unused epochs have n=0 */
+typedef struct
+{
+	epoch_t* data; /* storage of the epochs */
+	int* slot; /* storage index by ring position */
+	int depth; /* number of epochs */
+	int head; /* ring position of the newest epoch */
+}epoch_hist_t;
 
 /* struct for base station */
 typedef struct
@@ -82,34 +108,59 @@ typedef struct
 	int ID; /* station ID, will not change */
 	double xyz[3]; /* assigned coordinate */
 	double ws;
-	epoch_t epochs[MAX_EPOCH];
+	epoch_hist_t hist; /* recent epochs */
+	epoch_soa_t* soa; /* newest epoch for the vrs, converted on first use in each vrs generation */
+	int soa_ok; /* 1: soa is the newest epoch of this vrs generation */
 	unsigned long numofepoch;
 	int status;
 }base_t;
 
-/* data for rover */
+/* rtcm encoding of the vrs epoch for one rover ID of a shared vrs (station ID rewritten) */
+typedef struct
+{
+	int staid; /* rover ID */
+	unsigned long epoch; /* rtcm_epoch of the copy */
+	uint8_t* data;
+	int nbyte;
+	int size; /* allocated bytes of data */
+}rove_rtcm_t;
+
+/* data for rover, one vrs shared by all the rovers within 2.5 km of its coordinate (rove_ids maps
+*  each rover ID to it), the vrs epoch and its rtcm encoding are made once for all of them */
 typedef struct
 {
-	int ID;
+	int ID; /* first rover ID of the vrs */
 	int baseID;
 	double cur_xyz[3]; /* current coordinate to determine which base station to be used */
 	double vrs_xyz[3]; /* coordinate used to compute the observation */
 	double base_xyz[3];
-	epoch_t epochs[MAX_EPOCH];
+	epoch_hist_t hist; /* recent vrs epochs */
 	int status;
+	int nref; /* number of rover IDs mapped to the vrs */
+	unsigned long numofepoch; /* vrs epochs generated, version of the newest epoch */
+	uint8_t* rtcm; /* rtcm encoding of the newest epoch */
+	int nrtcm; /* bytes of rtcm */
+	int szrtcm; /* allocated bytes of rtcm */
+	int rtcm_staid; /* station ID written in rtcm */
+	unsigned long rtcm_epoch; /* numofepoch of the encoded epoch, 0: not encoded */
+	void* enc; /* msm encoder state of the rtcm output (allocated by the output), freed with the vrs */
+	rove_rtcm_t* out; /* encodings for the other rover IDs of the vrs */
+	int nout;
 }rove_t;
 
 /* data for the network */
 typedef struct
 {
-	int nb; /* number of base stations */
-	int nr; /* number of rove stations */
-	base_t bases[MAX_BASE]; /* all base station decoded */
-	rove_t roves[MAX_ROVE]; /* all rove stations */
-	double ws[MAX_BASE]; /* current epoch */
+	gnss_pool_t bases; /* all base station decoded, base_t by slot (handle), slots below bases.nslot */
+	gnss_pool_t roves; /* all rove stations, rove_t by slot */
+	id_map_t base_ids; /* base station ID => slot */
+	id_map_t rove_ids; /* rove station ID => slot */
+	grid_index_t bidx; /* base stations by coordinate of the newest epoch (assigned coordinate before data) */
+	grid_index_t ridx; /* vrs by coordinate */
 	double time;
 	unsigned long numofepoch; /* total number of epochs */
 	int status;
+	int depth; /* epochs kept for each station (0: MAX_EPOCH) */
 }network_t;
 
 /* input */
@@ -122,9 +173,23 @@ GNSSCORE_API void del_bas_from_network(network_t *network, int staid);
 GNSSCORE_API void del_vrs_from_network(network_t* network, int vrsid);
 /* output */
 GNSSCORE_API int  get_vrs_from_network(network_t* network, int vrsid, epoch_t* epoch);
+/* vrs of the rover by reference, NULL: unknown rover */
+GNSSCORE_API rove_t* get_vrs_rove_from_network(network_t* network, int vrsid);
+/* newest vrs epoch by reference */
+GNSSCORE_API const epoch_t* get_vrs_epoch_of_rove(const rove_t* rove);
+/* keep the rtcm encoding (station ID staid) of the newest vrs epoch for the other rovers of the vrs,
+*  return 1: ok, 0: no memory */
+GNSSCORE_API int  set_vrs_rtcm_of_rove(rove_t* rove, const uint8_t* buff, int nbyte, int staid);
+/* rtcm encoding of the newest vrs epoch for the rover staid, the kept encoding for its station ID,
+*  a copy with the station ID of the rover for the other rovers (made once per epoch), the data of
+*  a rover is not changed by the calls of the other rovers, it is valid until the next epoch of the
+*  vrs is kept, return NULL: no encoding or no memory */
+GNSSCORE_API const uint8_t* get_vrs_rtcm_of_rove(rove_t* rove, int staid, int* nbyte);
 /* data process and init */
 GNSSCORE_API void network_processor(network_t* network);
 GNSSCORE_API void network_init(network_t* network);
+/* number of epochs kept for each station, applied to the existing stations, return 1: ok, 0: no memory */
+GNSSCORE_API int  network_set_depth(network_t* network, int depth);
 
 #ifdef __cplusplus
 }
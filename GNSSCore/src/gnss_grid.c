@@ -0,0 +1,250 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ spatial index of station coordinates (ecef)
+ the cells are kept in an open addressing hash table keyed by the cell coordinate,
+ the entries of a cell are a doubly linked list through the entry array, so insert,
+ move and remove are constant time
+ a query visits the shells of cells around the query point (chebyshev distance s) and
+ stops when the k-th distance is below s*cell, the shells are skipped for a linear scan
+ when they have more cells than the index has entries
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "gnss_grid.h"
+
+static int grid_hash(int ix, int iy, int iz, int ntab)
+{
+	unsigned int h = (unsigned int)ix * 73856093u ^ (unsigned int)iy * 19349663u ^ (unsigned int)iz * 83492791u;
+	return (int)(h & (unsigned int)(ntab - 1));
+}
+
+static int find_cell(const grid_index_t* grid, int ix, int iy, int iz)
+{
+	int i = 0;
+	if (!grid->tab) return -1;
+	for (i = grid_hash(ix, iy, iz, grid->ntab); grid->tab[i].used; i = (i + 1) & (grid->ntab - 1))
+	{
+		if (grid->tab[i].ix == ix && grid->tab[i].iy == iy && grid->tab[i].iz == iz) return i;
+	}
+	return -1;
+}
+
+/* rebuild the hash table with room for twice the occupied cells, the empty cells are dropped */
+static int rehash(grid_index_t* grid)
+{
+	grid_cell_t* tab = NULL;
+	int ntab = 64, i = 0, j = 0, e = 0, nused = 0;
+	for (i = 0; i < grid->ntab; ++i)
+	{
+		if (grid->tab[i].used && grid->tab[i].head >= 0) ++nused;
+	}
+	while (ntab < nused * 4) ntab <<= 1;
+	tab = (grid_cell_t*)calloc(ntab, sizeof(grid_cell_t));
+	if (!tab) return 0;
+	for (i = 0, nused = 0; i < grid->ntab; ++i)
+	{
+		if (!grid->tab[i].used || grid->tab[i].head < 0) continue;
+		for (j = grid_hash(grid->tab[i].ix, grid->tab[i].iy, grid->tab[i].iz, ntab); tab[j].used; j = (j + 1) & (ntab - 1));
+		tab[j] = grid->tab[i];
+		for (e = tab[j].head; e >= 0; e = grid->ent[e].next) grid->ent[e].cell = j;
+		++nused;
+	}
+	if (grid->tab) free(grid->tab);
+	grid->tab = tab;
+	grid->ntab = ntab;
+	grid->nused = nused;
+	return 1;
+}
+
+/* slot of the cell, added if new, -1: no memory */
+static int add_cell(grid_index_t* grid, int ix, int iy, int iz)
+{
+	int i = find_cell(grid, ix, iy, iz);
+	if (i >= 0) return i;
+	if ((grid->nused + 1) * 2 > grid->ntab && !rehash(grid)) return -1;
+	for (i = grid_hash(ix, iy, iz, grid->ntab); grid->tab[i].used; i = (i + 1) & (grid->ntab - 1));
+	grid->tab[i].ix = ix;
+	grid->tab[i].iy = iy;
+	grid->tab[i].iz = iz;
+	grid->tab[i].head = -1;
+	grid->tab[i].used = 1;
+	++grid->nused;
+	return i;
+}
+
+static void unlink_entry(grid_index_t* grid, int id)
+{
+	grid_entry_t* ent = grid->ent + id;
+	if (ent->prev >= 0) grid->ent[ent->prev].next = ent->next;
+	else grid->tab[ent->cell].head = ent->next;
+	if (ent->next >= 0) grid->ent[ent->next].prev = ent->prev;
+	ent->cell = ent->prev = ent->next = -1;
+	--grid->n;
+}
+
+static double entry_dist(const grid_entry_t* ent, const double* xyz)
+{
+	double dx = ent->xyz[0] - xyz[0], dy = ent->xyz[1] - xyz[1], dz = ent->xyz[2] - xyz[2];
+	return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/* insert (id,d) into the sorted list of the k best */
+static int add_best(int* ids, double* dist, int n, int k, int id, double d)
+{
+	int i = n < k ? n : k - 1;
+	if (n == k && d >= dist[k - 1]) return n;
+	for (; i > 0 && dist[i - 1] > d; --i)
+	{
+		ids[i] = ids[i - 1];
+		dist[i] = dist[i - 1];
+	}
+	ids[i] = id;
+	dist[i] = d;
+	return n < k ? n + 1 : n;
+}
+
+extern void grid_init(grid_index_t* grid, double cell)
+{
+	memset(grid, 0, sizeof(grid_index_t));
+	grid->cell = cell;
+}
+
+extern void grid_free(grid_index_t* grid)
+{
+	double cell = grid->cell;
+	if (grid->ent) free(grid->ent);
+	if (grid->tab) free(grid->tab);
+	grid_init(grid, cell);
+}
+
+extern int grid_update(grid_index_t* grid, int id, const double* xyz)
+{
+	grid_entry_t* ent = NULL;
+	int ix = 0, iy = 0, iz = 0, cell = 0, nent = 0, i = 0;
+	if (id < 0 || grid->cell <= 0.0) return 0;
+	if (id >= grid->nent)
+	{
+		nent = grid->nent > 0 ? grid->nent : 32;
+		while (nent <= id) nent <<= 1;
+		ent = (grid_entry_t*)realloc(grid->ent, sizeof(grid_entry_t) * nent);
+		if (!ent) return 0;
+		for (i = grid->nent; i < nent; ++i) ent[i].cell = ent[i].prev = ent[i].next = -1;
+		grid->ent = ent;
+		grid->nent = nent;
+	}
+	ix = (int)floor(xyz[0] / grid->cell);
+	iy = (int)floor(xyz[1] / grid->cell);
+	iz = (int)floor(xyz[2] / grid->cell);
+	ent = grid->ent + id;
+	if (ent->cell >= 0)
+	{
+		if (grid->tab[ent->cell].ix == ix && grid->tab[ent->cell].iy == iy && grid->tab[ent->cell].iz == iz)
+		{
+			/* same cell */
+			memcpy(ent->xyz, xyz, sizeof(double) * 3);
+			return 1;
+		}
+		unlink_entry(grid, id);
+	}
+	if ((cell = add_cell(grid, ix, iy, iz)) < 0) return 0;
+	memcpy(ent->xyz, xyz, sizeof(double) * 3);
+	ent->cell = cell;
+	ent->prev = -1;
+	ent->next = grid->tab[cell].head;
+	if (ent->next >= 0) grid->ent[ent->next].prev = id;
+	grid->tab[cell].head = id;
+	++grid->n;
+	return 1;
+}
+
+extern void grid_remove(grid_index_t* grid, int id)
+{
+	if (id < 0 || id >= grid->nent || grid->ent[id].cell < 0) return;
+	unlink_entry(grid, id);
+}
+
+extern int grid_nearest(grid_index_t* grid, const double* xyz, int k, double maxdist, grid_accept_t accept, void* arg, int* ids, double* dist)
+{
+	int n = 0, s = 0, i = 0, e = 0, ix = 0, iy = 0, iz = 0, dx = 0, dy = 0, dz = 0, ncell = 0;
+	double d = 0.0;
+	if (k <= 0 || grid->n == 0) return 0;
+	ix = (int)floor(xyz[0] / grid->cell);
+	iy = (int)floor(xyz[1] / grid->cell);
+	iz = (int)floor(xyz[2] / grid->cell);
+	for (s = 0;; ++s)
+	{
+		/* the unvisited cells are at least (s-1)*cell away */
+		if (s > 0 && n == k && dist[k - 1] <= (s - 1) * grid->cell) break;
+		if (s > 0 && maxdist > 0.0 && (s - 1) * grid->cell > maxdist) break;
+		ncell = s == 0 ? 1 : (2 * s + 1) * (2 * s + 1) * (2 * s + 1) - (2 * s - 1) * (2 * s - 1) * (2 * s - 1);
+		if (ncell > grid->n)
+		{
+			/* sparse index, linear scan */
+			for (e = 0, n = 0; e < grid->nent; ++e)
+			{
+				if (grid->ent[e].cell < 0 || (accept && !accept(arg, e))) continue;
+				d = entry_dist(grid->ent + e, xyz);
+				if (maxdist > 0.0 && d > maxdist) continue;
+				n = add_best(ids, dist, n, k, e, d);
+			}
+			break;
+		}
+		for (dx = -s; dx <= s; ++dx)
+		{
+			for (dy = -s; dy <= s; ++dy)
+			{
+				for (dz = -s; dz <= s; ++dz)
+				{
+					if (abs(dx) != s && abs(dy) != s && abs(dz) != s) continue; /* inner shells */
+					if ((i = find_cell(grid, ix + dx, iy + dy, iz + dz)) < 0) continue;
+					for (e = grid->tab[i].head; e >= 0; e = grid->ent[e].next)
+					{
+						if (accept && !accept(arg, e)) continue;
+						d = entry_dist(grid->ent + e, xyz);
+						if (maxdist > 0.0 && d > maxdist) continue;
+						n = add_best(ids, dist, n, k, e, d);
+					}
+				}
+			}
+		}
+	}
+	return n;
+}
+
+extern int grid_radius(grid_index_t* grid, const double* xyz, double r, int* ids, int nmax)
+{
+	int n = 0, e = 0, i = 0, s = 0, ix = 0, iy = 0, iz = 0, dx = 0, dy = 0, dz = 0;
+	if (nmax <= 0 || grid->n == 0 || r < 0.0) return 0;
+	s = (int)ceil(r / grid->cell);
+	if ((2 * s + 1) * (2 * s + 1) * (2 * s + 1) > grid->n)
+	{
+		/* sparse index, linear scan */
+		for (e = 0; e < grid->nent && n < nmax; ++e)
+		{
+			if (grid->ent[e].cell >= 0 && entry_dist(grid->ent + e, xyz) <= r) ids[n++] = e;
+		}
+		return n;
+	}
+	ix = (int)floor(xyz[0] / grid->cell);
+	iy = (int)floor(xyz[1] / grid->cell);
+	iz = (int)floor(xyz[2] / grid->cell);
+	for (dx = -s; dx <= s; ++dx)
+	{
+		for (dy = -s; dy <= s; ++dy)
+		{
+			for (dz = -s; dz <= s; ++dz)
+			{
+				if ((i = find_cell(grid, ix + dx, iy + dy, iz + dz)) < 0) continue;
+				for (e = grid->tab[i].head; e >= 0 && n < nmax; e = grid->ent[e].next)
+				{
+					if (entry_dist(grid->ent + e, xyz) <= r) ids[n++] = e;
+				}
+			}
+		}
+	}
+	return n;
+}
@@ -0,0 +1,65 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ spatial index of station coordinates (ecef), uniform grid of cubic cells in a hash
+ table, the entries are identified by the caller's slot index and can be inserted,
+ moved and removed one at a time
+ the queries visit the cells shell by shell around the query point, so the cost
+ depends on the stations near the point and not on the number of stations
+*/
+#ifndef _GNSS_GRID_H_
+#define _GNSS_GRID_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+
+typedef struct
+{
+	double xyz[3];  /* coordinate (ecef) (m) */
+	int cell;       /* hash slot of the cell, -1: not in the index */
+	int prev;       /* previous and next entry of the same cell, -1: none */
+	int next;
+}grid_entry_t;
+
+typedef struct
+{
+	int ix, iy, iz; /* cell coordinate */
+	int head;       /* first entry of the cell, -1: empty */
+	int used;       /* 1: slot used by the cell */
+}grid_cell_t;
+
+typedef struct
+{
+	double cell;         /* cell size (m) */
+	grid_entry_t* ent;   /* entries by id */
+	int nent;            /* size of ent */
+	int n;               /* number of entries in the index */
+	grid_cell_t* tab;    /* hash table of the cells (power of 2) */
+	int ntab;
+	int nused;           /* used slots of tab */
+}grid_index_t;
+
+/* accept the entry of a query, return 1: use, 0: skip */
+typedef int (*grid_accept_t)(void* arg, int id);
+
+/* set the cell size of an empty index, the memory is allocated on the first insert */
+GNSSCORE_API void grid_init(grid_index_t* grid, double cell);
+GNSSCORE_API void grid_free(grid_index_t* grid);
+/* insert or move the entry id (>=0), return 1: ok, 0: no memory */
+GNSSCORE_API int  grid_update(grid_index_t* grid, int id, const double* xyz);
+GNSSCORE_API void grid_remove(grid_index_t* grid, int id);
+/* k nearest entries accepted by accept (NULL: all) within maxdist (<=0: no limit),
+*  ids and dist sorted by distance, return number of entries found (<=k) */
+GNSSCORE_API int  grid_nearest(grid_index_t* grid, const double* xyz, int k, double maxdist, grid_accept_t accept, void* arg, int* ids, double* dist);
+/* entries within radius r (any order), return number of entries found (<=nmax) */
+GNSSCORE_API int  grid_radius(grid_index_t* grid, const double* xyz, double r, int* ids, int nmax);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ station registry storage, slab pool of objects and ID hash map
+ the pool keeps a table of slab pointers, so growing the pool only reallocates the
+ table and the objects stay in place, the ID map is an open addressing table with
+ linear probing and backward shift deletion (no tombstones)
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnss_pool.h"
+
+/* object pool ---------------------------------------------------------------*/
+extern void pool_init(gnss_pool_t* pool, int size)
+{
+	memset(pool, 0, sizeof(gnss_pool_t));
+	pool->size = size;
+}
+
+extern void pool_free(gnss_pool_t* pool)
+{
+	int i = 0, size = pool->size;
+	for (i = 0; i < pool->nslab; ++i)
+	{
+		if (pool->slab[i]) free(pool->slab[i]);
+	}
+	if (pool->slab) free(pool->slab);
+	if (pool->nlive) free(pool->nlive);
+	if (pool->live) free(pool->live);
+	pool_init(pool, size);
+}
+
+extern int pool_alloc(gnss_pool_t* pool)
+{
+	uint8_t** slab = NULL;
+	int* nlive = NULL;
+	uint8_t* live = NULL;
+	int slot = 0, s = 0, nslab = 0;
+	for (slot = 0; slot < pool->nslot && pool->live[slot]; ++slot);
+	s = slot / POOL_SLAB;
+	if (s >= pool->nslab)
+	{
+		/* grow the slab table */
+		nslab = pool->nslab > 0 ? pool->nslab * 2 : 4;
+		if (!(slab = (uint8_t**)realloc(pool->slab, sizeof(uint8_t*) * nslab))) return -1;
+		pool->slab = slab;
+		if (!(nlive = (int*)realloc(pool->nlive, sizeof(int) * nslab))) return -1;
+		pool->nlive = nlive;
+		if (!(live = (uint8_t*)realloc(pool->live, (size_t)nslab * POOL_SLAB))) return -1;
+		pool->live = live;
+		memset(pool->slab + pool->nslab, 0, sizeof(uint8_t*) * (nslab - pool->nslab));
+		memset(pool->nlive + pool->nslab, 0, sizeof(int) * (nslab - pool->nslab));
+		memset(pool->live + pool->nslab * POOL_SLAB, 0, (size_t)(nslab - pool->nslab) * POOL_SLAB);
+		pool->nslab = nslab;
+	}
+	if (!pool->slab[s] && !(pool->slab[s] = (uint8_t*)malloc((size_t)pool->size * POOL_SLAB))) return -1;
+	memset(pool->slab[s] + (size_t)pool->size * (slot % POOL_SLAB), 0, pool->size);
+	pool->live[slot] = 1;
+	++pool->nlive[s];
+	++pool->n;
+	if (slot >= pool->nslot) pool->nslot = slot + 1;
+	return slot;
+}
+
+extern void pool_release(gnss_pool_t* pool, int slot)
+{
+	int s = slot / POOL_SLAB;
+	if (slot < 0 || slot >= pool->nslot || !pool->live[slot]) return;
+	pool->live[slot] = 0;
+	--pool->n;
+	if (--pool->nlive[s] == 0)
+	{
+		free(pool->slab[s]);
+		pool->slab[s] = NULL;
+	}
+	while (pool->nslot > 0 && !pool->live[pool->nslot - 1]) --pool->nslot;
+}
+
+extern void* pool_get(const gnss_pool_t* pool, int slot)
+{
+	if (slot < 0 || slot >= pool->nslot || !pool->live[slot]) return NULL;
+	return pool->slab[slot / POOL_SLAB] + (size_t)pool->size * (slot % POOL_SLAB);
+}
+
+/* ID map --------------------------------------------------------------------*/
+static int idmap_hash(int id, int size)
+{
+	return (int)(((uint32_t)id * 2654435761u) & (uint32_t)(size - 1));
+}
+
+static int idmap_grow(id_map_t* map)
+{
+	id_map_t tmp;
+	int i = 0, j = 0;
+	tmp.size = map->size > 0 ? map->size * 2 : 64;
+	tmp.n = map->n;
+	tmp.key = (int*)calloc(tmp.size, sizeof(int));
+	tmp.val = (int*)calloc(tmp.size, sizeof(int));
+	if (!tmp.key || !tmp.val)
+	{
+		if (tmp.key) free(tmp.key);
+		if (tmp.val) free(tmp.val);
+		return 0;
+	}
+	for (i = 0; i < map->size; ++i)
+	{
+		if (map->key[i] == 0) continue;
+		for (j = idmap_hash(map->key[i], tmp.size); tmp.key[j]; j = (j + 1) & (tmp.size - 1));
+		tmp.key[j] = map->key[i];
+		tmp.val[j] = map->val[i];
+	}
+	idmap_free(map);
+	*map = tmp;
+	return 1;
+}
+
+extern void idmap_init(id_map_t* map)
+{
+	memset(map, 0, sizeof(id_map_t));
+}
+
+extern void idmap_free(id_map_t* map)
+{
+	if (map->key) free(map->key);
+	if (map->val) free(map->val);
+	idmap_init(map);
+}
+
+extern int idmap_get(const id_map_t* map, int id)
+{
+	int i = 0;
+	if (id == 0 || map->size == 0) return -1;
+	for (i = idmap_hash(id, map->size); map->key[i]; i = (i + 1) & (map->size - 1))
+	{
+		if (map->key[i] == id) return map->val[i];
+	}
+	return -1;
+}
+
+extern int idmap_set(id_map_t* map, int id, int slot)
+{
+	int i = 0;
+	if (id == 0) return 0;
+	if ((map->n + 1) * 2 > map->size && !idmap_grow(map)) return 0;
+	for (i = idmap_hash(id, map->size); map->key[i]; i = (i + 1) & (map->size - 1))
+	{
+		if (map->key[i] == id)
+		{
+			map->val[i] = slot;
+			return 1;
+		}
+	}
+	map->key[i] = id;
+	map->val[i] = slot;
+	++map->n;
+	return 1;
+}
+
+extern void idmap_del(id_map_t* map, int id)
+{
+	int i = 0, j = 0, h = 0, mask = map->size - 1;
+	if (id == 0 || map->size == 0) return;
+	for (i = idmap_hash(id, map->size); map->key[i] && map->key[i] != id; i = (i + 1) & mask);
+	if (!map->key[i]) return;
+	/* backward shift, move up the entries which would not be found behind the hole */
+	for (j = (i + 1) & mask; map->key[j]; j = (j + 1) & mask)
+	{
+		h = idmap_hash(map->key[j], map->size);
+		if (((j - h) & mask) >= ((j - i) & mask))
+		{
+			map->key[i] = map->key[j];
+			map->val[i] = map->val[j];
+			i = j;
+		}
+	}
+	map->key[i] = 0;
+	--map->n;
+}
@@ -0,0 +1,65 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ station registry storage
+ gnss_pool_t: growable pool of fixed size objects allocated in slabs, an object is
+ addressed by its slot index (handle) and never moves while it is allocated, a slab
+ is freed when its last object is released
+ id_map_t: hash map of station ID (non-zero) to slot index
+*/
+#ifndef _GNSS_POOL_H_
+#define _GNSS_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+
+#include <stdint.h>
+
+#ifndef POOL_SLAB
+#define POOL_SLAB 4 /* objects per slab */
+#endif
+
+typedef struct
+{
+	int size;        /* object size (bytes) */
+	uint8_t** slab;  /* slabs of POOL_SLAB objects, NULL: not allocated */
+	int* nlive;      /* allocated objects of each slab */
+	uint8_t* live;   /* 1: slot allocated, by slot */
+	int nslab;       /* size of slab and nlive */
+	int nslot;       /* slots in use are below nslot */
+	int n;           /* number of allocated objects */
+}gnss_pool_t;
+
+typedef struct
+{
+	int* key;        /* station ID, 0: empty */
+	int* val;        /* slot index */
+	int size;        /* table size (power of 2) */
+	int n;           /* number of IDs */
+}id_map_t;
+
+GNSSCORE_API void  pool_init(gnss_pool_t* pool, int size);
+GNSSCORE_API void  pool_free(gnss_pool_t* pool);
+/* allocate a zeroed object in the lowest free slot, return slot, -1: no memory */
+GNSSCORE_API int   pool_alloc(gnss_pool_t* pool);
+GNSSCORE_API void  pool_release(gnss_pool_t* pool, int slot);
+/* object of the slot, NULL: slot not allocated */
+GNSSCORE_API void* pool_get(const gnss_pool_t* pool, int slot);
+
+GNSSCORE_API void  idmap_init(id_map_t* map);
+GNSSCORE_API void  idmap_free(id_map_t* map);
+/* slot of the ID, -1: not found */
+GNSSCORE_API int   idmap_get(const id_map_t* map, int id);
+/* return 1: ok, 0: no memory or ID 0 */
+GNSSCORE_API int   idmap_set(id_map_t* map, int id, int slot);
+GNSSCORE_API void  idmap_del(id_map_t* map, int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ lock-free queues between the ingestion threads and the network engine
+ the byte ring publishes the data with the counter stores (head/tail), the epoch
+ ring keeps a sequence number in each slot so the producers can fill the slots in
+ place and publish them in any order
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnss_queue.h"
+
+static uint32_t round_pow2(uint32_t size)
+{
+	uint32_t n = 1;
+	while (n < size && n < 0x80000000u) n <<= 1;
+	return n;
+}
+
+/* byte queue ----------------------------------------------------------------*/
+extern int spsc_init(spsc_queue_t* q, uint32_t size)
+{
+	memset(q, 0, sizeof(spsc_queue_t));
+	q->size = round_pow2(size);
+	q->buff = (uint8_t*)malloc(q->size);
+	if (!q->buff)
+	{
+		q->size = 0;
+		return 0;
+	}
+	return 1;
+}
+extern void spsc_free(spsc_queue_t* q)
+{
+	if (q->buff) free(q->buff);
+	memset(q, 0, sizeof(spsc_queue_t));
+}
+extern int spsc_push(spsc_queue_t* q, const uint8_t* data, int nbyte)
+{
+	uint32_t head = 0, tail = 0, pos = 0, n1 = 0;
+	if (!q->buff || nbyte <= 0) return 0;
+	head = (uint32_t)gnss_atomic_get(&q->head);
+	tail = (uint32_t)q->tail; /* own counter */
+	if ((uint32_t)nbyte > q->size - (tail - head))
+	{
+		q->noverflow += nbyte;
+		return 0;
+	}
+	pos = tail & (q->size - 1);
+	n1 = q->size - pos;
+	if (n1 > (uint32_t)nbyte) n1 = nbyte;
+	memcpy(q->buff + pos, data, n1);
+	if (n1 < (uint32_t)nbyte) memcpy(q->buff, data + n1, nbyte - n1);
+	gnss_atomic_set(&q->tail, tail + (uint32_t)nbyte); /* publish */
+	return nbyte;
+}
+extern int spsc_pop(spsc_queue_t* q, uint8_t* data, int nbyte)
+{
+	uint32_t head = 0, tail = 0, pos = 0, n = 0, n1 = 0;
+	if (!q->buff || nbyte <= 0) return 0;
+	tail = (uint32_t)gnss_atomic_get(&q->tail);
+	head = (uint32_t)q->head; /* own counter */
+	n = tail - head;
+	if (n > (uint32_t)nbyte) n = nbyte;
+	if (n == 0) return 0;
+	pos = head & (q->size - 1);
+	n1 = q->size - pos;
+	if (n1 > n) n1 = n;
+	memcpy(data, q->buff + pos, n1);
+	if (n1 < n) memcpy(data + n1, q->buff, n - n1);
+	gnss_atomic_set(&q->head, head + n); /* release the room */
+	return (int)n;
+}
+extern int spsc_count(spsc_queue_t* q)
+{
+	if (!q->buff) return 0;
+	return (int)((uint32_t)gnss_atomic_get(&q->tail) - (uint32_t)gnss_atomic_get(&q->head));
+}
+
+/* epoch queue ---------------------------------------------------------------*/
+extern int epoch_queue_init(epoch_queue_t* q, uint32_t size)
+{
+	uint32_t i = 0;
+	memset(q, 0, sizeof(epoch_queue_t));
+	q->size = round_pow2(size);
+	q->slot = (epoch_slot_t*)malloc(sizeof(epoch_slot_t) * q->size);
+	if (!q->slot)
+	{
+		q->size = 0;
+		return 0;
+	}
+	for (i = 0; i < q->size; ++i)
+	{
+		q->slot[i].seq = (long)i;
+		q->slot[i].staid = 0;
+	}
+	return 1;
+}
+extern void epoch_queue_free(epoch_queue_t* q)
+{
+	if (q->slot) free(q->slot);
+	memset(q, 0, sizeof(epoch_queue_t));
+}
+extern int epoch_queue_resize(epoch_queue_t* q, uint32_t size)
+{
+	epoch_queue_t tmp;
+	epoch_slot_t* slot = NULL;
+	uint32_t n = 0;
+	if (round_pow2(size) <= q->size) return 1;
+	if (!epoch_queue_init(&tmp, size)) return 0;
+	while ((slot = epoch_queue_front(q)) != NULL)
+	{
+		tmp.slot[n].staid = slot->staid;
+		tmp.slot[n].epoch = slot->epoch;
+		tmp.slot[n].seq = (long)(n + 1); /* ready for the consumer */
+		epoch_queue_pop(q);
+		++n;
+	}
+	tmp.tail = (long)n;
+	tmp.nfull = q->nfull;
+	epoch_queue_free(q);
+	*q = tmp;
+	return 1;
+}
+extern epoch_slot_t* epoch_queue_reserve(epoch_queue_t* q)
+{
+	epoch_slot_t* slot = NULL;
+	uint32_t pos = 0, seq = 0;
+	int32_t dif = 0;
+	if (!q->slot) return NULL;
+	pos = (uint32_t)gnss_atomic_get(&q->tail);
+	while (1)
+	{
+		slot = q->slot + (pos & (q->size - 1));
+		seq = (uint32_t)gnss_atomic_get(&slot->seq);
+		dif = (int32_t)(seq - pos);
+		if (dif == 0)
+		{
+			if (gnss_atomic_cas(&q->tail, pos, pos + 1)) return slot;
+		}
+		else if (dif < 0)
+		{
+			gnss_atomic_add(&q->nfull, 1);
+			return NULL;
+		}
+		pos = (uint32_t)gnss_atomic_get(&q->tail);
+	}
+}
+extern void epoch_queue_commit(epoch_queue_t* q, epoch_slot_t* slot)
+{
+	uint32_t seq = (uint32_t)slot->seq;
+	(void)q; /* the slot carries its sequence */
+	gnss_atomic_set(&slot->seq, seq + 1);
+}
+extern epoch_slot_t* epoch_queue_front(epoch_queue_t* q)
+{
+	epoch_slot_t* slot = NULL;
+	if (!q->slot) return NULL;
+	slot = q->slot + (q->head & (q->size - 1));
+	if ((uint32_t)gnss_atomic_get(&slot->seq) != q->head + 1) return NULL;
+	return slot;
+}
+extern void epoch_queue_pop(epoch_queue_t* q)
+{
+	epoch_slot_t* slot = q->slot + (q->head & (q->size - 1));
+	gnss_atomic_set(&slot->seq, q->head + q->size);
+	++q->head;
+}
@@ -0,0 +1,75 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ lock-free queues between the ingestion threads and the network engine
+ spsc_queue_t: byte ring, one producer (caster connection) and one consumer (decode worker)
+ epoch_queue_t: bounded ring of epochs, many producers (decode workers) and one consumer (network engine)
+*/
+#ifndef _GNSS_QUEUE_H_
+#define _GNSS_QUEUE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+#include "gnss_obs.h"
+#include "gnss_thread.h"
+
+#include <stdint.h>
+
+typedef struct
+{
+	uint8_t* buff;        /* ring buffer */
+	uint32_t size;        /* ring size (power of 2) */
+	gnss_atomic_t head;   /* read count, written by the consumer only */
+	gnss_atomic_t tail;   /* write count, written by the producer only */
+	uint64_t noverflow;   /* number of bytes dropped by the producer (queue full) */
+}spsc_queue_t;
+
+/* size is rounded up to a power of 2, return 1: ok, 0: no memory */
+GNSSCORE_API int  spsc_init(spsc_queue_t* q, uint32_t size);
+GNSSCORE_API void spsc_free(spsc_queue_t* q);
+/* producer, the block is queued completely or dropped when there is no room, return bytes queued */
+GNSSCORE_API int  spsc_push(spsc_queue_t* q, const uint8_t* data, int nbyte);
+/* consumer, return bytes copied to data (up to nbyte) */
+GNSSCORE_API int  spsc_pop(spsc_queue_t* q, uint8_t* data, int nbyte);
+/* number of bytes waiting in the queue */
+GNSSCORE_API int  spsc_count(spsc_queue_t* q);
+
+typedef struct
+{
+	gnss_atomic_t seq;    /* slot sequence, pos: free for the producer of pos, pos+1: ready for the consumer */
+	int staid;            /* station id of the epoch, 0: empty slot (no valid data) */
+	epoch_t epoch;
+}epoch_slot_t;
+
+typedef struct
+{
+	epoch_slot_t* slot;
+	uint32_t size;        /* number of slots (power of 2) */
+	gnss_atomic_t tail;   /* next slot to reserve, shared by the producers */
+	uint32_t head;        /* next slot to read, consumer only */
+	gnss_atomic_t nfull;  /* number of reserve calls failed for a full queue */
+}epoch_queue_t;
+
+GNSSCORE_API int  epoch_queue_init(epoch_queue_t* q, uint32_t size);
+GNSSCORE_API void epoch_queue_free(epoch_queue_t* q);
+/* grow the queue to size slots, the queued epochs are kept in order, no producer or consumer may
+   use the queue during the call, return 1: ok, 0: no memory (the queue is not changed) */
+GNSSCORE_API int  epoch_queue_resize(epoch_queue_t* q, uint32_t size);
+/* producer, reserve the next slot and fill it in place, NULL: queue full */
+GNSSCORE_API epoch_slot_t* epoch_queue_reserve(epoch_queue_t* q);
+/* producer, publish the reserved slot */
+GNSSCORE_API void epoch_queue_commit(epoch_queue_t* q, epoch_slot_t* slot);
+/* consumer, get the next published slot (in reserve order), NULL: empty */
+GNSSCORE_API epoch_slot_t* epoch_queue_front(epoch_queue_t* q);
+/* consumer, release the slot returned by epoch_queue_front */
+GNSSCORE_API void epoch_queue_pop(epoch_queue_t* q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
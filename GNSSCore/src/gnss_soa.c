@@ -0,0 +1,139 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ structure of arrays epoch store, conversion from and to epoch_t
+*/
+#include <math.h>
+#include <string.h>
+
+#include "gnss_soa.h"
+
+/* satellite with position and velocity (same test as make_vrs_measurement) */
+static int is_vec_valid(const sat_vec_t* vec)
+{
+	const double* v = vec->rs + 3;
+	return sqrt(vec->rs[0] * vec->rs[0] + vec->rs[1] * vec->rs[1] + vec->rs[2] * vec->rs[2]) >= 1.0 &&
+		sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) >= 1.0;
+}
+
+extern void epoch2soa(const epoch_t* epoch, epoch_soa_t* soa)
+{
+	const sat_obs_t* obs = epoch->obs;
+	const sat_vec_t* vec = epoch->vec;
+	int i = 0, j = 0, n = epoch->n < MAX_SAT ? epoch->n : MAX_SAT;
+	soa->n = n;
+	soa->wk = epoch->wk;
+	soa->ws = epoch->ws;
+	memcpy(soa->pos, epoch->pos, sizeof(soa->pos));
+	memset(soa->valid, 0, sizeof(soa->valid));
+	for (i = 0; i < n; ++i, ++obs, ++vec)
+	{
+		soa->sat[i] = obs->sat;
+		soa->sys[i] = obs->sys;
+		soa->prn[i] = obs->prn;
+		for (j = 0; j < MAX_FRQ; ++j)
+		{
+			soa->P[j][i] = obs->P[j];
+			soa->L[j][i] = obs->L[j];
+			soa->wave[j][i] = obs->wave[j];
+			soa->D[j][i] = obs->D[j];
+			soa->offset[j][i] = obs->offset[j];
+			soa->SNR[j][i] = obs->SNR[j];
+			soa->LLI[j][i] = obs->LLI[j];
+			soa->code[j][i] = obs->code[j];
+		}
+		for (j = 0; j < 6; ++j) soa->rs[j][i] = vec->rs[j];
+		for (j = 0; j < 3; ++j) soa->e[j][i] = vec->e[j];
+		for (j = 0; j < 2; ++j)
+		{
+			soa->dts[j][i] = vec->dts[j];
+			soa->azel[j][i] = vec->azel[j];
+		}
+		soa->var[i] = vec->var;
+		soa->tgd[i] = vec->tgd;
+		soa->r[i] = vec->r;
+		soa->tro[i] = vec->tro;
+		soa->vsat[i] = vec->sat;
+		soa->svh[i] = vec->svh;
+		if (is_vec_valid(vec)) soa->valid[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+}
+
+extern void soa2epoch(const epoch_soa_t* soa, epoch_t* epoch)
+{
+	sat_obs_t* obs = epoch->obs;
+	sat_vec_t* vec = epoch->vec;
+	int i = 0, j = 0;
+	epoch->n = soa->n;
+	epoch->wk = soa->wk;
+	epoch->ws = soa->ws;
+	memcpy(epoch->pos, soa->pos, sizeof(epoch->pos));
+	for (i = 0; i < soa->n; ++i, ++obs, ++vec)
+	{
+		obs->sat = soa->sat[i];
+		obs->sys = soa->sys[i];
+		obs->prn = soa->prn[i];
+		for (j = 0; j < MAX_FRQ; ++j)
+		{
+			obs->P[j] = soa->P[j][i];
+			obs->L[j] = soa->L[j][i];
+			obs->wave[j] = soa->wave[j][i];
+			obs->D[j] = soa->D[j][i];
+			obs->offset[j] = soa->offset[j][i];
+			obs->SNR[j] = soa->SNR[j][i];
+			obs->LLI[j] = soa->LLI[j][i];
+			obs->code[j] = soa->code[j][i];
+		}
+		for (j = 0; j < 6; ++j) vec->rs[j] = soa->rs[j][i];
+		for (j = 0; j < 3; ++j) vec->e[j] = soa->e[j][i];
+		for (j = 0; j < 2; ++j)
+		{
+			vec->dts[j] = soa->dts[j][i];
+			vec->azel[j] = soa->azel[j][i];
+		}
+		vec->var = soa->var[i];
+		vec->tgd = soa->tgd[i];
+		vec->r = soa->r[i];
+		vec->tro = soa->tro[i];
+		vec->sat = soa->vsat[i];
+		vec->svh = soa->svh[i];
+	}
+}
+
+#define SOA_GATHER(d, s, idx, n) do { int i_; for (i_ = 0; i_ < (n); ++i_) (d)[i_] = (s)[(idx)[i_]]; } while (0)
+
+extern void soa_select(epoch_soa_t* dst, const epoch_soa_t* src, const int* idx, int n)
+{
+	int k = 0;
+	dst->n = n;
+	SOA_GATHER(dst->sat, src->sat, idx, n);
+	SOA_GATHER(dst->sys, src->sys, idx, n);
+	SOA_GATHER(dst->prn, src->prn, idx, n);
+	for (k = 0; k < MAX_FRQ; ++k)
+	{
+		SOA_GATHER(dst->P[k], src->P[k], idx, n);
+		SOA_GATHER(dst->L[k], src->L[k], idx, n);
+		SOA_GATHER(dst->wave[k], src->wave[k], idx, n);
+		SOA_GATHER(dst->D[k], src->D[k], idx, n);
+		SOA_GATHER(dst->offset[k], src->offset[k], idx, n);
+		SOA_GATHER(dst->SNR[k], src->SNR[k], idx, n);
+		SOA_GATHER(dst->LLI[k], src->LLI[k], idx, n);
+		SOA_GATHER(dst->code[k], src->code[k], idx, n);
+	}
+	for (k = 0; k < 6; ++k) SOA_GATHER(dst->rs[k], src->rs[k], idx, n);
+	for (k = 0; k < 3; ++k) SOA_GATHER(dst->e[k], src->e[k], idx, n);
+	for (k = 0; k < 2; ++k)
+	{
+		SOA_GATHER(dst->dts[k], src->dts[k], idx, n);
+		SOA_GATHER(dst->azel[k], src->azel[k], idx, n);
+	}
+	SOA_GATHER(dst->var, src->var, idx, n);
+	SOA_GATHER(dst->tgd, src->tgd, idx, n);
+	SOA_GATHER(dst->r, src->r, idx, n);
+	SOA_GATHER(dst->tro, src->tro, idx, n);
+	SOA_GATHER(dst->vsat, src->vsat, idx, n);
+	SOA_GATHER(dst->svh, src->svh, idx, n);
+	memset(dst->valid, 0, sizeof(dst->valid));
+	for (k = 0; k < n; ++k) dst->valid[k >> 6] |= ((src->valid[idx[k] >> 6] >> (idx[k] & 63)) & 1) << (k & 63);
+}
@@ -0,0 +1,62 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ structure of arrays epoch store, the same content as epoch_t with each field of the
+ satellites in its own array (per frequency for the observations), so the vrs loops
+ stream only the pseudoranges, phases, wavelengths and satellite vectors they use
+*/
+#ifndef _GNSS_SOA_H_
+#define _GNSS_SOA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+#include "gnss_obs.h"
+
+#include <stdint.h>
+
+#define SOA_WORDS ((MAX_SAT + 63) / 64) /* words of the satellite bitmask */
+
+typedef struct
+{
+	int n; /* number of satellites */
+	int wk;
+	double ws;
+	double pos[3];
+	uint64_t valid[SOA_WORDS]; /* bit i: satellite i has position and velocity */
+	/* observations */
+	uint8_t sat[MAX_SAT], sys[MAX_SAT], prn[MAX_SAT];
+	double P[MAX_FRQ][MAX_SAT]; /* pseudorange (m) */
+	double L[MAX_FRQ][MAX_SAT]; /* carrier-phase (cycle) */
+	double wave[MAX_FRQ][MAX_SAT]; /* wavelength (m) */
+	float D[MAX_FRQ][MAX_SAT];
+	double offset[MAX_FRQ][MAX_SAT];
+	uint16_t SNR[MAX_FRQ][MAX_SAT];
+	uint8_t LLI[MAX_FRQ][MAX_SAT];
+	uint8_t code[MAX_FRQ][MAX_SAT];
+	/* satellite vectors */
+	double rs[6][MAX_SAT]; /* position and velocity (ecef) */
+	double e[3][MAX_SAT]; /* receiver-to-satellite unit vector (ecef) */
+	double dts[2][MAX_SAT];
+	double azel[2][MAX_SAT];
+	double var[MAX_SAT], tgd[MAX_SAT], r[MAX_SAT], tro[MAX_SAT];
+	int vsat[MAX_SAT], svh[MAX_SAT];
+}epoch_soa_t;
+
+#define soa_is_valid(soa, i) (((soa)->valid[(i) >> 6] >> ((i) & 63)) & 1)
+
+/* conversion, the validity mask is set from the satellite position and velocity */
+GNSSCORE_API void epoch2soa(const epoch_t* epoch, epoch_soa_t* soa);
+GNSSCORE_API void soa2epoch(const epoch_soa_t* soa, epoch_t* epoch);
+/* satellites idx[0..n-1] of src as the satellites of dst (field by field), the time and
+*  position of dst are not changed */
+GNSSCORE_API void soa_select(epoch_soa_t* dst, const epoch_soa_t* src, const int* idx, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
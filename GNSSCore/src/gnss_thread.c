@@ -0,0 +1,239 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ thin portable layer for threads, locks, condition variables and atomic counters
+*/
+#include "gnss_thread.h"
+
+#ifdef _WIN32
+#include <process.h>    /* _beginthreadex */
+#else
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static unsigned __stdcall thread_main(void* arg)
+{
+	gnss_thread_t* thread = (gnss_thread_t*)arg;
+	thread->func(thread->arg);
+	return 0;
+}
+#else
+static void* thread_main(void* arg)
+{
+	gnss_thread_t* thread = (gnss_thread_t*)arg;
+	thread->func(thread->arg);
+	return NULL;
+}
+#endif
+
+extern int gnss_thread_create(gnss_thread_t* thread, void (*func)(void*), void* arg)
+{
+	thread->func = func;
+	thread->arg = arg;
+	thread->active = 0;
+#ifdef _WIN32
+	thread->handle = (HANDLE)_beginthreadex(NULL, 0, &thread_main, (void*)thread, 0, NULL);
+	if (thread->handle == NULL) return 0;
+#else
+	if (pthread_create(&thread->handle, NULL, &thread_main, (void*)thread) != 0) return 0;
+#endif
+	thread->active = 1;
+	return 1;
+}
+extern void gnss_thread_join(gnss_thread_t* thread)
+{
+	if (!thread->active) return;
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+	thread->active = 0;
+}
+extern void gnss_thread_sleep(int ms)
+{
+#ifdef _WIN32
+	Sleep(ms < 0 ? 0 : ms);
+#else
+	struct timespec ts;
+	if (ms <= 0) { sched_yield(); return; }
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (long)(ms % 1000) * 1000000;
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+#endif
+}
+extern int64_t gnss_clock_ms(void)
+{
+#ifdef _WIN32
+	return (int64_t)GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+extern int gnss_cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* mutex ---------------------------------------------------------------------*/
+extern void gnss_lock_init(gnss_lock_t* lock)
+{
+#ifdef _WIN32
+	InitializeCriticalSection(lock);
+#else
+	pthread_mutex_init(lock, NULL);
+#endif
+}
+extern void gnss_lock_free(gnss_lock_t* lock)
+{
+#ifdef _WIN32
+	DeleteCriticalSection(lock);
+#else
+	pthread_mutex_destroy(lock);
+#endif
+}
+extern void gnss_lock(gnss_lock_t* lock)
+{
+#ifdef _WIN32
+	EnterCriticalSection(lock);
+#else
+	pthread_mutex_lock(lock);
+#endif
+}
+extern void gnss_unlock(gnss_lock_t* lock)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(lock);
+#else
+	pthread_mutex_unlock(lock);
+#endif
+}
+
+/* condition variable --------------------------------------------------------*/
+extern void gnss_cond_init(gnss_cond_t* cond)
+{
+#ifdef _WIN32
+	InitializeConditionVariable(cond);
+#else
+	pthread_cond_init(cond, NULL);
+#endif
+}
+extern void gnss_cond_free(gnss_cond_t* cond)
+{
+#ifdef _WIN32
+	/* nothing to release */
+#else
+	pthread_cond_destroy(cond);
+#endif
+}
+extern void gnss_cond_wait(gnss_cond_t* cond, gnss_lock_t* lock, int ms)
+{
+#ifdef _WIN32
+	SleepConditionVariableCS(cond, lock, ms < 0 ? INFINITE : (DWORD)ms);
+#else
+	struct timespec ts;
+	if (ms < 0)
+	{
+		pthread_cond_wait(cond, lock);
+		return;
+	}
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (long)(ms % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) { ts.tv_nsec -= 1000000000; ++ts.tv_sec; }
+	pthread_cond_timedwait(cond, lock, &ts);
+#endif
+}
+extern void gnss_cond_signal(gnss_cond_t* cond)
+{
+#ifdef _WIN32
+	WakeConditionVariable(cond);
+#else
+	pthread_cond_signal(cond);
+#endif
+}
+extern void gnss_cond_broadcast(gnss_cond_t* cond)
+{
+#ifdef _WIN32
+	WakeAllConditionVariable(cond);
+#else
+	pthread_cond_broadcast(cond);
+#endif
+}
+
+/* reader/writer lock --------------------------------------------------------*/
+extern void gnss_rwlock_init(gnss_rwlock_t* lock)
+{
+#ifdef _WIN32
+	InitializeSRWLock(lock);
+#else
+	pthread_rwlock_init(lock, NULL);
+#endif
+}
+extern void gnss_rwlock_free(gnss_rwlock_t* lock)
+{
+#ifdef _WIN32
+	/* nothing to release */
+#else
+	pthread_rwlock_destroy(lock);
+#endif
+}
+extern void gnss_rdlock(gnss_rwlock_t* lock)
+{
+#ifdef _WIN32
+	AcquireSRWLockShared(lock);
+#else
+	pthread_rwlock_rdlock(lock);
+#endif
+}
+extern void gnss_rdunlock(gnss_rwlock_t* lock)
+{
+#ifdef _WIN32
+	ReleaseSRWLockShared(lock);
+#else
+	pthread_rwlock_unlock(lock);
+#endif
+}
+extern void gnss_wrlock(gnss_rwlock_t* lock)
+{
+#ifdef _WIN32
+	AcquireSRWLockExclusive(lock);
+#else
+	pthread_rwlock_wrlock(lock);
+#endif
+}
+extern void gnss_wrunlock(gnss_rwlock_t* lock)
+{
+#ifdef _WIN32
+	ReleaseSRWLockExclusive(lock);
+#else
+	pthread_rwlock_unlock(lock);
+#endif
+}
+extern void gnss_once(gnss_once_t* once, void (*func)(void))
+{
+	/* 0: not run, 1: running, 2: done */
+	if (gnss_atomic_get(once) == 2) return;
+	if (gnss_atomic_cas(once, 0, 1))
+	{
+		func();
+		gnss_atomic_set(once, 2);
+		return;
+	}
+	while (gnss_atomic_get(once) != 2) gnss_thread_sleep(0);
+}
@@ -0,0 +1,112 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ thin portable layer for threads, locks, condition variables and atomic counters
+ (win32 api on windows, posix threads otherwise)
+*/
+#ifndef _GNSS_THREAD_H_
+#define _GNSS_THREAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef CRITICAL_SECTION   gnss_lock_t;
+typedef CONDITION_VARIABLE gnss_cond_t;
+typedef SRWLOCK            gnss_rwlock_t;
+typedef HANDLE             gnss_handle_t;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t    gnss_lock_t;
+typedef pthread_cond_t     gnss_cond_t;
+typedef pthread_rwlock_t   gnss_rwlock_t;
+typedef pthread_t          gnss_handle_t;
+#endif
+
+/* thread local storage of a static variable */
+#ifdef _MSC_VER
+#define GNSS_THREAD_LOCAL __declspec(thread)
+#else
+#define GNSS_THREAD_LOCAL __thread
+#endif
+
+/* atomic integer (32 bits on windows), the unsigned 32-bit difference of two
+*  values is used for ring indices so the wrap-around is harmless */
+typedef volatile long gnss_atomic_t;
+
+typedef struct
+{
+	gnss_handle_t handle;
+	void (*func)(void*);
+	void* arg;
+	int active;
+}gnss_thread_t;
+
+/* thread, func(arg) runs in the new thread, return 1: ok, 0: error */
+GNSSCORE_API int  gnss_thread_create(gnss_thread_t* thread, void (*func)(void*), void* arg);
+GNSSCORE_API void gnss_thread_join(gnss_thread_t* thread);
+GNSSCORE_API void gnss_thread_sleep(int ms);
+/* monotonic clock (ms) */
+GNSSCORE_API int64_t gnss_clock_ms(void);
+GNSSCORE_API int  gnss_cpu_count(void);
+
+/* mutex */
+GNSSCORE_API void gnss_lock_init(gnss_lock_t* lock);
+GNSSCORE_API void gnss_lock_free(gnss_lock_t* lock);
+GNSSCORE_API void gnss_lock(gnss_lock_t* lock);
+GNSSCORE_API void gnss_unlock(gnss_lock_t* lock);
+
+/* condition variable, wait with the lock held, return after signal or ms */
+GNSSCORE_API void gnss_cond_init(gnss_cond_t* cond);
+GNSSCORE_API void gnss_cond_free(gnss_cond_t* cond);
+GNSSCORE_API void gnss_cond_wait(gnss_cond_t* cond, gnss_lock_t* lock, int ms);
+GNSSCORE_API void gnss_cond_signal(gnss_cond_t* cond);
+GNSSCORE_API void gnss_cond_broadcast(gnss_cond_t* cond);
+
+/* reader/writer lock */
+GNSSCORE_API void gnss_rwlock_init(gnss_rwlock_t* lock);
+GNSSCORE_API void gnss_rwlock_free(gnss_rwlock_t* lock);
+GNSSCORE_API void gnss_rdlock(gnss_rwlock_t* lock);
+GNSSCORE_API void gnss_rdunlock(gnss_rwlock_t* lock);
+GNSSCORE_API void gnss_wrlock(gnss_rwlock_t* lock);
+GNSSCORE_API void gnss_wrunlock(gnss_rwlock_t* lock);
+
+/* atomic operations, all sequentially consistent */
+#ifdef _WIN32
+#define gnss_atomic_get(p)          InterlockedOr((p), 0)
+#define gnss_atomic_set(p,v)        ((void)InterlockedExchange((p), (long)(v)))
+#define gnss_atomic_add(p,v)        InterlockedExchangeAdd((p), (long)(v))  /* return old value */
+#define gnss_atomic_cas(p,o,n)      (InterlockedCompareExchange((p), (long)(n), (long)(o)) == (long)(o))
+#define gnss_atomic_add64(p,v)      ((void)InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(v)))
+#else
+#define gnss_atomic_get(p)          __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define gnss_atomic_set(p,v)        __atomic_store_n((p), (long)(v), __ATOMIC_SEQ_CST)
+#define gnss_atomic_add(p,v)        __atomic_fetch_add((p), (long)(v), __ATOMIC_SEQ_CST)
+#define gnss_atomic_cas(p,o,n)      gnss_atomic_cas_(p, (long)(o), (long)(n))
+#define gnss_atomic_add64(p,v)      ((void)__atomic_fetch_add((p), (uint64_t)(v), __ATOMIC_SEQ_CST))
+static inline int gnss_atomic_cas_(gnss_atomic_t* p, long o, long n)
+{
+	return __atomic_compare_exchange_n(p, &o, n, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
+
+/* one-time initialization (static zero), func runs once, the other callers wait until it is done
+*  and see its results */
+typedef gnss_atomic_t gnss_once_t;
+GNSSCORE_API void gnss_once(gnss_once_t* once, void (*func)(void));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
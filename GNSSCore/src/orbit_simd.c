@@ -0,0 +1,323 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ batch kepler orbits of the broadcast satellites of an epoch on a structure of arrays
+ three kernels compute the same orbits:
+ 1) scalar, one satellite at a time with libm trig, newton iterations of the kepler
+    equation until convergence and atan2 for the true anomaly (reference, same math
+    as eph2posvel())
+ 2) avx2+fma, 4 satellites per vector
+ 3) avx-512f, 8 satellites per vector
+ the vector kernels (orbit_simd_body.h) run a fixed number of newton iterations from
+ E=M+e*sin(M) with a polynomial sincos, check the residual of the kepler equation and
+ hand the lanes without convergence to the scalar kernel, the rotation of the beidou
+ geo satellites to ecef is done after the kernel for all of them
+ orbit_range_soa() is the range kernel of the vrs (gnss_core.c) on the same dispatch
+*/
+#include <math.h>
+#include <string.h>
+
+#include "gnss.h"
+#include "orbit_simd.h"
+#include "gnss_thread.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define ORBIT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ORBIT_AVX2_TARGET
+#define ORBIT_AVX512_TARGET
+#else
+#include <cpuid.h>
+#define ORBIT_AVX2_TARGET   __attribute__((target("avx2,fma")))
+#define ORBIT_AVX512_TARGET __attribute__((target("avx512f")))
+#endif
+#endif
+
+#define SIN_5 -0.0871557427476582 /* sin(-5.0 deg) */
+#define COS_5  0.9961946980917456 /* cos(-5.0 deg) */
+
+#define RTOL_KEPLER     1E-13     /* relative tolerance for kepler equation (scalar) */
+#define MAX_ITER_KEPLER 30        /* max number of iteration of kepler (scalar) */
+#define KEPLER_NITER    4         /* number of newton iterations (vector) */
+#define KEPLER_RESTOL   1E-12     /* max residual of kepler equation (vector) (rad) */
+
+/* pi/2 in 3 parts for the argument reduction */
+#define SINCOS_DP1 1.57079625129699707031E0
+#define SINCOS_DP2 7.54978941586159635336E-8
+#define SINCOS_DP3 5.39030285815811905290E-15
+
+static const double sincof[6]={
+    1.58962301576546568060E-10,-2.50507477628578072866E-8,
+    2.75573136213857245213E-6 ,-1.98412698295895385996E-4,
+    8.33333333332211858878E-3 ,-1.66666666666666307295E-1
+};
+static const double coscof[6]={
+   -1.13585365213876817300E-11, 2.08757008419747316778E-9,
+   -2.75573141792967388112E-7 , 2.48015872888517045348E-5,
+   -1.38888888888730564116E-3 , 4.16666666666665929218E-2
+};
+#ifdef ORBIT_X86
+static int simd_state = ORBIT_KERNEL_SCALAR; /* best kernel */
+static gnss_once_t simd_once = 0; /* cpu checked */
+#endif
+
+/* scalar kernel, one satellite -----------------------------------------------*/
+static void orbit_lane(orbit_soa_t* soa, int j)
+{
+    double nn,M,E,Ek,sinE,cosE,Ed,dp,q,u,r,i,sin2u,cos2u,ud,rd,id,x,y,xd,yd;
+    double O,Od,sinO,cosO,cosi,sini,cosu,sinu,rel,tc=soa->tc[j];
+    int k;
+
+    nn=sqrt(soa->mu[j]/(soa->A[j]*soa->A[j]*soa->A[j]))+soa->deln[j];
+    M=soa->M0[j]+nn*soa->tk[j];
+
+    for (k=0,E=M,Ek=0.0;fabs(E-Ek)>RTOL_KEPLER&&k<MAX_ITER_KEPLER;k++) {
+        Ek=E; E-=(E-soa->e[j]*sin(E)-M)/(1.0-soa->e[j]*cos(E));
+    }
+    soa->ok[j]=k<MAX_ITER_KEPLER;
+
+    sinE=sin(E); cosE=cos(E);
+    q=sqrt(1.0-soa->e[j]*soa->e[j]);
+    Ed=nn/(1.0-soa->e[j]*cosE);
+    dp=q*Ed/(1.0-soa->e[j]*cosE);
+    u=atan2(q*sinE,cosE-soa->e[j])+soa->omg[j];
+    r=soa->A[j]*(1.0-soa->e[j]*cosE);
+    i=soa->i0[j]+soa->idot[j]*soa->tk[j];
+    sin2u=sin(2.0*u); cos2u=cos(2.0*u);
+    ud=dp*(1.0+2.0*(soa->cus[j]*cos2u-soa->cuc[j]*sin2u));
+    rd=soa->A[j]*soa->e[j]*sinE*Ed+2.0*dp*(soa->crs[j]*cos2u-soa->crc[j]*sin2u);
+    id=soa->idot[j]+2.0*dp*(soa->cis[j]*cos2u-soa->cic[j]*sin2u);
+    u+=soa->cus[j]*sin2u+soa->cuc[j]*cos2u;
+    r+=soa->crs[j]*sin2u+soa->crc[j]*cos2u;
+    i+=soa->cis[j]*sin2u+soa->cic[j]*cos2u;
+    cosu=cos(u); sinu=sin(u); cosi=cos(i); sini=sin(i);
+    x=r*cosu; y=r*sinu;
+    xd=rd*cosu-y*ud;
+    yd=rd*sinu+x*ud;
+    Od=soa->OMGd[j]-soa->omge[j]*(1.0-soa->geo[j]);
+    O=soa->OMG0[j]+Od*soa->tk[j]-soa->omge[j]*soa->toes[j];
+    sinO=sin(O); cosO=cos(O);
+    soa->rs[0][j]=x*cosO-y*cosi*sinO;
+    soa->rs[1][j]=x*sinO+y*cosi*cosO;
+    soa->rs[2][j]=y*sini;
+    soa->rs[3][j]=xd*cosO-yd*cosi*sinO+y*sini*sinO*id-soa->rs[1][j]*Od;
+    soa->rs[4][j]=xd*sinO+yd*cosi*cosO-y*sini*cosO*id+soa->rs[0][j]*Od;
+    soa->rs[5][j]=yd*sini+y*cosi*id;
+    rel=2.0*sqrt(soa->mu[j]*soa->A[j])*soa->e[j]/(CLIGHT*CLIGHT);
+    soa->dts[0][j]=soa->f0[j]+soa->f1[j]*tc+soa->f2[j]*tc*tc-rel*sinE;
+    soa->dts[1][j]=soa->f1[j]+2.0*soa->f2[j]*tc-rel*cosE*Ed;
+}
+#ifdef ORBIT_X86
+/* avx2+fma kernel ------------------------------------------------------------*/
+#define V           __m256d
+#define VM          __m256d
+#define VN          4
+#define VTARGET     ORBIT_AVX2_TARGET
+#define VFUNC(f)    f##_avx2
+#define VSET(a)     _mm256_set1_pd(a)
+#define VLD(p)      _mm256_loadu_pd(p)
+#define VST(p,a)    _mm256_storeu_pd(p,a)
+#define VADD(a,b)   _mm256_add_pd(a,b)
+#define VSUB(a,b)   _mm256_sub_pd(a,b)
+#define VMUL(a,b)   _mm256_mul_pd(a,b)
+#define VDIV(a,b)   _mm256_div_pd(a,b)
+#define VFMA(a,b,c) _mm256_fmadd_pd(a,b,c)
+#define VFNMA(a,b,c) _mm256_fnmadd_pd(a,b,c)
+#define VSQRT(a)    _mm256_sqrt_pd(a)
+#define VRND(a)     _mm256_round_pd(a,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC)
+#define VFLOOR(a)   _mm256_round_pd(a,_MM_FROUND_TO_NEG_INF|_MM_FROUND_NO_EXC)
+#define VABS(a)     _mm256_andnot_pd(_mm256_set1_pd(-0.0),a)
+#define VLT(a,b)    _mm256_cmp_pd(a,b,_CMP_LT_OQ)
+#define VBLEND(m,a,b) _mm256_blendv_pd(a,b,m)
+#include "orbit_simd_body.h"
+#undef V
+#undef VM
+#undef VN
+#undef VTARGET
+#undef VFUNC
+#undef VSET
+#undef VLD
+#undef VST
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VDIV
+#undef VFMA
+#undef VFNMA
+#undef VSQRT
+#undef VRND
+#undef VFLOOR
+#undef VABS
+#undef VLT
+#undef VBLEND
+
+/* avx-512f kernel ------------------------------------------------------------*/
+#define V           __m512d
+#define VM          __mmask8
+#define VN          8
+#define VTARGET     ORBIT_AVX512_TARGET
+#define VFUNC(f)    f##_avx512
+#define VSET(a)     _mm512_set1_pd(a)
+#define VLD(p)      _mm512_loadu_pd(p)
+#define VST(p,a)    _mm512_storeu_pd(p,a)
+#define VADD(a,b)   _mm512_add_pd(a,b)
+#define VSUB(a,b)   _mm512_sub_pd(a,b)
+#define VMUL(a,b)   _mm512_mul_pd(a,b)
+#define VDIV(a,b)   _mm512_div_pd(a,b)
+#define VFMA(a,b,c) _mm512_fmadd_pd(a,b,c)
+#define VFNMA(a,b,c) _mm512_fnmadd_pd(a,b,c)
+#define VSQRT(a)    _mm512_sqrt_pd(a)
+#define VRND(a)     _mm512_roundscale_pd(a,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC)
+#define VFLOOR(a)   _mm512_roundscale_pd(a,_MM_FROUND_TO_NEG_INF|_MM_FROUND_NO_EXC)
+#define VABS(a)     _mm512_abs_pd(a)
+#define VLT(a,b)    _mm512_cmp_pd_mask(a,b,_CMP_LT_OQ)
+#define VBLEND(m,a,b) _mm512_mask_blend_pd(m,a,b)
+#include "orbit_simd_body.h"
+
+/* cpu and os support of the kernels -----------------------------------------*/
+static int check_simd(void)
+{
+    unsigned int r1[4]={0},r7[4]={0};
+    unsigned long long xcr0=0;
+    int avx2,avx512;
+#ifdef _MSC_VER
+    int info[4]={0};
+    __cpuid(info,0);
+    if (info[0]<7) return ORBIT_KERNEL_SCALAR;
+    __cpuid(info,1);   memcpy(r1,info,sizeof(r1));
+    __cpuidex(info,7,0); memcpy(r7,info,sizeof(r7));
+    if (!(r1[2]&(1u<<27))) return ORBIT_KERNEL_SCALAR; /* osxsave */
+    xcr0=_xgetbv(0);
+#else
+    unsigned int lo=0,hi=0;
+    if (__get_cpuid_max(0,NULL)<7) return ORBIT_KERNEL_SCALAR;
+    __get_cpuid(1,r1,r1+1,r1+2,r1+3);
+    __cpuid_count(7,0,r7[0],r7[1],r7[2],r7[3]);
+    if (!(r1[2]&(1u<<27))) return ORBIT_KERNEL_SCALAR; /* osxsave */
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    xcr0=((unsigned long long)hi<<32)|lo;
+#endif
+    avx2=(r1[2]&(1u<<28))&&(r1[2]&(1u<<12))&&(r7[1]&(1u<<5))&& /* avx, fma, avx2 */
+         (xcr0&0x6)==0x6;                                       /* xmm, ymm state */
+    avx512=avx2&&(r7[1]&(1u<<16))&&(xcr0&0xE6)==0xE6;           /* avx512f, zmm and mask state */
+    return avx512?ORBIT_KERNEL_AVX512:(avx2?ORBIT_KERNEL_AVX2:ORBIT_KERNEL_SCALAR);
+}
+static void init_simd(void)
+{
+    simd_state=check_simd();
+}
+#endif
+extern int orbit_simd_kernel(void)
+{
+#ifdef ORBIT_X86
+    gnss_once(&simd_once,init_simd);
+    return simd_state;
+#else
+    return ORBIT_KERNEL_SCALAR;
+#endif
+}
+extern int orbit_simd_supported(int kernel)
+{
+    return kernel>=ORBIT_KERNEL_SCALAR&&kernel<=orbit_simd_kernel();
+}
+extern const char* orbit_simd_name(int kernel)
+{
+    switch (kernel) {
+        case ORBIT_KERNEL_AVX2  : return "avx2";
+        case ORBIT_KERNEL_AVX512: return "avx512";
+    }
+    return "scalar";
+}
+/* padding lanes, circular orbit at the origin of time -------------------------*/
+static void orbit_pad(orbit_soa_t* soa, int n)
+{
+    int j;
+
+    for (j=soa->n;j<n;j++) {
+        soa->tk[j]=soa->tc[j]=soa->geo[j]=soa->e[j]=0.0;
+        soa->i0[j]=soa->OMG0[j]=soa->omg[j]=soa->M0[j]=soa->deln[j]=0.0;
+        soa->OMGd[j]=soa->idot[j]=soa->toes[j]=soa->omge[j]=0.0;
+        soa->crc[j]=soa->crs[j]=soa->cuc[j]=soa->cus[j]=soa->cic[j]=soa->cis[j]=0.0;
+        soa->f0[j]=soa->f1[j]=soa->f2[j]=0.0;
+        soa->mu[j]=soa->A[j]=1.0;
+    }
+}
+/* batch orbits --------------------------------------------------------------*/
+extern void orbit_soa_compute(orbit_soa_t* soa, int kernel)
+{
+    double x,y,z,v[3],sino,coso,omge;
+    int j,k;
+
+    if (soa->n<=0) return;
+    if (soa->n>ORBIT_SOA_MAX) soa->n=ORBIT_SOA_MAX;
+    if (!orbit_simd_supported(kernel)) kernel=orbit_simd_kernel();
+
+    switch (kernel) {
+#ifdef ORBIT_X86
+        case ORBIT_KERNEL_AVX2:
+            orbit_pad(soa,(soa->n+3)&~3);
+            orbit_kernel_avx2(soa);
+            break;
+        case ORBIT_KERNEL_AVX512:
+            orbit_pad(soa,(soa->n+7)&~7);
+            orbit_kernel_avx512(soa);
+            break;
+#endif
+        default:
+            for (j=0;j<soa->n;j++) orbit_lane(soa,j);
+            break;
+    }
+    for (j=0;j<soa->n;j++) {
+
+        /* lanes of the vector kernels without convergence */
+        if (!soa->ok[j]&&kernel!=ORBIT_KERNEL_SCALAR) orbit_lane(soa,j);
+
+        if (!soa->ok[j]) {
+            for (k=0;k<6;k++) soa->rs[k][j]=0.0;
+            soa->dts[0][j]=soa->dts[1][j]=0.0;
+            continue;
+        }
+        if (soa->geo[j]==0.0) continue;
+
+        /* beidou geo satellites, inertial to ecef */
+        x=soa->rs[0][j]; y=soa->rs[1][j]; z=soa->rs[2][j];
+        for (k=0;k<3;k++) v[k]=soa->rs[k+3][j];
+        omge=soa->omge[j];
+        sino=sin(omge*soa->tk[j]); coso=cos(omge*soa->tk[j]);
+        soa->rs[0][j]= x*coso+y*sino*COS_5+z*sino*SIN_5;
+        soa->rs[1][j]=-x*sino+y*coso*COS_5+z*coso*SIN_5;
+        soa->rs[2][j]=-y*SIN_5+z*COS_5;
+        soa->rs[3][j]= v[0]*coso+v[1]*sino*COS_5+v[2]*sino*SIN_5+omge*soa->rs[1][j];
+        soa->rs[4][j]=-v[0]*sino+v[1]*coso*COS_5+v[2]*coso*SIN_5-omge*soa->rs[0][j];
+        soa->rs[5][j]=-v[1]*SIN_5+v[2]*COS_5;
+    }
+}
+/* ranges from a site -------------------------------------------------------*/
+extern void orbit_range_soa(const double* rr, const double* up, double trp, int n,
+                            const double* x, const double* y, const double* z,
+                            double* ex, double* ey, double* ez, double* rho, int kernel)
+{
+    double dx,dy,dz,r,u;
+    int j=0;
+
+    if (!orbit_simd_supported(kernel)) kernel=orbit_simd_kernel();
+
+    switch (kernel) {
+#ifdef ORBIT_X86
+        case ORBIT_KERNEL_AVX2  : j=range_kernel_avx2  (rr,up,trp,n,x,y,z,ex,ey,ez,rho); break;
+        case ORBIT_KERNEL_AVX512: j=range_kernel_avx512(rr,up,trp,n,x,y,z,ex,ey,ez,rho); break;
+#endif
+    }
+    /* scalar kernel and the satellites after the last full vector */
+    for (;j<n;j++) {
+        dx=x[j]-rr[0]; dy=y[j]-rr[1]; dz=z[j]-rr[2];
+        r=sqrt(dx*dx+dy*dy+dz*dz);
+        u=1.0/r;
+        ex[j]=dx*u; ey[j]=dy*u; ez[j]=dz*u;
+        u=ex[j]*up[0]+ey[j]*up[1]+ez[j]*up[2];
+        rho[j]=r+OMGE*(x[j]*rr[1]-y[j]*rr[0])/CLIGHT+(u>0.0?trp/u:0.0);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ batch kepler orbit kernels for the broadcast satellites of an epoch (gps, galileo,
+ beidou, qzss, irnss) on a structure of arrays, selected at run time with cpuid
+*/
+#ifndef _ORBIT_SIMD_H_
+#define _ORBIT_SIMD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+
+#define ORBIT_SOA_MAX       64  /* max satellites of a batch (multiple of the vector lanes) */
+
+#define ORBIT_KERNEL_SCALAR 0   /* one satellite at a time, libm trig and newton iterations until convergence (reference) */
+#define ORBIT_KERNEL_AVX2   1   /* 4 satellites per vector, avx2+fma */
+#define ORBIT_KERNEL_AVX512 2   /* 8 satellites per vector, avx-512f */
+
+typedef struct
+{
+	int n;                      /* number of satellites */
+	/* input, broadcast ephemeris parameters and times */
+	double tk[ORBIT_SOA_MAX];   /* time from toe (s) */
+	double tc[ORBIT_SOA_MAX];   /* time from toc (s) */
+	double mu[ORBIT_SOA_MAX];   /* gravitational constant of the system (m^3/s^2) */
+	double omge[ORBIT_SOA_MAX]; /* earth angular velocity of the system (rad/s) */
+	double geo[ORBIT_SOA_MAX];  /* 1.0: beidou geo satellite, 0.0: other */
+	double A[ORBIT_SOA_MAX], e[ORBIT_SOA_MAX], i0[ORBIT_SOA_MAX], OMG0[ORBIT_SOA_MAX];
+	double omg[ORBIT_SOA_MAX], M0[ORBIT_SOA_MAX], deln[ORBIT_SOA_MAX], OMGd[ORBIT_SOA_MAX];
+	double idot[ORBIT_SOA_MAX], toes[ORBIT_SOA_MAX];
+	double crc[ORBIT_SOA_MAX], crs[ORBIT_SOA_MAX], cuc[ORBIT_SOA_MAX];
+	double cus[ORBIT_SOA_MAX], cic[ORBIT_SOA_MAX], cis[ORBIT_SOA_MAX];
+	double f0[ORBIT_SOA_MAX], f1[ORBIT_SOA_MAX], f2[ORBIT_SOA_MAX];
+	/* output */
+	double rs[6][ORBIT_SOA_MAX];  /* position and velocity {x,y,z,vx,vy,vz} (ecef) (m|m/s) */
+	double dts[2][ORBIT_SOA_MAX]; /* clock bias and drift with relativity correction (s|s/s) */
+	int ok[ORBIT_SOA_MAX];        /* 1: kepler equation converged, 0: no solution (zero output) */
+}orbit_soa_t;
+
+/* positions, velocities and clocks of the satellites of the batch with the kernel,
+*  the unused lanes up to the vector size are overwritten as padding */
+GNSSCORE_API void orbit_soa_compute(orbit_soa_t* soa, int kernel);
+
+/* ranges of n satellites x,y,z (ecef) from the site rr with sagnac correction plus the
+*  troposphere delay trp/sin(el) (up: local up direction of the site), and the line-of-sight
+*  vectors ex,ey,ez, the vrs range kernel */
+GNSSCORE_API void orbit_range_soa(const double* rr, const double* up, double trp, int n,
+                                  const double* x, const double* y, const double* z,
+                                  double* ex, double* ey, double* ez, double* rho, int kernel);
+
+/* 1: kernel supported by the cpu */
+GNSSCORE_API int orbit_simd_supported(int kernel);
+/* best kernel supported by the cpu */
+GNSSCORE_API int orbit_simd_kernel(void);
+/* name of the kernel */
+GNSSCORE_API const char* orbit_simd_name(int kernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
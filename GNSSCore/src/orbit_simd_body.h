@@ -0,0 +1,157 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ vector kernel of the batch kepler orbits, included by orbit_simd.c once per
+ instruction set with the vector macros defined:
+ V, VM (vector and mask types), VN (lanes), VTARGET (function attribute), VFUNC(name),
+ VSET, VLD, VST, VADD, VSUB, VMUL, VDIV, VFMA (a*b+c), VFNMA (c-a*b), VSQRT, VRND
+ (nearest), VFLOOR, VABS, VLT (mask a<b), VBLEND (m?b:a)
+ the kepler equation is solved with a fixed number of newton iterations and the true
+ anomaly and the argument of latitude are carried as sine and cosine, so the only
+ transcendental function is the polynomial sincos below
+ the range kernel of the vrs shares the instruction sets and macros
+*/
+
+/* sine and cosine (cephes polynomials, quadrant by x*2/pi, 3 part reduction) */
+VTARGET static void VFUNC(vsincos)(V x, V* s, V* c)
+{
+    V q,z,zz,ps,pc,sn,cs,k;
+    VM swap,sneg,cneg;
+
+    q=VRND(VMUL(x,VSET(2.0/PI)));
+    z=VFNMA(q,VSET(SINCOS_DP1),x);
+    z=VFNMA(q,VSET(SINCOS_DP2),z);
+    z=VFNMA(q,VSET(SINCOS_DP3),z);
+    zz=VMUL(z,z);
+
+    ps=VFMA(VSET(sincof[0]),zz,VSET(sincof[1]));
+    ps=VFMA(ps,zz,VSET(sincof[2]));
+    ps=VFMA(ps,zz,VSET(sincof[3]));
+    ps=VFMA(ps,zz,VSET(sincof[4]));
+    ps=VFMA(ps,zz,VSET(sincof[5]));
+    sn=VFMA(VMUL(z,zz),ps,z);
+
+    pc=VFMA(VSET(coscof[0]),zz,VSET(coscof[1]));
+    pc=VFMA(pc,zz,VSET(coscof[2]));
+    pc=VFMA(pc,zz,VSET(coscof[3]));
+    pc=VFMA(pc,zz,VSET(coscof[4]));
+    pc=VFMA(pc,zz,VSET(coscof[5]));
+    cs=VFMA(VMUL(zz,zz),pc,VFNMA(VSET(0.5),zz,VSET(1.0)));
+
+    /* quadrant k=0..3: sin={s,c,-s,-c}, cos={c,-s,-c,s} */
+    k=VFNMA(VSET(4.0),VFLOOR(VMUL(q,VSET(0.25))),q);
+    swap=VLT(VSET(0.5),VFNMA(VSET(2.0),VFLOOR(VMUL(k,VSET(0.5))),k));
+    sneg=VLT(VSET(1.5),k);
+    cneg=VLT(VABS(VSUB(k,VSET(1.5))),VSET(1.0));
+    *s=VBLEND(swap,sn,cs);
+    *c=VBLEND(swap,cs,sn);
+    *s=VBLEND(sneg,*s,VSUB(VSET(0.0),*s));
+    *c=VBLEND(cneg,*c,VSUB(VSET(0.0),*c));
+}
+VTARGET static void VFUNC(orbit_kernel)(orbit_soa_t* soa)
+{
+    V tk,tc,mu,A,e,M,nn,E,sE,cE,den,q,Ed,dp,sv,cv,so,co,sp,cp,s2,c2,du,ud,rd,id;
+    V r,cdu,sdu,cu,su,x,y,xd,yd,i,si,ci,Od,O,sO,cO,rel,f;
+    double res[VN];
+    int j,k;
+
+    for (j=0;j<soa->n;j+=VN) {
+        tk=VLD(soa->tk+j); tc=VLD(soa->tc+j);
+        mu=VLD(soa->mu+j); A=VLD(soa->A+j); e=VLD(soa->e+j);
+
+        /* kepler equation, start from M+e*sin(M) */
+        nn=VADD(VSQRT(VDIV(mu,VMUL(A,VMUL(A,A)))),VLD(soa->deln+j));
+        M=VFMA(nn,tk,VLD(soa->M0+j));
+        VFUNC(vsincos)(M,&sE,&cE);
+        E=VFMA(e,sE,M);
+        for (k=0;k<KEPLER_NITER;k++) {
+            VFUNC(vsincos)(E,&sE,&cE);
+            f=VSUB(VFNMA(e,sE,E),M);
+            E=VSUB(E,VDIV(f,VFNMA(e,cE,VSET(1.0))));
+        }
+        VFUNC(vsincos)(E,&sE,&cE);
+        VST(res,VABS(VSUB(VFNMA(e,sE,E),M)));
+        for (k=0;k<VN;k++) soa->ok[j+k]=res[k]<=KEPLER_RESTOL;
+
+        /* true anomaly and argument of latitude as sine and cosine */
+        den=VFNMA(e,cE,VSET(1.0));
+        q=VSQRT(VFNMA(e,e,VSET(1.0)));
+        Ed=VDIV(nn,den);
+        dp=VDIV(VMUL(q,Ed),den);
+        sv=VDIV(VMUL(q,sE),den);
+        cv=VDIV(VSUB(cE,e),den);
+        VFUNC(vsincos)(VLD(soa->omg+j),&so,&co);
+        sp=VFMA(sv,co,VMUL(cv,so));
+        cp=VFNMA(sv,so,VMUL(cv,co));
+        s2=VMUL(VSET(2.0),VMUL(sp,cp));
+        c2=VFNMA(VSET(2.0),VMUL(sp,sp),VSET(1.0));
+
+        /* harmonic corrections and their rates */
+        du=VFMA(VLD(soa->cus+j),s2,VMUL(VLD(soa->cuc+j),c2));
+        ud=VMUL(dp,VFMA(VSET(2.0),VFNMA(VLD(soa->cuc+j),s2,VMUL(VLD(soa->cus+j),c2)),VSET(1.0)));
+        rd=VFMA(VMUL(A,VMUL(e,sE)),Ed,
+                VMUL(VMUL(VSET(2.0),dp),VFNMA(VLD(soa->crc+j),s2,VMUL(VLD(soa->crs+j),c2))));
+        id=VFMA(VMUL(VSET(2.0),dp),VFNMA(VLD(soa->cic+j),s2,VMUL(VLD(soa->cis+j),c2)),VLD(soa->idot+j));
+        r=VFMA(A,den,VFMA(VLD(soa->crs+j),s2,VMUL(VLD(soa->crc+j),c2)));
+        i=VADD(VFMA(VLD(soa->idot+j),tk,VLD(soa->i0+j)),
+               VFMA(VLD(soa->cis+j),s2,VMUL(VLD(soa->cic+j),c2)));
+
+        /* u+du with |du|<1e-4 rad by series */
+        cdu=VFNMA(VSET(0.5),VMUL(du,du),VSET(1.0));
+        cdu=VFMA(VMUL(VMUL(du,du),VMUL(du,du)),VSET(1.0/24.0),cdu);
+        sdu=VFNMA(VMUL(du,VMUL(du,du)),VSET(1.0/6.0),du);
+        cu=VFNMA(sp,sdu,VMUL(cp,cdu));
+        su=VFMA(cp,sdu,VMUL(sp,cdu));
+
+        x=VMUL(r,cu); y=VMUL(r,su);
+        xd=VFNMA(y,ud,VMUL(rd,cu));
+        yd=VFMA(x,ud,VMUL(rd,su));
+        VFUNC(vsincos)(i,&si,&ci);
+
+        /* node, beidou geo satellites in the inertial frame */
+        Od=VFNMA(VLD(soa->omge+j),VSUB(VSET(1.0),VLD(soa->geo+j)),VLD(soa->OMGd+j));
+        O=VFNMA(VLD(soa->omge+j),VLD(soa->toes+j),VFMA(Od,tk,VLD(soa->OMG0+j)));
+        VFUNC(vsincos)(O,&sO,&cO);
+
+        VST(soa->rs[0]+j,VFNMA(VMUL(y,ci),sO,VMUL(x,cO)));
+        VST(soa->rs[1]+j,VFMA(VMUL(y,ci),cO,VMUL(x,sO)));
+        VST(soa->rs[2]+j,VMUL(y,si));
+        VST(soa->rs[3]+j,VFNMA(VLD(soa->rs[1]+j),Od,
+                               VFMA(VMUL(VMUL(y,si),sO),id,VFNMA(VMUL(yd,ci),sO,VMUL(xd,cO)))));
+        VST(soa->rs[4]+j,VFMA(VLD(soa->rs[0]+j),Od,
+                              VFNMA(VMUL(VMUL(y,si),cO),id,VFMA(VMUL(yd,ci),cO,VMUL(xd,sO)))));
+        VST(soa->rs[5]+j,VFMA(VMUL(y,ci),id,VMUL(yd,si)));
+
+        /* clock with relativity correction */
+        rel=VDIV(VMUL(VSET(2.0),VMUL(VSQRT(VMUL(mu,A)),e)),VSET(CLIGHT*CLIGHT));
+        VST(soa->dts[0]+j,VFNMA(rel,sE,VFMA(VFMA(VLD(soa->f2+j),tc,VLD(soa->f1+j)),tc,VLD(soa->f0+j))));
+        VST(soa->dts[1]+j,VFNMA(VMUL(rel,cE),Ed,VFMA(VMUL(VSET(2.0),VLD(soa->f2+j)),tc,VLD(soa->f1+j))));
+    }
+}
+/* ranges from a site, full vectors only, return the number of satellites done */
+VTARGET static int VFUNC(range_kernel)(const double* rr, const double* up, double trp, int n,
+                                       const double* x, const double* y, const double* z,
+                                       double* ex, double* ey, double* ez, double* rho)
+{
+    V xs,ys,dx,dy,dz,r,ir,u;
+    int j;
+
+    for (j=0;j+VN<=n;j+=VN) {
+        xs=VLD(x+j); ys=VLD(y+j);
+        dx=VSUB(xs,VSET(rr[0]));
+        dy=VSUB(ys,VSET(rr[1]));
+        dz=VSUB(VLD(z+j),VSET(rr[2]));
+        r=VSQRT(VFMA(dx,dx,VFMA(dy,dy,VMUL(dz,dz))));
+        ir=VDIV(VSET(1.0),r);
+        dx=VMUL(dx,ir); dy=VMUL(dy,ir); dz=VMUL(dz,ir);
+        VST(ex+j,dx); VST(ey+j,dy); VST(ez+j,dz);
+
+        /* sagnac correction and troposphere delay trp/sin(el), 0 below the horizon */
+        r=VFMA(VSET(OMGE/CLIGHT),VFNMA(ys,VSET(rr[0]),VMUL(xs,VSET(rr[1]))),r);
+        u=VFMA(dx,VSET(up[0]),VFMA(dy,VSET(up[1]),VMUL(dz,VSET(up[2]))));
+        u=VBLEND(VLT(VSET(0.0),u),VSET(0.0),VDIV(VSET(trp),u));
+        VST(rho+j,VADD(r,u));
+    }
+    return j;
+}
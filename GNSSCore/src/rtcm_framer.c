@@ -0,0 +1,198 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ block-level rtcm3 frame scanner
+ the preamble is searched with memchr, the 10-bit length is read once per frame
+ and the crc is checked once when the frame is complete, frames completely inside
+ the input block are returned as spans into the caller buffer, only the head of a
+ frame split across two blocks is kept in the carry buffer
+*/
+#include <string.h>
+
+#include "rtcm_framer.h"
+#include "gnss.h"
+#include "crc24q.h"
+
+/* total frame length from header (header + payload + crc) */
+static int frame_length(const uint8_t* buff)
+{
+	return ((((int)buff[1] & 0x03) << 8) | buff[2]) + 6;
+}
+/* check crc-24q of a complete frame */
+static int frame_crc_ok(const uint8_t* buff, int len)
+{
+	uint32_t crc = ((uint32_t)buff[len - 3] << 16) | ((uint32_t)buff[len - 2] << 8) | buff[len - 1];
+	return crc24q_fast(buff, len - 3) == crc;
+}
+/* message type, 0 if the payload is too short to hold it */
+static int frame_type(const uint8_t* buff, int len)
+{
+	return len >= 8 ? (int)getbitu(buff, 24, 12) : 0;
+}
+/* drop n bytes from the carry buffer and resync it to the next preamble */
+static void drop_carry(rtcm_framer_t* framer, int n)
+{
+	uint8_t* p = NULL;
+	if (n > framer->ncarry) n = framer->ncarry;
+	if (n > 0)
+	{
+		framer->ncarry -= n;
+		if (framer->ncarry > 0) memmove(framer->carry, framer->carry + n, framer->ncarry);
+	}
+	if (framer->ncarry > 0 && framer->carry[0] != RTCM3PREAMB)
+	{
+		p = (uint8_t*)memchr(framer->carry, RTCM3PREAMB, framer->ncarry);
+		n = p ? (int)(p - framer->carry) : framer->ncarry;
+		framer->nskip += n;
+		framer->ncarry -= n;
+		if (framer->ncarry > 0) memmove(framer->carry, p, framer->ncarry);
+	}
+}
+extern void rtcm_framer_init(rtcm_framer_t* framer)
+{
+	memset(framer, 0, sizeof(rtcm_framer_t));
+}
+extern void rtcm_framer_input(rtcm_framer_t* framer, uint8_t* buff, int nbyte)
+{
+	framer->src = buff;
+	framer->nsrc = nbyte > 0 ? nbyte : 0;
+	framer->pos = 0;
+	framer->nblk = 0; /* carry bytes now belong to previous blocks */
+}
+/* complete the frame held in the carry buffer, return 1: frame, 0: need more data */
+static int next_carry_frame(rtcm_framer_t* framer, rtcm_frame_t* frame)
+{
+	int need = 0, take = 0;
+	while (framer->ncarry > 0)
+	{
+		need = framer->ncarry < 3 ? 3 : frame_length(framer->carry);
+		if (framer->ncarry < need)
+		{
+			take = need - framer->ncarry;
+			if (take > framer->nsrc - framer->pos) take = framer->nsrc - framer->pos;
+			memcpy(framer->carry + framer->ncarry, framer->src + framer->pos, take);
+			framer->ncarry += take;
+			framer->nblk += take;
+			framer->pos += take;
+			if (framer->ncarry < need) return 0; /* block exhausted */
+			if (need == 3) continue; /* header completed, get the frame length */
+		}
+		frame->buff = framer->carry;
+		frame->len = need;
+		if (frame_crc_ok(framer->carry, need))
+		{
+			frame->type = frame_type(framer->carry, need);
+			frame->crc = 0;
+			++framer->nframe;
+			framer->ndrop = need;
+			framer->nblk = 0;
+		}
+		else
+		{
+			/* false preamble or corrupted frame, give the bytes of the current block
+			   back to the scanner and resync inside the older carried bytes */
+			frame->type = 0;
+			frame->crc = 1;
+			++framer->ncrcerr;
+			framer->pos -= framer->nblk;
+			framer->ncarry -= framer->nblk;
+			framer->nblk = 0;
+			framer->ndrop = 1;
+		}
+		return 1;
+	}
+	return 0;
+}
+extern int rtcm_framer_next(rtcm_framer_t* framer, rtcm_frame_t* frame)
+{
+	uint8_t* p = NULL;
+	int rem = 0, len = 0;
+	if (framer->ndrop > 0)
+	{
+		drop_carry(framer, framer->ndrop);
+		framer->ndrop = 0;
+	}
+	if (framer->ncarry > 0)
+	{
+		if (next_carry_frame(framer, frame)) return 1;
+		if (framer->ncarry > 0) return 0;
+	}
+	while (framer->pos < framer->nsrc)
+	{
+		rem = framer->nsrc - framer->pos;
+		p = framer->src + framer->pos;
+		if (*p != RTCM3PREAMB)
+		{
+			p = (uint8_t*)memchr(p, RTCM3PREAMB, rem);
+			if (!p)
+			{
+				framer->nskip += rem;
+				framer->pos = framer->nsrc;
+				break;
+			}
+			framer->nskip += (uint64_t)(p - (framer->src + framer->pos));
+			framer->pos = (int)(p - framer->src);
+			rem = framer->nsrc - framer->pos;
+		}
+		if (rem < 3 || rem < (len = frame_length(p)))
+		{
+			/* frame split across blocks, keep the head only */
+			memcpy(framer->carry, p, rem);
+			framer->ncarry = rem;
+			framer->nblk = 0;
+			framer->pos = framer->nsrc;
+			break;
+		}
+		frame->buff = p;
+		frame->len = len;
+		if (frame_crc_ok(p, len))
+		{
+			frame->type = frame_type(p, len);
+			frame->crc = 0;
+			++framer->nframe;
+			framer->pos += len;
+		}
+		else
+		{
+			frame->type = 0;
+			frame->crc = 1;
+			++framer->ncrcerr;
+			++framer->pos;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+/* message with the reference station ID after the message type */
+static int has_staid(int type)
+{
+	return (type >= 1001 && type <= 1012) || type == 1033 || (type >= 1071 && type <= 1137) || type == 1230;
+}
+
+extern int rtcm_set_staid(uint8_t* buff, int nbyte, int staid)
+{
+	uint32_t crc = 0;
+	int pos = 0, len = 0, n = 0;
+	for (pos = 0; pos + 6 <= nbyte && buff[pos] == RTCM3PREAMB; pos += len)
+	{
+		len = frame_length(buff + pos);
+		if (pos + len > nbyte) break;
+		if (len < 9 || !has_staid(frame_type(buff + pos, len))) continue;
+		setbitu(buff + pos, 36, 12, (uint32_t)staid);
+		crc = crc24q_fast(buff + pos, len - 3);
+		setbitu(buff + pos, (len - 3) * 8, 24, crc);
+		++n;
+	}
+	return n;
+}
+
+extern int rtcm_frame_at(const uint8_t* buff, int nbyte, int* type)
+{
+	int len = 0;
+	if (nbyte < 6 || buff[0] != RTCM3PREAMB) return 0;
+	if ((len = frame_length(buff)) > nbyte) return 0;
+	if (type) *type = frame_type(buff, len);
+	return len;
+}
@@ -0,0 +1,69 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ block-level rtcm3 frame scanner, split the raw stream into complete frames
+ without per-byte processing
+*/
+#ifndef _RTCM_FRAMER_H_
+#define _RTCM_FRAMER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+
+#include <stdint.h>
+
+#ifndef RTCM3_MAX_FRAME
+#define RTCM3_MAX_FRAME (3+1023+3) /* header + max payload + crc */
+#endif
+
+/* one complete rtcm3 frame, the span points to the caller buffer when the frame
+*  is fully inside the current block, otherwise to the framer carry buffer, it is
+*  valid until the next call of rtcm_framer_next/rtcm_framer_input */
+typedef struct
+{
+	uint8_t* buff; /* frame start (preamble) */
+	int len;       /* total frame length (header + payload + crc) */
+	int type;      /* message type */
+	int crc;       /* 1: crc failed, the scanner resyncs from the byte after the preamble */
+}rtcm_frame_t;
+
+typedef struct
+{
+	uint8_t carry[RTCM3_MAX_FRAME]; /* head of a frame split across calls */
+	int ncarry;
+	uint8_t* src;  /* current input block */
+	int nsrc;
+	int pos;       /* scan position in current block */
+	int nblk;      /* bytes in carry taken from current block (rewind on crc failure) */
+	int ndrop;     /* bytes to drop from carry on the next call */
+	uint64_t nframe;   /* number of frames with crc passed */
+	uint64_t ncrcerr;  /* number of frames with crc failed */
+	uint64_t nskip;    /* number of bytes skipped for synchronization */
+}rtcm_framer_t;
+
+GNSSCORE_API void rtcm_framer_init(rtcm_framer_t* framer);
+
+/* set the next input block, the remaining partial frame of the previous block is kept in the carry buffer */
+GNSSCORE_API void rtcm_framer_input(rtcm_framer_t* framer, uint8_t* buff, int nbyte);
+
+/* get the next frame from the input block, return 1: frame found, 0: need more data */
+GNSSCORE_API int  rtcm_framer_next(rtcm_framer_t* framer, rtcm_frame_t* frame);
+
+/* set the reference station ID of the observation and station messages (1001-1012, 1005-1008,
+*  1033, msm, 1230) of a buffer of complete frames and update their crc, return the number of
+*  frames changed */
+GNSSCORE_API int  rtcm_set_staid(uint8_t* buff, int nbyte, int staid);
+
+/* length and message type of the frame at the start of a buffer of complete frames (encoder
+*  output, the crc is not checked), return 0: no complete frame */
+GNSSCORE_API int  rtcm_frame_at(const uint8_t* buff, int nbyte, int* type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ memory mapped rtcm3 replay
+*/
+#include <string.h>
+
+#include "rtcm_replay.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef REPLAY_PAGE
+#define REPLAY_PAGE 4096 /* release granularity */
+#endif
+
+extern int rtcm_replay_open(rtcm_replay_t* rp, const char* fname, int opt)
+{
+#ifdef _WIN32
+	LARGE_INTEGER size = { 0 };
+#else
+	struct stat st = { 0 };
+#endif
+	memset(rp, 0, sizeof(rtcm_replay_t));
+	rtcm_framer_init(&rp->framer);
+#ifdef _WIN32
+	(void)opt;
+	rp->hfile = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (rp->hfile == INVALID_HANDLE_VALUE)
+	{
+		rp->hfile = NULL;
+		return 0;
+	}
+	if (!GetFileSizeEx((HANDLE)rp->hfile, &size))
+	{
+		rtcm_replay_close(rp);
+		return 0;
+	}
+	rp->size = (uint64_t)size.QuadPart;
+	if (rp->size == 0) return 1; /* nothing to map */
+	/* large pages need a pagefile section, the option is not used for a file */
+	rp->hmap = CreateFileMappingA((HANDLE)rp->hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (rp->hmap) rp->data = (uint8_t*)MapViewOfFile((HANDLE)rp->hmap, FILE_MAP_READ, 0, 0, 0);
+	if (!rp->data)
+	{
+		rtcm_replay_close(rp);
+		return 0;
+	}
+#else
+	rp->fd = open(fname, O_RDONLY);
+	if (rp->fd < 0) return 0;
+	if (fstat(rp->fd, &st) != 0)
+	{
+		rtcm_replay_close(rp);
+		return 0;
+	}
+	rp->size = (uint64_t)st.st_size;
+	if (rp->size == 0) return 1; /* nothing to map */
+	rp->data = (uint8_t*)mmap(NULL, (size_t)rp->size, PROT_READ, MAP_PRIVATE, rp->fd, 0);
+	if (rp->data == (uint8_t*)MAP_FAILED)
+	{
+		rp->data = NULL;
+		rtcm_replay_close(rp);
+		return 0;
+	}
+	madvise(rp->data, (size_t)rp->size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	if (opt & REPLAY_HUGEPAGE) madvise(rp->data, (size_t)rp->size, MADV_HUGEPAGE); /* best effort */
+#endif
+#endif
+	return 1;
+}
+
+/* release the pages of the frames already returned, the data are read again from the file
+   if a span is used later */
+static void release_pages(rtcm_replay_t* rp)
+{
+	uint64_t end = rp->pos & ~(uint64_t)(REPLAY_PAGE - 1);
+	if (end <= rp->done) return;
+#ifndef _WIN32
+	madvise(rp->data + rp->done, (size_t)(end - rp->done), MADV_DONTNEED);
+#endif
+	rp->done = end;
+}
+
+extern int rtcm_replay_next(rtcm_replay_t* rp, rtcm_frame_t* frame)
+{
+	uint64_t n = 0;
+	while (!rtcm_framer_next(&rp->framer, frame))
+	{
+		if (rp->pos >= rp->size) return 0;
+		release_pages(rp);
+		n = rp->size - rp->pos;
+		if (n > REPLAY_WINDOW) n = REPLAY_WINDOW;
+		rtcm_framer_input(&rp->framer, rp->data + rp->pos, (int)n);
+		rp->pos += n;
+	}
+	return 1;
+}
+
+extern int64_t rtcm_replay_offset(const rtcm_replay_t* rp, const rtcm_frame_t* frame)
+{
+	if (!rp->data || frame->buff < rp->data || frame->buff >= rp->data + rp->size) return -1;
+	return (int64_t)(frame->buff - rp->data);
+}
+
+extern int rtcm_replay_seek(rtcm_replay_t* rp, uint64_t offset)
+{
+	if (offset > rp->size) return 0;
+	rtcm_framer_init(&rp->framer);
+	rp->pos = offset;
+	rp->done = offset & ~(uint64_t)(REPLAY_PAGE - 1); /* the pages before are not released */
+	return 1;
+}
+
+extern void rtcm_replay_close(rtcm_replay_t* rp)
+{
+#ifdef _WIN32
+	if (rp->data) UnmapViewOfFile(rp->data);
+	if (rp->hmap) CloseHandle((HANDLE)rp->hmap);
+	if (rp->hfile) CloseHandle((HANDLE)rp->hfile);
+	rp->hmap = NULL;
+	rp->hfile = NULL;
+#else
+	if (rp->data) munmap(rp->data, (size_t)rp->size);
+	if (rp->fd >= 0) close(rp->fd);
+	rp->fd = -1;
+#endif
+	rp->data = NULL;
+	rp->size = rp->pos = rp->done = 0;
+}
@@ -0,0 +1,58 @@
+/*
+ GNSS Process Engine
+ Copyright(R) 2021, Easy Navigation Technology Inc.
+ Date: 10/17/2026
+ replay of a recorded rtcm3 file, the file is mapped into memory and framed once,
+ each frame is returned as a span into the mapping (no copy, valid until the file is
+ closed) except a frame across two framer windows (framer carry buffer, valid until the
+ next call), the mapping is read sequentially and the pages behind the scan are released
+*/
+#ifndef _RTCM_REPLAY_H_
+#define _RTCM_REPLAY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "GNSSCore_Api.h"
+#include "rtcm_framer.h"
+
+#include <stdint.h>
+
+#ifndef REPLAY_WINDOW
+#define REPLAY_WINDOW (1 << 26) /* bytes given to the framer at once (pages released behind it) */
+#endif
+
+#define REPLAY_HUGEPAGE 1 /* option, ask for huge pages of the mapping (ignored where not supported) */
+
+typedef struct
+{
+	uint8_t* data; /* mapping of the file */
+	uint64_t size; /* file bytes */
+	uint64_t pos; /* bytes given to the framer */
+	uint64_t done; /* bytes released behind the scan */
+	rtcm_framer_t framer;
+#ifdef _WIN32
+	void* hfile;
+	void* hmap;
+#else
+	int fd;
+#endif
+}rtcm_replay_t;
+
+/* map the file, opt: REPLAY_HUGEPAGE, return 1: ok, 0: error */
+GNSSCORE_API int  rtcm_replay_open(rtcm_replay_t* rp, const char* fname, int opt);
+/* next frame (crc failed frames included with frame->crc=1), return 1: frame, 0: end of file */
+GNSSCORE_API int  rtcm_replay_next(rtcm_replay_t* rp, rtcm_frame_t* frame);
+/* byte offset of the frame in the file, -1: frame across two windows (framer carry buffer) */
+GNSSCORE_API int64_t rtcm_replay_offset(const rtcm_replay_t* rp, const rtcm_frame_t* frame);
+/* restart the framing at the offset (start of a frame, e.g. from rtcm_replay_offset), return 1: ok, 0: out of file */
+GNSSCORE_API int  rtcm_replay_seek(rtcm_replay_t* rp, uint64_t offset);
+/* unmap and close */
+GNSSCORE_API void rtcm_replay_close(rtcm_replay_t* rp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,9 +13,17 @@
 
 #include "gnss.h"
 
-#ifndef MAX_BASE
-#define MAX_BASE 20
-#endif
+#include "rtcm_framer.h"
+
+#include "gnss_thread.h"
+
+#include "gnss_queue.h"
+
+#include "gnss_pool.h"
+
+#include "gnss_archive.h"
+
+#include "ephemeris.h"
 
 #ifndef MAX_ROVE
 #define MAX_ROVE 200
@@ -47,20 +55,25 @@ typedef struct
 	int ntype;
 	uint64_t numofepoch; /* number of epoch marked sync flag */
 	uint64_t numofepoch_wo_sync; /* number of epoch without sync flag */
-	uint8_t data[MAX_BUF_LEN];
-	int nbyte;
+	rtcm_framer_t framer; /* frame scanner, keeps the frame split across calls */
+	rtcm_ctx_t ctx; /* decode context (time, lock and phase state) of this station */
+	spsc_queue_t queue; /* bytes waiting for the ingestion thread (threaded ingestion) */
+	double xyz_set[3]; /* coordinate given with the data (threaded ingestion) */
+	int nxyz_set; /* 1: xyz_set is valid */
+	gnss_atomic_t xyz_lock; /* xyz_set, caller thread of the station => worker */
 	unsigned long packet_received;
 	unsigned long packet_crc_failed;
 }connect_t;
 
 typedef struct
 {
-	connect_t base[MAX_BASE];
+	gnss_pool_t bases; /* connections of the base stations by slot, a deleted station keeps its slot for the next station */
+	id_map_t base_ids; /* station ID => slot */
 	connect_t rove[MAX_ROVE];
 	rtcm_t rtcm;
 	nav_t nav;
 	epoch_t epoch;
-	int nb;
+	int nb; /* number of base stations */
 	int nr;
 	uint64_t byte_received;
 	uint64_t byte_crc_failed;
@@ -68,51 +81,119 @@ typedef struct
 	uint64_t packet_received_current;
 }decoder_t;
 
-static decoder_t gDecoder = { 0 };
-decoder_t* pDecoder = &gDecoder;
+#ifndef VRS_BUF_LEN
+#define VRS_BUF_LEN ((MAX_SAT+1)*RTCM3_MAX_FRAME) /* at most one msm frame for each satellite and 1005 */
+#endif
+
+
+/*-----------------------------------------------------*/
+/* threaded ingestion, the base stations are shared by the workers (station slot
+   modulo number of workers), each station has one byte queue from the caller to its
+   worker and the completed epochs of all workers go to the network engine through
+   one epoch queue, the network engine is the thread calling get_vrs_rove_buff */
+#ifndef MAX_WORKER
+#define MAX_WORKER 32
+#endif
+
+#ifndef INGEST_QUEUE_SIZE
+#define INGEST_QUEUE_SIZE (MAX_BUF_LEN*64) /* byte queue of each base station */
+#endif
+
+#ifndef ARCHIVE_RAW_SIZE
+#define ARCHIVE_RAW_SIZE (MAX_BUF_LEN*64) /* raw data ring of each producer */
+#endif
+
+#ifndef ARCHIVE_LOG_SIZE
+#define ARCHIVE_LOG_SIZE (MAX_BUF_LEN*16) /* log data ring of each producer */
+#endif
+
+#ifndef ARCHIVE_FLUSH_MS
+#define ARCHIVE_FLUSH_MS 1000 /* default flush interval of the raw and log files (ms) */
+#endif
+
+#ifndef ARCHIVE_FLUSH_BYTES
+#define ARCHIVE_FLUSH_BYTES 0 /* default flush size of the raw and log files (bytes), 0: not used */
+#endif
+
+#ifndef INGEST_EPOCH_PER_BASE
+#define INGEST_EPOCH_PER_BASE 4 /* epochs waiting for the network engine, for each base station */
+#endif
+
+typedef struct
+{
+	int id;
+	engine_t* engine; /* engine of the worker */
+	gnss_thread_t thread;
+	rtcm_t rtcm; /* decode work area of this worker */
+	uint8_t buff[MAX_BUF_LEN]; /* bytes taken from the station queue */
+	gnss_atomic_t busy; /* 1: processing the station queues */
+	gnss_atomic_t sleeping; /* 1: waiting for data */
+	gnss_lock_t lock;
+	gnss_cond_t cond;
+}worker_t;
 
-/* main process engine */
-static network_t gNetwork;
-network_t* pNetwork = &gNetwork;
+typedef struct
+{
+	worker_t* workers;
+	int nworker;
+	gnss_atomic_t stop;
+	epoch_queue_t epochs; /* completed epochs, workers => network engine */
+	gnss_rwlock_t nav_lock; /* shared nav, write: decode, read: satellite position */
+	gnss_rwlock_t sta_lock; /* station table, write: add/delete station, read: queue access, epoch queue */
+	gnss_lock_t out_lock; /* raw and log data output */
+}ingest_t;
 
 /*-----------------------------------------------------*/
-/* data log */
-static uint8_t g_log_opt = 1;
-static uint8_t g_raw_opt = 1;
-FILE* fRAW = NULL; /* raw data log for post-processing */
-FILE* fLOG = NULL; /* process status */
+/* engine instance, the whole state of the api, each thread calls the api on the engine
+   it selected (engine_select, the default engine without selection), so independent
+   engines run in parallel in one process, the shared tables of the library (crc24q,
+   orbit kernel) are built once for all engines (gnss_once) */
+struct engine_s
+{
+	/* data log */
+	uint8_t log_opt;
+	uint8_t raw_opt; /* 1: one raw file, 2: segment files by station with index */
+	uint8_t chk_opt; /* debug, decode the vrs rtcm output again */
+	uint8_t replay_opt; /* 1: replay on the virtual clock */
+	int flush_ms;
+	int flush_bytes;
+	gtime_t replay_time; /* virtual clock (gpst), newest decoded time of the stations */
+	archive_t raw; /* raw data log for post-processing */
+	archive_t log; /* process status */
+	decoder_t decoder; /* main decode engine */
+	network_t network; /* main process engine */
+	ingest_t* ingest; /* threaded ingestion, NULL: direct decode */
+	rtcm_t check; /* decoder of the output check */
+	uint8_t vrs_buff[VRS_BUF_LEN]; /* encoder output of the vrs epoch */
+};
 
-/* open files to write */
-static void set_output_file(struct tm* ltm)
+static engine_t gEngine = { .log_opt = 1, .raw_opt = 1, .flush_ms = ARCHIVE_FLUSH_MS, .flush_bytes = ARCHIVE_FLUSH_BYTES };
+static GNSS_THREAD_LOCAL engine_t* pEngine = &gEngine; /* engine of the calling thread */
+
+/* archive ring of the caller, 0: caller of set_rtcm_data_buff (no worker), 1..MAX_WORKER: worker,
+   MAX_WORKER+1: network engine (vrs output) */
+#define RING_OF_CALLER 0
+#define RING_OF_WORKER(worker) ((worker) ? (worker)->id + 1 : RING_OF_CALLER)
+#define RING_OF_ENGINE (MAX_WORKER + 1)
+#define NUM_OF_RING (MAX_WORKER + 2)
+
+/* start the archive on first data, the file is opened by the archive thread */
+static int start_output_file(archive_t* ar, const char* ext, const char* mode, int segment, uint32_t size)
 {
-	/* log data */
-	if (!fRAW && g_raw_opt)
-	{
-		char strTime[128] = { 0 };
-		sprintf(strTime, "%04d-%0d-%0d-%02d-%02d-%02d.rtcm3", (int)(1900 + ltm->tm_year), (int)(1 + ltm->tm_mon), (int)(ltm->tm_mday), (int)(ltm->tm_hour), (int)(ltm->tm_min), (int)(ltm->tm_sec));
-		fRAW = fopen(strTime, "wb");
-	}
-	if (!fLOG&& g_log_opt)
-	{
-		char strTime[128] = { 0 };
-		sprintf(strTime, "%04d-%0d-%0d-%02d-%02d-%02d.log", (int)(1900 + ltm->tm_year), (int)(1 + ltm->tm_mon), (int)(ltm->tm_mday), (int)(ltm->tm_hour), (int)(ltm->tm_min), (int)(ltm->tm_sec));
-		fLOG = fopen(strTime, "w");
-	}
+	int ret = 0;
+	if (gnss_atomic_get(&ar->running)) return 1;
+	if (pEngine->ingest) gnss_lock(&pEngine->ingest->out_lock);
+	ret = archive_start(ar, ext, mode, segment, NUM_OF_RING, size, pEngine->flush_ms, pEngine->flush_bytes);
+	if (pEngine->ingest) gnss_unlock(&pEngine->ingest->out_lock);
+	return ret;
 }
 
 /* write the log data */
-static void output_log_data(char* buffer, int opt)
+static void output_log_data(int ring, char* buffer, int opt)
 {
-	if (!fLOG&& g_log_opt)
-	{
-		time_t now = time(0);
-		struct tm* ltm = localtime(&now);
-		set_output_file(ltm);
-	}
-	if (fLOG)
+	if (pEngine->log_opt && start_output_file(&pEngine->log, "log", "w", 0, ARCHIVE_LOG_SIZE))
 	{
-		fprintf(fLOG, "%s", buffer);
-		fflush(fLOG);
+		archive_push(&pEngine->log, ring, (uint8_t*)buffer, (int)strlen(buffer));
 	}
 	if (opt)
 	{
@@ -120,19 +201,22 @@ static void output_log_data(char* buffer, int opt)
 	}
 }
 
-/* write the raw data */
-static void output_raw_data(uint8_t* dat_buff, int len_buff)
+/* write the raw data, time (gps time of the frame) for the index of the segment files */
+static void output_raw_data(int ring, int staid, int type, gtime_t time, uint8_t* dat_buff, int len_buff)
 {
-	if (!fRAW && g_raw_opt)
-	{
-		time_t now = time(0);
-		struct tm* ltm = localtime(&now);
-		set_output_file(ltm);
-	}
-	if (fRAW)
+	int week = 0;
+	double tow = 0.0;
+	if (pEngine->raw_opt && start_output_file(&pEngine->raw, "rtcm3", "wb", pEngine->raw_opt == 2, ARCHIVE_RAW_SIZE))
 	{
-		fwrite((void*)dat_buff, len_buff, sizeof(char), fRAW);
-		fflush(fRAW);
+		if (pEngine->raw.segment)
+		{
+			tow = time2gpst(time, &week);
+			archive_push_frame(&pEngine->raw, ring, staid, type, week * 604800.0 + tow, dat_buff, len_buff);
+		}
+		else
+		{
+			archive_push(&pEngine->raw, ring, dat_buff, len_buff);
+		}
 	}
 }
 
@@ -142,95 +226,125 @@ static void output_raw_data(uint8_t* dat_buff, int len_buff)
 #define MAX_BUF_LEN 4096
 #endif
 
+/* connection of the slot, NULL: free slot */
+static connect_t* get_station(decoder_t* decoder, int index)
+{
+	return (connect_t*)pool_get(&decoder->bases, index);
+}
+
+static int find_station_info(decoder_t* decoder, int staid)
+{
+	/* check the index of the station, -1: not found */
+	return idmap_get(&decoder->base_ids, staid);
+}
+
 static int update_station_info(decoder_t* decoder, int staid)
 {
-	/* manage stations (check the index and try to add it if not found), return the index */
-	int index =-1;
-	int i = 0;
-	connect_t* connect = decoder->base + i;
-	if (staid == 0) return index;
-	for (; i < decoder->nb; ++i, ++connect)
+	/* manage stations (check the index and try to add it if not found), return the index, -1: no memory */
+	int index = find_station_info(decoder, staid);
+	connect_t* connect = NULL;
+	char msg[128] = { 0 };
+	if (staid == 0 || index >= 0) return index;
+	/* new station, in the slot of a deleted station or a new slot */
+	if (decoder->bases.size == 0) pool_init(&decoder->bases, sizeof(connect_t));
+	for (index = 0; decoder->bases.n > decoder->nb && index < decoder->bases.nslot; ++index)
 	{
-		if (connect->staid == staid)
-		{
-			index = i;
-			break;
-		}
+		if ((connect = get_station(decoder, index)) != NULL && connect->staid == 0) break;
 	}
-	if (i == decoder->nb)
+	if (!connect || connect->staid != 0) index = pool_alloc(&decoder->bases);
+	if (index < 0 || !idmap_set(&decoder->base_ids, staid, index))
 	{
-		/* new station */
-		if (decoder->nb < MAX_BASE)
-		{
-			/* add new */
-			memset(connect, 0, sizeof(connect_t));
-			connect->staid = staid;
-			index = decoder->nb;
-			++decoder->nb;
-		}
-		else
-		{
-			/* find the best location to add new */
-			i = 0;
-			connect = decoder->base + i;
-			for (; i < decoder->nb; ++i, ++connect)
-			{
-				if (connect->staid == 0)
-				{
-					memset(connect, 0, sizeof(connect_t));
-					connect->staid = staid;
-					index = i;
-					break;
-				}
-			}
-			if (i == decoder->nb)
-			{
-				/* failed */
-			}
-		}
+		/* an allocated slot stays free for the next station */
+		sprintf(msg, "%4i,station not added (no memory)\n", staid);
+		output_log_data(RING_OF_CALLER, msg, 1);
+		return -1;
 	}
+	connect = get_station(decoder, index);
+	memset(connect, 0, sizeof(connect_t));
+	connect->staid = staid;
+	++decoder->nb;
 	return index;
 }
 
-static int update_station_coordinate(decoder_t* decoder, int staid, double* pos)
+/* delete the station, the slot is kept for the next station (a worker waiting for an epoch
+   slot still has the connection) */
+static void del_station_info(decoder_t* decoder, int staid)
 {
-	/* get coordinate */
-	connect_t* connect = 0;
-	int index = update_station_info(decoder, staid);
-	if (index < 0) return -1;
-	connect = decoder->base + index;
+	int index = find_station_info(decoder, staid);
+	connect_t* connect = get_station(decoder, index);
+	if (!connect) return;
+	spsc_free(&connect->queue);
+	memset(connect, 0, sizeof(connect_t));
+	idmap_del(&decoder->base_ids, staid);
+	--decoder->nb;
+}
+
+/* free the station table */
+static void free_station_info(decoder_t* decoder)
+{
+	pool_free(&decoder->bases);
+	idmap_free(&decoder->base_ids);
+	decoder->nb = 0;
+}
+
+static void update_station_coordinate(connect_t* connect, double* pos)
+{
+	/* set coordinate */
 	connect->xyz[0] = pos[0];
 	connect->xyz[1] = pos[1];
 	connect->xyz[2] = pos[2];
-	return index;
 }
 
-static void process_station_observation(network_t *network, int staid, double* xyz, obs_t *obs, nav_t* nav, epoch_t *epoch)
+/* compute the epoch (satellite positions) of the station and add it to the network, the worker
+   threads build the epoch in a slot of the epoch queue instead, return 0: the station was deleted
+   while the worker waited for a slot (the epoch is dropped) */
+static int process_station_observation(network_t *network, worker_t *worker, connect_t* connect, nav_t* nav, epoch_t *epoch)
 {
+	epoch_slot_t* slot = NULL;
+	obs_t* obs = &connect->obs;
+	double* xyz = connect->xyz;
+	int n = 0, staid = connect->staid;
+	if (worker)
+	{
+		while (!(slot = epoch_queue_reserve(&pEngine->ingest->epochs)))
+		{
+			/* network engine is behind, the station table is released while waiting, the network
+			   engine thread may add or delete a station before it takes the epochs */
+			gnss_rdunlock(&pEngine->ingest->sta_lock);
+			gnss_thread_sleep(1);
+			gnss_rdlock(&pEngine->ingest->sta_lock);
+			if (connect->staid != staid) return 0;
+		}
+		epoch = &slot->epoch;
+		gnss_rdlock(&pEngine->ingest->nav_lock);
+	}
 	memset(epoch, 0, sizeof(epoch_t));
-	if (obsnav2epoch(obs, nav, epoch) > 0)
+	n = obsnav2epoch(obs, nav, epoch);
+	if (worker) gnss_rdunlock(&pEngine->ingest->nav_lock);
+	if (n > 0)
 	{
 		/* assign coordinate */
 		epoch->pos[0] = xyz[0];
 		epoch->pos[1] = xyz[1];
 		epoch->pos[2] = xyz[2];
-		add_obs_to_network(network, staid, epoch);
+		if (!worker) add_obs_to_network(network, staid, epoch);
+	}
+	if (slot)
+	{
+		slot->staid = n > 0 ? staid : 0;
+		epoch_queue_commit(&pEngine->ingest->epochs, slot);
 	}
 	/* clean the data */
 	memset(obs, 0, sizeof(obs_t));
-	
+	return 1;
 }
 
-static int update_station_observation(decoder_t* decoder, network_t *network, int staid, obs_t* obs, int completed)
+static int update_station_observation(decoder_t* decoder, network_t *network, worker_t *worker, connect_t* connect, obs_t* obs, int completed)
 {
-	connect_t* connect = 0;
 	obsd_t* obsd = 0;
 	int i = 0;
 	double dt = 0;
-	int index = update_station_info(decoder, staid);
-	if (index < 0) return -1;
 	if (obs->n == 0) return 0;
-	connect = decoder->base + index;
 	for (i = 0, obsd = obs->data + i; i < obs->n; ++i, ++obsd)
 	{
 		if (connect->obs.n > 0)
@@ -241,7 +355,7 @@ static int update_station_observation(decoder_t* decoder, network_t *network, in
 			{
 				/* epoch is completed by missed data wiithout sync flag */
 				++connect->numofepoch_wo_sync;
-				process_station_observation(network, staid, connect->xyz, &connect->obs, &decoder->nav, &decoder->epoch);
+				if (!process_station_observation(network, worker, connect, &decoder->nav, &decoder->epoch)) return i;
 			}
 		}
 		addobs(&connect->obs, obsd);
@@ -249,7 +363,7 @@ static int update_station_observation(decoder_t* decoder, network_t *network, in
 	if (completed) /* data is completed based on sync flag */
 	{
 		++connect->numofepoch;
-		process_station_observation(network, staid, connect->xyz, &connect->obs, &decoder->nav, &decoder->epoch);
+		process_station_observation(network, worker, connect, &decoder->nav, &decoder->epoch);
 	}
 	return i;
 }
@@ -283,40 +397,44 @@ static void update_type_stat(connect_t* connect, int type, gtime_t t)
 		}
 	}
 }
-/* decode the rtcm data */
-static int process_rtcm_buff(decoder_t *decoder, network_t *network, int type, uint8_t* buffer, int len)
+/* messages which change the shared nav in the decoder (ephemerides, glonass fcn of the legacy
+   glonass observations and of the msm with extended satellite info, ssr), the others only read it */
+static int is_nav_update(int type)
 {
-	int staid = 0;
-	int ret = 0, i = 0, j = 0;
-	int index = 0;
-	rtcm_t* rtcm = &decoder->rtcm;
+	if (type == 1005 || type == 1006 || type == 1007 || type == 1008 || type == 1033 || type == 1230) return 0;
+	if (type >= 1001 && type <= 1004) return 0;
+	if (type >= 1071 && type <= 1137 && type != 1085 && type != 1087 && (type % 10) >= 1 && (type % 10) <= 7) return 0;
+	return 1;
+}
+
+/* decode the rtcm data of one station, decoder->rtcm (worker->rtcm for the ingestion
+   threads) is the work area and the station state is kept in the context of the station
+   connection, nav is shared */
+static int process_rtcm_buff(decoder_t *decoder, network_t *network, worker_t *worker, connect_t *station, int type, uint8_t* buffer, int len)
+{
+	int ret = 0;
+	rtcm_t* rtcm = worker ? &worker->rtcm : &decoder->rtcm;
 	nav_t* nav = &decoder->nav;
-	connect_t* connect = 0;
-	rtcm->staid = 0;
 	memset(&rtcm->sta, 0, sizeof(sta_t));
-	ret = input_rtcm3_buff(rtcm, buffer, len, nav);
-	/* update stats */
-	if (type > 0)
+	rtcm->vtime = pEngine->replay_time; /* time=0 without replay: cpu time */
+	if (worker && is_nav_update(type))
 	{
-		if (rtcm->staid > 0)
-		{
-			index = update_station_info(decoder, rtcm->staid);
-			if (index >= 0)
-			{
-				connect = decoder->base + index;
-				update_type_stat(connect, type, rtcm->time);
-			}
-			else
-			{
-#ifdef _WIN32
-				printf("cannot add stations\n");
-#endif
-			}
-		}
-		else
-		{
-
-		}
+		gnss_wrlock(&pEngine->ingest->nav_lock);
+		ret = input_rtcm3_ctx(rtcm, &station->ctx, buffer, len, nav);
+		gnss_wrunlock(&pEngine->ingest->nav_lock);
+	}
+	else
+	{
+		if (worker) gnss_rdlock(&pEngine->ingest->nav_lock);
+		ret = input_rtcm3_ctx(rtcm, &station->ctx, buffer, len, nav);
+		if (worker) gnss_rdunlock(&pEngine->ingest->nav_lock);
+	}
+	/* the virtual clock follows the data */
+	if (pEngine->replay_opt && station->ctx.time.time != 0 && timediff(station->ctx.time, pEngine->replay_time) > 0.0) pEngine->replay_time = station->ctx.time;
+	/* update stats, the station id of the message is the id of the station */
+	if (type > 0 && rtcm->staid > 0)
+	{
+		update_type_stat(station, type, rtcm->time);
 	}
 	/* decode rtcm data */
 	/* sta coordinate */
@@ -328,7 +446,7 @@ static int process_rtcm_buff(decoder_t *decoder, network_t *network, int type, u
 		}
 		else
 		{
-			update_station_coordinate(decoder, rtcm->staid, rtcm->sta.pos);
+			update_station_coordinate(station, rtcm->sta.pos);
 		}
 	}
 	/* sta info */
@@ -344,7 +462,8 @@ static int process_rtcm_buff(decoder_t *decoder, network_t *network, int type, u
 	/* obs */
 	else if ((type >= 1074&&type<=1077) || (type >= 1084 && type <= 1087) || (type >= 1094 && type <= 1097) || (type >= 1104 && type <= 1107) || (type >= 1114 && type <= 1117) || (type >= 1124 && type <= 1127))
 	{
-		update_station_observation(decoder, network, rtcm->staid, &rtcm->obs, ret==1);
+		if (rtcm->staid > 0)
+			update_station_observation(decoder, network, worker, station, &rtcm->obs, ret==1);
 	}
 	/* ssr */
 	else 
@@ -353,230 +472,678 @@ static int process_rtcm_buff(decoder_t *decoder, network_t *network, int type, u
 	return ret;
 }
 
-static int add_buff_to_connect(connect_t* connect, uint8_t data, int *plen, int *crc, int *staid, double *xyz_rt)
+/* local time of the data for the console output, reentrant for the ingestion threads */
+static void local_time(struct tm* ltm)
 {
-	int type = 0;
-	if (connect->nbyte >= MAX_BUF_LEN)
+	time_t now = time(0);
+	double ep[6] = { 0 };
+	if (pEngine->replay_opt)
 	{
-		connect->nbyte = 0;
+		/* utc of the virtual clock */
+		time2epoch(gpst2utc(pEngine->replay_time), ep);
+		ltm->tm_year = (int)ep[0] - 1900;
+		ltm->tm_mon = (int)ep[1] - 1;
+		ltm->tm_mday = (int)ep[2];
+		ltm->tm_hour = (int)ep[3];
+		ltm->tm_min = (int)ep[4];
+		ltm->tm_sec = (int)ep[5];
+		return;
 	}
-	if (connect->nbyte == 0)
+#ifdef _WIN32
+	localtime_s(ltm, &now);
+#else
+	localtime_r(&now, ltm);
+#endif
+}
+
+/* process one complete frame (crc passed) of a station, data is not changed (a copy is
+   rewritten for the station ID or coordinate), nbyte is the input block for the console
+   output, return the message type */
+static int process_station_frame(decoder_t* decoder, network_t* network, worker_t* worker, connect_t* connect, uint8_t* data, int plen, int nbyte, double* xyz, const struct tm* ltm)
+{
+	int type = 0, staid = 0, sync = 0, crc = 0;
+	int rcvid = connect->staid;
+	double xyz_rt[3] = { 0 };
+	char log_buff[255] = { 0 };
+	uint8_t frame_buff[RTCM3_MAX_FRAME];
+	uint8_t* frame = data;
+	type = check_rtcm3_head(data, &staid, xyz_rt);
+	if ((type == 1005 || type == 1006) && xyz != NULL && !(fabs(xyz[0]) < 0.01 || fabs(xyz[1]) < 0.01 || fabs(xyz[0]) < 0.01))
 	{
-		if (data != 0xD3) return type;
+		/* rewrite a copy, the frame may point into the caller buffer */
+		if (data != frame_buff) data = (uint8_t*)memcpy(frame_buff, frame, plen);
+		update_rtcm3_pos(data, plen, rcvid, xyz);
+		xyz_rt[0] -= xyz[0];
+		xyz_rt[1] -= xyz[1];
+		xyz_rt[2] -= xyz[2];
+		if (fabs(xyz_rt[0] * xyz_rt[0] + xyz_rt[1] * xyz_rt[1] + xyz_rt[2] * xyz_rt[2]) > 0.001)
+		{
+			sprintf(log_buff, "coordinate difference %4i,%4i,%10.4f,%10.4f,%10.4f\n", staid, rcvid, xyz_rt[0], xyz_rt[1], xyz_rt[2]);
+			output_log_data(RING_OF_WORKER(worker), log_buff, 1);
+		}
 	}
-	connect->data[connect->nbyte++] = data;
-	if ((type = check_rtcm3_type(connect->data, connect->nbyte, plen, crc, staid, xyz_rt)) > 0)
+	if (rcvid > 0 && staid != rcvid) /* replace station ID */
 	{
-		connect->nbyte = 0;
+		if (data != frame_buff) data = (uint8_t*)memcpy(frame_buff, frame, plen);
+		change_rtcm3_id(data, plen, rcvid);
 	}
+	/* only output data if CRC passed */
+	if (pEngine->log_opt)
+		printf("%04d-%0d-%0d-%02d-%02d-%02d,%04i,%04i,%04i,%i,%i,%04i,%04i\n", 1900 + ltm->tm_year, 1 + ltm->tm_mon, ltm->tm_mday, ltm->tm_hour, ltm->tm_min, ltm->tm_sec, rcvid, staid, type, sync, crc, plen, nbyte);
+	/* process the rtcm data with the decode context of the station */
+	process_rtcm_buff(decoder, network, worker, connect, type, data, plen);
+	if (connect->staid != rcvid) return type; /* deleted while the worker waited for an epoch slot */
+	/* archive with the time of the station after the frame (approximate time before the first epoch,
+	   the virtual clock or the cpu time without it, the opening frames need a time for the index) */
+	output_raw_data(RING_OF_WORKER(worker), rcvid > 0 ? rcvid : staid, type, connect->ctx.time.time != 0 ? connect->ctx.time : (decoder->rtcm.time.time != 0 ? decoder->rtcm.time : (pEngine->replay_time.time != 0 ? pEngine->replay_time : utc2gpst(timeget()))), data, plen);
+	++connect->packet_received;
 	return type;
 }
 
-/* set the rtcm data buffer to the engine */
-extern int set_rtcm_data_buff(int rcvid, uint8_t* buffer, int nbyte, double *xyz)
+/* split the data of one station into frames and process them, return the number of frames */
+static int process_station_buff(decoder_t* decoder, network_t* network, worker_t* worker, connect_t* connect, uint8_t* buffer, int nbyte, double* xyz, int* byte_crc_failed)
 {
-	int type = 0, crc = 0, staid = 0, sync = 0, prn = 0, frq = 0, week = 0, plen = 0;
-	double tow = 0.0, xyz_rt[3] = { 0 };
-	int ret = 0;
-	time_t now = time(0);
-	struct tm* ltm = localtime(&now);
-	int loc = 0;
+	struct tm ltm = { 0 };
 	int idxofpacket = 0;
-	int byte_crc_failed = 0;
-	char log_buff[255] = { 0 };
-	connect_t* connect = 0;
-	int index = update_station_info(pDecoder, rcvid); if (index < 0) return 0;
-	connect = pDecoder->base + index;
+	rtcm_frame_t frame = { 0 };
+	if (pEngine->log_opt) local_time(&ltm);
 	/* seperate the buffer into various message type */
-	for (loc=0;loc<nbyte;++loc)
+	rtcm_framer_input(&connect->framer, buffer, nbyte);
+	while (rtcm_framer_next(&connect->framer, &frame))
 	{
-		/* check rtcm */
-		type = add_buff_to_connect(connect, buffer[loc], &plen, &crc, &staid, xyz_rt);
-		if (type > 0 && !crc)
+		if (!frame.crc && frame.type > 0)
 		{
-			if ((type == 1005 || type == 1006) && xyz != NULL && !(fabs(xyz[0]) < 0.01 || fabs(xyz[1]) < 0.01 || fabs(xyz[0]) < 0.01))
-			{
-				update_rtcm3_pos(connect->data, plen, rcvid, xyz);
-				xyz_rt[0] -= xyz[0];
-				xyz_rt[1] -= xyz[1];
-				xyz_rt[2] -= xyz[2];
-				if (fabs(xyz_rt[0] * xyz_rt[0] + xyz_rt[1] * xyz_rt[1] + xyz_rt[2] * xyz_rt[2]) > 0.001)
-				{
-					sprintf(log_buff, "coordinate difference %4i,%4i,%10.4f,%10.4f,%10.4f\n", staid, rcvid, xyz_rt[0], xyz_rt[1], xyz_rt[2]);
-					output_log_data(log_buff, 1);
-				}
-			}
-			if (rcvid > 0 && staid != rcvid && change_rtcm3_id(connect->data, plen, rcvid)) /* replace station ID */
-			{
-				//printf("rtcm ID %4i in the data was replaced with %4i\n", staid, rcvid);
-			}
-			/* only output data if CRC passed */
-			if (g_log_opt)
-				printf("%04d-%0d-%0d-%02d-%02d-%02d,%04i,%04i,%04i,%i,%i,%04i,%04i\n", 1900 + ltm->tm_year, 1 + ltm->tm_mon, ltm->tm_mday, ltm->tm_hour, ltm->tm_min, ltm->tm_sec, rcvid, staid, type, sync, crc, plen, nbyte);
-			output_raw_data(connect->data, plen);
-			/* process the rtcm data */
-			process_rtcm_buff(pDecoder, pNetwork, type, connect->data, plen);
+			process_station_frame(decoder, network, worker, connect, frame.buff, frame.len, nbyte, xyz, &ltm);
 			/* skip the processed buffer */
 			++idxofpacket;
-			++connect->packet_received;
 		}
-		else if (type>0 && crc)
+		else if (frame.crc)
 		{
 			/* crc failed */
-			++byte_crc_failed;
+			++(*byte_crc_failed);
 			++connect->packet_crc_failed;
 		}
 	}
+	return idxofpacket;
+}
+
+/* wake up the worker if it is waiting for data */
+static void wake_ingest_worker(worker_t* worker)
+{
+	if (gnss_atomic_get(&worker->sleeping))
+	{
+		gnss_lock(&worker->lock);
+		gnss_cond_signal(&worker->cond);
+		gnss_unlock(&worker->lock);
+	}
+}
+
+/* check the queues of the stations of the worker */
+static int has_ingest_data(worker_t* worker)
+{
+	connect_t* connect = 0;
+	int i = 0, ret = 0;
+	gnss_rdlock(&pEngine->ingest->sta_lock);
+	for (i = worker->id; i < pEngine->decoder.bases.nslot && !ret; i += pEngine->ingest->nworker)
+	{
+		if ((connect = get_station(&pEngine->decoder, i)) != NULL && connect->queue.buff && spsc_count(&connect->queue) > 0) ret = 1;
+	}
+	gnss_rdunlock(&pEngine->ingest->sta_lock);
+	return ret;
+}
+
+/* coordinate given with the data of the station, set by the caller thread of the station and
+   taken by the worker (spin lock, the copy is short) */
+static void set_station_xyz(connect_t* connect, const double* xyz)
+{
+	while (!gnss_atomic_cas(&connect->xyz_lock, 0, 1));
+	connect->xyz_set[0] = xyz[0];
+	connect->xyz_set[1] = xyz[1];
+	connect->xyz_set[2] = xyz[2];
+	connect->nxyz_set = 1;
+	gnss_atomic_set(&connect->xyz_lock, 0);
+}
+
+static int get_station_xyz(connect_t* connect, double* xyz)
+{
+	int ret = 0;
+	while (!gnss_atomic_cas(&connect->xyz_lock, 0, 1));
+	if ((ret = connect->nxyz_set) != 0)
+	{
+		xyz[0] = connect->xyz_set[0];
+		xyz[1] = connect->xyz_set[1];
+		xyz[2] = connect->xyz_set[2];
+	}
+	gnss_atomic_set(&connect->xyz_lock, 0);
+	return ret;
+}
+
+/* ingestion thread, decode the data of the stations of the worker */
+static void ingest_thread(void* arg)
+{
+	worker_t* worker = (worker_t*)arg;
+	connect_t* connect = 0;
+	double xyz[3] = { 0 };
+	int i = 0, n = 0, nproc = 0, npacket = 0, ncrc = 0;
+	pEngine = worker->engine; /* engine of the worker */
+	while (!gnss_atomic_get(&pEngine->ingest->stop))
+	{
+		gnss_atomic_set(&worker->busy, 1);
+		nproc = 0;
+		for (i = worker->id; ; i += pEngine->ingest->nworker)
+		{
+			gnss_rdlock(&pEngine->ingest->sta_lock);
+			if (i >= pEngine->decoder.bases.nslot)
+			{
+				gnss_rdunlock(&pEngine->ingest->sta_lock);
+				break;
+			}
+			connect = get_station(&pEngine->decoder, i);
+			if (connect && connect->staid != 0 && (n = spsc_pop(&connect->queue, worker->buff, MAX_BUF_LEN)) > 0)
+			{
+				ncrc = 0;
+				npacket = process_station_buff(&pEngine->decoder, &pEngine->network, worker, connect, worker->buff, n, get_station_xyz(connect, xyz) ? xyz : NULL, &ncrc);
+				gnss_atomic_add64(&pEngine->decoder.packet_received, npacket);
+				gnss_atomic_add64(&pEngine->decoder.byte_crc_failed, ncrc);
+				++nproc;
+			}
+			gnss_rdunlock(&pEngine->ingest->sta_lock);
+		}
+		gnss_atomic_set(&worker->busy, 0);
+		if (nproc > 0) continue;
+		/* wait for data, the producer checks sleeping after the data is queued */
+		gnss_lock(&worker->lock);
+		gnss_atomic_set(&worker->sleeping, 1);
+		if (!has_ingest_data(worker) && !gnss_atomic_get(&pEngine->ingest->stop))
+			gnss_cond_wait(&worker->cond, &worker->lock, 100);
+		gnss_atomic_set(&worker->sleeping, 0);
+		gnss_unlock(&worker->lock);
+	}
+}
+
+/* epoch queue of INGEST_EPOCH_PER_BASE epochs for each base station, called with the station table
+   locked (write), the workers reserve and commit a slot with the table locked (read) */
+static void resize_ingest_epochs()
+{
+	char msg[128] = { 0 };
+	uint32_t size = (uint32_t)pEngine->decoder.nb * INGEST_EPOCH_PER_BASE;
+	if (pEngine->ingest->epochs.size >= size) return;
+	if (!epoch_queue_resize(&pEngine->ingest->epochs, size))
+	{
+		sprintf(msg, "%4i,epoch queue not resized (no memory)\n", pEngine->ingest->epochs.size);
+		output_log_data(RING_OF_CALLER, msg, 1);
+	}
+}
+
+/* queue the data for the ingestion thread of the station, return the bytes queued */
+static int push_rtcm_data_buff(int rcvid, uint8_t* buffer, int nbyte, double* xyz)
+{
+	connect_t* connect = 0;
+	char msg[128] = { 0 };
+	int index = -1, ret = 0;
+	if (rcvid == 0 || nbyte <= 0) return 0;
+	gnss_rdlock(&pEngine->ingest->sta_lock);
+	index = find_station_info(&pEngine->decoder, rcvid);
+	if (index < 0)
+	{
+		/* new station */
+		gnss_rdunlock(&pEngine->ingest->sta_lock);
+		gnss_wrlock(&pEngine->ingest->sta_lock);
+		index = update_station_info(&pEngine->decoder, rcvid);
+		if (index >= 0 && !(connect = get_station(&pEngine->decoder, index))->queue.buff && !spsc_init(&connect->queue, INGEST_QUEUE_SIZE))
+		{
+			sprintf(msg, "%4i,station not added (no memory for the queue)\n", rcvid);
+			output_log_data(RING_OF_CALLER, msg, 1);
+			del_station_info(&pEngine->decoder, rcvid);
+			index = -1;
+		}
+		if (index >= 0) resize_ingest_epochs();
+		gnss_wrunlock(&pEngine->ingest->sta_lock);
+		if (index < 0) return 0;
+		gnss_rdlock(&pEngine->ingest->sta_lock);
+		index = find_station_info(&pEngine->decoder, rcvid);
+		if (index < 0)
+		{
+			gnss_rdunlock(&pEngine->ingest->sta_lock);
+			return 0;
+		}
+	}
+	connect = get_station(&pEngine->decoder, index);
+	if (xyz != NULL) set_station_xyz(connect, xyz);
+	ret = spsc_push(&connect->queue, buffer, nbyte);
+	gnss_rdunlock(&pEngine->ingest->sta_lock);
+	gnss_atomic_add64(&pEngine->decoder.byte_received, nbyte);
+	if (ret > 0) wake_ingest_worker(pEngine->ingest->workers + index % pEngine->ingest->nworker);
+	return ret;
+}
+
+/* move the epochs completed by the ingestion threads to the network, return the number of epochs */
+static int add_ingest_epochs(network_t* network)
+{
+	epoch_slot_t* slot = NULL;
+	int n = 0;
+	if (!pEngine->ingest) return 0;
+	gnss_rdlock(&pEngine->ingest->sta_lock); /* the epoch queue is resized with a new station */
+	while ((slot = epoch_queue_front(&pEngine->ingest->epochs)) != NULL)
+	{
+		if (slot->staid > 0)
+		{
+			add_obs_to_network(network, slot->staid, &slot->epoch);
+			++n;
+		}
+		epoch_queue_pop(&pEngine->ingest->epochs);
+	}
+	gnss_rdunlock(&pEngine->ingest->sta_lock);
+	return n;
+}
+
+/* stop the ingestion threads after the queued data are processed */
+static void stop_ingest_threads()
+{
+	int i = 0;
+	worker_t* worker = 0;
+	connect_t* connect = 0;
+	if (!pEngine->ingest) return;
+	flush_rtcm_data_buff();
+	gnss_atomic_set(&pEngine->ingest->stop, 1);
+	for (i = 0, worker = pEngine->ingest->workers; i < pEngine->ingest->nworker; ++i, ++worker)
+	{
+		gnss_lock(&worker->lock);
+		gnss_cond_signal(&worker->cond);
+		gnss_unlock(&worker->lock);
+		gnss_thread_join(&worker->thread);
+		gnss_cond_free(&worker->cond);
+		gnss_lock_free(&worker->lock);
+	}
+	for (i = 0; i < pEngine->decoder.bases.nslot; ++i)
+	{
+		if (!(connect = get_station(&pEngine->decoder, i))) continue;
+		spsc_free(&connect->queue);
+		connect->nxyz_set = 0;
+	}
+	epoch_queue_free(&pEngine->ingest->epochs);
+	gnss_rwlock_free(&pEngine->ingest->nav_lock);
+	gnss_rwlock_free(&pEngine->ingest->sta_lock);
+	gnss_lock_free(&pEngine->ingest->out_lock);
+	free(pEngine->ingest->workers);
+	free(pEngine->ingest);
+	pEngine->ingest = NULL;
+}
+
+/* set the rtcm data buffer to the engine */
+extern int set_rtcm_data_buff(int rcvid, uint8_t* buffer, int nbyte, double *xyz)
+{
+	int idxofpacket = 0;
+	int byte_crc_failed = 0;
+	connect_t* connect = 0;
+	int index = 0;
+	if (pEngine->ingest) return push_rtcm_data_buff(rcvid, buffer, nbyte, xyz);
+	/* satellite orbits of the epoch are shared by all stations, glonass orbits are fitted once per ephemeris */
+	if (!pEngine->decoder.nav.orbc) pEngine->decoder.nav.orbc = orbit_cache_new();
+	pEngine->decoder.nav.glofit = 1;
+	index = update_station_info(&pEngine->decoder, rcvid); if (index < 0) return 0;
+	connect = get_station(&pEngine->decoder, index);
+	idxofpacket = process_station_buff(&pEngine->decoder, &pEngine->network, NULL, connect, buffer, nbyte, xyz, &byte_crc_failed);
 	/* keep stats */
-	pDecoder->byte_received += nbyte;
-	pDecoder->byte_crc_failed += byte_crc_failed;
-	pDecoder->packet_received_current = idxofpacket;
-	pDecoder->packet_received += idxofpacket;
+	pEngine->decoder.byte_received += nbyte;
+	pEngine->decoder.byte_crc_failed += byte_crc_failed;
+	pEngine->decoder.packet_received_current = idxofpacket;
+	pEngine->decoder.packet_received += idxofpacket;
 	return idxofpacket;
 }
 
+/* complete frame (crc checked by the caller, e.g. replay), no framing of the station stream */
+extern int set_rtcm_data_frame(int rcvid, uint8_t* frame, int len, double* xyz)
+{
+	struct tm ltm = { 0 };
+	connect_t* connect = 0;
+	int index = 0;
+	if (pEngine->ingest) return push_rtcm_data_buff(rcvid, frame, len, xyz) > 0;
+	if (len < 6) return 0;
+	if (!pEngine->decoder.nav.orbc) pEngine->decoder.nav.orbc = orbit_cache_new();
+	pEngine->decoder.nav.glofit = 1;
+	index = update_station_info(&pEngine->decoder, rcvid); if (index < 0) return 0;
+	connect = get_station(&pEngine->decoder, index);
+	if (pEngine->log_opt) local_time(&ltm);
+	process_station_frame(&pEngine->decoder, &pEngine->network, NULL, connect, frame, len, len, xyz, &ltm);
+	pEngine->decoder.byte_received += len;
+	pEngine->decoder.packet_received_current = 1;
+	++pEngine->decoder.packet_received;
+	return 1;
+}
+
+/* start or stop the threaded ingestion */
+extern int set_ingest_thread_option(int nthread)
+{
+	int i = 0;
+	worker_t* worker = 0;
+	connect_t* connect = 0;
+	stop_ingest_threads();
+	if (pEngine->replay_opt) return 0; /* the replay decodes in the order of the data */
+	if (nthread < 0) nthread = gnss_cpu_count();
+	if (nthread > MAX_WORKER) nthread = MAX_WORKER;
+	if (nthread == 0) return 0;
+	pEngine->ingest = (ingest_t*)calloc(1, sizeof(ingest_t));
+	if (!pEngine->ingest) return 0;
+	pEngine->ingest->workers = (worker_t*)calloc(nthread, sizeof(worker_t));
+	if (!pEngine->ingest->workers || !epoch_queue_init(&pEngine->ingest->epochs, (pEngine->decoder.nb > 0 ? pEngine->decoder.nb : 1) * INGEST_EPOCH_PER_BASE))
+	{
+		if (pEngine->ingest->workers) free(pEngine->ingest->workers);
+		free(pEngine->ingest);
+		pEngine->ingest = NULL;
+		return 0;
+	}
+	pEngine->ingest->nworker = nthread;
+	if (!pEngine->decoder.nav.orbc) pEngine->decoder.nav.orbc = orbit_cache_new();
+	pEngine->decoder.nav.glofit = 1;
+	gnss_rwlock_init(&pEngine->ingest->nav_lock);
+	gnss_rwlock_init(&pEngine->ingest->sta_lock);
+	gnss_lock_init(&pEngine->ingest->out_lock);
+	for (i = 0; i < pEngine->decoder.bases.nslot; ++i)
+	{
+		if ((connect = get_station(&pEngine->decoder, i)) != NULL && connect->staid != 0) spsc_init(&connect->queue, INGEST_QUEUE_SIZE);
+	}
+	for (i = 0, worker = pEngine->ingest->workers; i < nthread; ++i, ++worker)
+	{
+		worker->id = i;
+		worker->engine = pEngine;
+		worker->rtcm.time = pEngine->decoder.rtcm.time; /* approximate time */
+		gnss_lock_init(&worker->lock);
+		gnss_cond_init(&worker->cond);
+	}
+	for (i = 0, worker = pEngine->ingest->workers; i < nthread; ++i, ++worker)
+	{
+		if (!gnss_thread_create(&worker->thread, ingest_thread, worker))
+		{
+			stop_ingest_threads();
+			return 0;
+		}
+	}
+	return nthread;
+}
+
+/* wait until the queued data are decoded and add the epochs to the network */
+extern void flush_rtcm_data_buff()
+{
+	connect_t* connect = 0;
+	int i = 0, pending = 0;
+	if (!pEngine->ingest) return;
+	do
+	{
+		/* check the queues before the busy flags, a worker sets busy before taking data */
+		pending = 0;
+		gnss_rdlock(&pEngine->ingest->sta_lock);
+		for (i = 0; i < pEngine->decoder.bases.nslot && !pending; ++i)
+		{
+			if ((connect = get_station(&pEngine->decoder, i)) != NULL && connect->queue.buff && spsc_count(&connect->queue) > 0) pending = 1;
+		}
+		gnss_rdunlock(&pEngine->ingest->sta_lock);
+		for (i = 0; i < pEngine->ingest->nworker && !pending; ++i)
+		{
+			if (gnss_atomic_get(&pEngine->ingest->workers[i].busy)) pending = 1;
+		}
+		add_ingest_epochs(&pEngine->network);
+		if (pending)
+		{
+			for (i = 0; i < pEngine->ingest->nworker; ++i) wake_ingest_worker(pEngine->ingest->workers + i);
+			gnss_thread_sleep(1);
+		}
+	} while (pending);
+	add_ingest_epochs(&pEngine->network);
+}
+
+/* number of epochs kept for each station */
+extern int set_epoch_depth_option(int depth)
+{
+	return network_set_depth(&pEngine->network, depth);
+}
+
 /* add rover coordinate and information */
 extern int add_vrs_rover_data(int vrsid, double* xyz)
 {
 	char log_buffer[255] = { 0 };
 	printf("rove: %04i,%14.4f,%14.4f,%14.4f\n", vrsid, xyz[0], xyz[1], xyz[2]);
-	return add_vrs_to_network(pNetwork, vrsid, xyz);
+	return add_vrs_to_network(&pEngine->network, vrsid, xyz);
 }
 
-/* get the rtcm buffer for the rover */
-extern int get_vrs_rove_buff(int vrsid, uint8_t* buffer)
+/* encode the vrs epoch to buffer (station ID staid), return the number of bytes */
+static int encode_vrs_epoch(msm_enc_t* enc, const epoch_t* epoch, int staid, uint8_t* buffer, int size)
 {
 	int ngps = 0, nglo = 0, ngal = 0, nbds = 0, nqzs = 0;
-	int i = 0, sys = 0, prn = 0, nbyte = 0, ret = 0;
-	obs_t obs_new = { 0 };
-	obsd_t* obsd = pDecoder->rtcm.obs.data + i;
-	if (get_vrs_from_network(pNetwork, vrsid, &pDecoder->epoch))
+	int i = 0, sys = 0, prn = 0, nbyte = 0, nerr = 0;
+	char msg[128] = { 0 };
+	if (epoch->n <= 0) return 0;
+	for (; i < epoch->n; ++i)
+	{
+		sys = satsys(epoch->obs[i].sat, &prn);
+		if (sys == SYS_GPS) ++ngps;
+		else if (sys == SYS_GLO) ++nglo;
+		else if (sys == SYS_GAL) ++ngal;
+		else if (sys == SYS_CMP) ++nbds;
+		else if (sys == SYS_QZS) ++nqzs;
+	}
+	if (pEngine->ingest) gnss_rdlock(&pEngine->ingest->nav_lock); /* nav is only read */
+	/* encode the msm of each system from the epoch into buffer */
+	if (ngps > 0) nbyte = write_msm_epoch(enc, &pEngine->decoder.nav, epoch, 1074, staid, (nglo + ngal + nbds + nqzs) > 0, buffer, nbyte, size);
+	if (nglo > 0 && nbyte >= 0) nbyte = write_msm_epoch(enc, &pEngine->decoder.nav, epoch, 1084, staid, (ngal + nbds + nqzs) > 0, buffer, nbyte, size);
+	if (ngal > 0 && nbyte >= 0) nbyte = write_msm_epoch(enc, &pEngine->decoder.nav, epoch, 1094, staid, (nbds + nqzs) > 0, buffer, nbyte, size);
+	if (nbds > 0 && nbyte >= 0) nbyte = write_msm_epoch(enc, &pEngine->decoder.nav, epoch, 1124, staid, nqzs > 0, buffer, nbyte, size);
+	if (nqzs > 0 && nbyte >= 0) nbyte = write_msm_epoch(enc, &pEngine->decoder.nav, epoch, 1114, staid, 0, buffer, nbyte, size);
+	if (nbyte < 0)
+	{
+		nbyte = 0;
+	}
+	else if (fabs(epoch->pos[0]) < 0.001 || fabs(epoch->pos[1]) < 0.001 || fabs(epoch->pos[2]) < 0.001)
 	{
-		if (epoch2obs(&pDecoder->epoch, &pDecoder->rtcm.obs))
-		{
-			/* encode the rtcm data into buffer */
-			for (; i < pDecoder->rtcm.obs.n; ++i, ++obsd)
-			{
-				sys = satsys(obsd->sat, &prn);
-				if (sys == SYS_GPS) ++ngps;
-				else if (sys == SYS_GLO) ++nglo;
-				else if (sys == SYS_GAL) ++ngal;
-				else if (sys == SYS_CMP) ++nbds;
-				else if (sys == SYS_QZS) ++nqzs;
-			}
-			pDecoder->rtcm.staid = vrsid;
-			if (ngps > 0) nbyte = write_rtcm3_msm(&pDecoder->rtcm, &pDecoder->nav, 1074, (nglo + ngal + nbds + nqzs) > 0, buffer, nbyte);
-			if (nglo > 0) nbyte = write_rtcm3_msm(&pDecoder->rtcm, &pDecoder->nav, 1084, (ngal + nbds + nqzs) > 0, buffer, nbyte);
-			if (ngal > 0) nbyte = write_rtcm3_msm(&pDecoder->rtcm, &pDecoder->nav, 1094, (nbds + nqzs) > 0, buffer, nbyte);
-			if (nbds > 0) nbyte = write_rtcm3_msm(&pDecoder->rtcm, &pDecoder->nav, 1124, nqzs > 0, buffer, nbyte);
-			if (nqzs > 0) nbyte = write_rtcm3_msm(&pDecoder->rtcm, &pDecoder->nav, 1114, 0, buffer, nbyte);
-			if (fabs(pDecoder->epoch.pos[0]) < 0.001 || fabs(pDecoder->epoch.pos[1]) < 0.001 || fabs(pDecoder->epoch.pos[2]) < 0.001)
-			{
 
-			}
-			else
-			{
-				pDecoder->rtcm.sta.pos[0] = pDecoder->epoch.pos[0];
-				pDecoder->rtcm.sta.pos[1] = pDecoder->epoch.pos[1];
-				pDecoder->rtcm.sta.pos[2] = pDecoder->epoch.pos[2];
-				nbyte = write_rtcm3(&pDecoder->rtcm, &pDecoder->nav, 1005, 0, buffer, nbyte);
-			}
-			memset(&pDecoder->rtcm.obs, 0, sizeof(obs_t));
-			for (i = 0; i < nbyte; ++i)
-			{
-				ret = input_rtcm3(&pDecoder->rtcm, buffer[i], &pDecoder->nav);
-				if (ret == 1)
-				{
-					prn = 0;
-				}
-			}
-			prn = 0;
+	}
+	else if (nbyte + RTCM3_MAX_FRAME <= size)
+	{
+		pEngine->decoder.rtcm.staid = staid;
+		pEngine->decoder.rtcm.sta.pos[0] = epoch->pos[0];
+		pEngine->decoder.rtcm.sta.pos[1] = epoch->pos[1];
+		pEngine->decoder.rtcm.sta.pos[2] = epoch->pos[2];
+		nbyte = write_rtcm3(&pEngine->decoder.rtcm, &pEngine->decoder.nav, 1005, 0, buffer, nbyte);
+	}
+	if (pEngine->chk_opt)
+	{
+		/* debug, decode the output again (own decoder, the station decode state is not changed) */
+		pEngine->check.time = gpst2time(epoch->wk, epoch->ws);
+		for (i = 0; i < nbyte; ++i)
+		{
+			if (input_rtcm3(&pEngine->check, buffer[i], &pEngine->decoder.nav) < 0) ++nerr;
 		}
+		if (nerr > 0)
+		{
+			sprintf(msg, "%4i,%4i,%10.3f,%i,vrs rtcm check failed\n", staid, epoch->wk, epoch->ws, nerr);
+			output_log_data(RING_OF_ENGINE, msg, 0);
+		}
+	}
+	if (pEngine->ingest) gnss_rdunlock(&pEngine->ingest->nav_lock);
+	return nbyte;
+}
+
+/* rtcm data of the rover, encoded once per vrs epoch into the cache of the vrs and shared by
+   its rovers, the station ID of the cache is changed for another rover of the vrs */
+extern const uint8_t* get_vrs_rove_data(int vrsid, int* nbyte)
+{
+	rove_t* rove = NULL;
+	add_ingest_epochs(&pEngine->network);
+	*nbyte = 0;
+	if (!(rove = get_vrs_rove_from_network(&pEngine->network, vrsid))) return NULL;
+	if (rove->rtcm_epoch == 0 || rove->rtcm_epoch != rove->numofepoch)
+	{
+		/* new epoch of the vrs, encode once for all its rovers */
+		if (!rove->enc && !(rove->enc = calloc(1, sizeof(msm_enc_t)))) return NULL;
+		if (!set_vrs_rtcm_of_rove(rove, pEngine->vrs_buff, encode_vrs_epoch((msm_enc_t*)rove->enc, get_vrs_epoch_of_rove(rove), vrsid, pEngine->vrs_buff, VRS_BUF_LEN), vrsid)) return NULL;
+	}
+	/* the other rovers of the vrs get their own copy, the data returned to a rover is not changed
+	   until the next epoch of the vrs */
+	return get_vrs_rtcm_of_rove(rove, vrsid, nbyte);
+}
+
+/* rtcm data of the rover by message */
+extern int get_vrs_rove_iov(int vrsid, vrs_iov_t* iov, int niov, int size)
+{
+	const uint8_t* data = NULL;
+	int nbyte = 0, pos = 0, len = 0, type = 0, n = 0;
+	if (!(data = get_vrs_rove_data(vrsid, &nbyte))) return 0;
+	if (size > 0 && nbyte > size) return -1;
+	for (; pos < nbyte && (len = rtcm_frame_at(data + pos, nbyte - pos, &type)) > 0; pos += len, ++n)
+	{
+		if (n >= niov) return -1;
+		iov[n].buff = data + pos;
+		iov[n].len = len;
+		iov[n].type = type;
 	}
+	return n;
+}
+
+/* get the rtcm buffer for the rover, copy of get_vrs_rove_data */
+extern int get_vrs_rove_buff(int vrsid, uint8_t* buffer)
+{
+	int nbyte = 0;
+	const uint8_t* data = get_vrs_rove_data(vrsid, &nbyte);
+	if (data && nbyte > 0) memcpy(buffer, data, nbyte);
 	return nbyte;
 }
 
 extern void del_vrs_rove_data(int vrsid)
 {
 	int i = 0;
-	for (; i < pDecoder->nr; ++i)
+	for (; i < pEngine->decoder.nr; ++i)
 	{
-		if (pDecoder->rove[i].staid == vrsid)
+		if (pEngine->decoder.rove[i].staid == vrsid)
 		{
-			memset(pDecoder->rove + i, 0, sizeof(connect_t));
+			memset(pEngine->decoder.rove + i, 0, sizeof(connect_t));
 		}
 	}
-	del_vrs_from_network(pNetwork, vrsid);
+	del_vrs_from_network(&pEngine->network, vrsid);
 }
 
 /* delete base station */
 extern void del_vrs_base_data(int staid)
 {
-	int i = 0;
-	for (; i < pDecoder->nb; ++i)
-	{
-		if (pDecoder->base[i].staid == staid)
-		{
-			memset(pDecoder->base + i, 0, sizeof(connect_t));
-		}
-	}
-	del_bas_from_network(pNetwork, staid);
+	if (pEngine->ingest) gnss_wrlock(&pEngine->ingest->sta_lock);
+	del_station_info(&pEngine->decoder, staid);
+	if (pEngine->ingest) gnss_wrunlock(&pEngine->ingest->sta_lock);
+	del_bas_from_network(&pEngine->network, staid);
 }
 
 /* reset the system, clear all variables in memory */
 extern void system_reset()
 {
-	network_init(pNetwork);
+	network_init(&pEngine->network);
 }
 
 /* house keeping when system exist */
 extern void system_exit()
 {
 	/* house keeping */
-	if (fRAW) fclose(fRAW);
-	if (fLOG) fclose(fLOG);
+	stop_ingest_threads();
+	free_station_info(&pEngine->decoder);
+	orbit_cache_free(pEngine->decoder.nav.orbc);
+	pEngine->decoder.nav.orbc = NULL;
+	archive_free(&pEngine->raw);
+	archive_free(&pEngine->log);
+}
+
+/* new engine with the default options */
+extern engine_t* engine_new()
+{
+	engine_t* engine = (engine_t*)calloc(1, sizeof(engine_t));
+	if (!engine) return NULL;
+	engine->log_opt = 1;
+	engine->raw_opt = 1;
+	engine->flush_ms = ARCHIVE_FLUSH_MS;
+	engine->flush_bytes = ARCHIVE_FLUSH_BYTES;
+	return engine;
+}
+
+/* free the engine (house keeping and network), the default engine is not freed */
+extern void engine_free(engine_t* engine)
+{
+	engine_t* prev = NULL;
+	if (!engine || engine == &gEngine) return;
+	prev = engine_select(engine);
+	system_exit();
+	network_init(&engine->network); /* frees the stations */
+	engine_select(prev == engine ? NULL : prev);
+	free(engine);
+}
+
+/* engine of the calling thread, NULL: default engine, return the previous engine */
+extern engine_t* engine_select(engine_t* engine)
+{
+	engine_t* prev = pEngine;
+	pEngine = engine ? engine : &gEngine;
+	return prev;
 }
 
 /* set the approximate time for offline process */
 extern void set_appr_time(int year, int mon, int day, int hour)
 {
 	double ep[6] = { year, mon, day, hour, 0, 0 };
-	pDecoder->rtcm.time = epoch2time(ep);
+	pEngine->decoder.rtcm.time = epoch2time(ep);
+	if (pEngine->replay_opt) pEngine->replay_time = pEngine->decoder.rtcm.time;
 }
 
-/* control raw data output */
-extern void set_raw_data_option(int opt)
+/* replay on the virtual clock */
+extern void set_replay_time_option(int opt)
 {
-	if (opt)
+	pEngine->replay_opt = opt ? 1 : 0;
+	if (pEngine->replay_opt)
 	{
-		if (!g_raw_opt)
-			g_raw_opt = 1;
+		stop_ingest_threads();
+		pEngine->replay_time = pEngine->decoder.rtcm.time;
 	}
 	else
 	{
-		if (g_raw_opt)
-		{
-			if (fRAW) fclose(fRAW);
-			g_raw_opt = 0;
-		}
+		memset(&pEngine->replay_time, 0, sizeof(gtime_t));
 	}
 }
+
+/* control raw data output */
+extern void set_raw_data_option(int opt)
+{
+	opt = opt == 2 ? 2 : (opt ? 1 : 0);
+	if (opt != pEngine->raw_opt)
+	{
+		/* the files of the previous option are closed, the next frame starts the new option */
+		pEngine->raw_opt = 0;
+		archive_stop(&pEngine->raw);
+		pEngine->raw_opt = (uint8_t)opt;
+	}
+}
+/* durability of the raw and log files */
+extern void set_raw_flush_option(int flush_ms, int flush_bytes)
+{
+	pEngine->flush_ms = flush_ms > 0 ? flush_ms : 0;
+	pEngine->flush_bytes = flush_bytes > 0 ? flush_bytes : 0;
+	archive_set_flush(&pEngine->raw, pEngine->flush_ms, pEngine->flush_bytes);
+	archive_set_flush(&pEngine->log, pEngine->flush_ms, pEngine->flush_bytes);
+}
+/* control the check of the vrs rtcm output */
+extern void set_check_data_option(int opt)
+{
+	pEngine->chk_opt = opt ? 1 : 0;
+}
 /* control log data output */
 extern void set_log_data_option(int opt)
 {
 	if (opt)
 	{
-		if (!g_log_opt)
+		if (!pEngine->log_opt)
 		{
-			g_log_opt = 1;
+			pEngine->log_opt = 1;
 		}
 	}
 	else
 	{
-		if (g_log_opt)
+		if (pEngine->log_opt)
 		{
-			if (fLOG) fclose(fLOG);
-			g_log_opt = 0;
+			pEngine->log_opt = 0;
+			archive_stop(&pEngine->log);
 		}
 	}
 }
@@ -585,17 +1152,23 @@ extern void system_status_output(FILE* fout)
 {
 	if (!fout) return;
 	int i = 0, j = 0;
-	fprintf(fout, "%Iu,total received bytes\r\n", pDecoder->byte_received);
-	fprintf(fout, "%Iu,total received bytes with crc failed\r\n", pDecoder->byte_crc_failed);
-	fprintf(fout, "%Iu,total packets for current epoch\r\n", pDecoder->packet_received_current);
-	fprintf(fout, "%Iu,total packets\r\n", pDecoder->packet_received);
+	connect_t* connect = 0;
+	uint64_t nhit = 0, nmiss = 0;
+	fprintf(fout, "%Iu,total received bytes\r\n", pEngine->decoder.byte_received);
+	fprintf(fout, "%Iu,total received bytes with crc failed\r\n", pEngine->decoder.byte_crc_failed);
+	fprintf(fout, "%Iu,total packets for current epoch\r\n", pEngine->decoder.packet_received_current);
+	fprintf(fout, "%Iu,total packets\r\n", pEngine->decoder.packet_received);
+	orbit_cache_stat(pEngine->decoder.nav.orbc, &nhit, &nmiss);
+	fprintf(fout, "%Iu,%Iu,satellite orbits from cache and computed\r\n", nhit, nmiss);
+	fprintf(fout, "%Iu,%Iu,raw data bytes archived and dropped\r\n", pEngine->raw.nbyte, archive_dropped(&pEngine->raw));
 	fprintf(fout, "\r\n");
-	for (i = 0; i < pDecoder->nb; ++i)
+	for (i = 0; i < pEngine->decoder.bases.nslot; ++i)
 	{
-		fprintf(fout, "%4i,%Iu,%Iu,total epochs with and without sync flag\r\n", pDecoder->base[i].staid, pDecoder->base[i].numofepoch, pDecoder->base[i].numofepoch_wo_sync);
-		for (j = 0; j < pDecoder->base[i].ntype; ++j)
+		if (!(connect = get_station(&pEngine->decoder, i)) || connect->staid == 0) continue;
+		fprintf(fout, "%4i,%Iu,%Iu,total epochs with and without sync flag\r\n", connect->staid, connect->numofepoch, connect->numofepoch_wo_sync);
+		for (j = 0; j < connect->ntype; ++j)
 		{
-			fprintf(fout, "%4i,%4i,%Iu,total rtcm type received\r\n", pDecoder->base[i].staid, pDecoder->base[i].types[j].type, pDecoder->base[i].types[j].count);
+			fprintf(fout, "%4i,%4i,%Iu,total rtcm type received\r\n", connect->staid, connect->types[j].type, connect->types[j].count);
 		}
 	}
 	fflush(fout);
@@ -6,6 +6,7 @@
 #include "gnss_proc_pp.h"
 #include "gnss_proc_rt.h"
 #include "gnss_proc_pp_rtcm.h"
+#include "gnss_proc_bench.h"
 
 #define MAXFIELD 100
 
@@ -67,6 +68,10 @@ static int proc_config_file(const char* fname)
 		{
 			strcpy(inifname, val[1]);
 		}
+		else if (type == 5 && num > 2)
+		{
+			engine_bench_main(val[1], val[2]);
+		}
 		++line;
 	}
 	if (fINI) fclose(fINI);
@@ -0,0 +1,797 @@
+//------------------------------------------------------------------------------
+#include "gnss_proc_bench.h"
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+//------------------------------------------------------------------------------
+
+#include "crc24q.h"
+#include "rtcm_framer.h"
+#include "rtcm_replay.h"
+#include "bitstream.h"
+#include "vrs.h"
+#include "orbit_simd.h"
+#include "gnss_core.h"
+#include "gnss.h"
+#include "gnss_grid.h"
+
+#pragma warning (disable:4996)
+
+typedef struct
+{
+	int offset; /* frame offset in the file buffer */
+	int len;    /* frame length without crc */
+}bench_frame_t;
+
+/* read the whole file into memory */
+static int read_bench_file(const char* fname, std::vector<uint8_t>& data)
+{
+	FILE* fRTCM = fopen(fname, "rb");
+	if (!fRTCM)
+	{
+		printf("cannot open %s\n", fname);
+		return 0;
+	}
+	fseek(fRTCM, 0, SEEK_END);
+	long nbyte = ftell(fRTCM);
+	fseek(fRTCM, 0, SEEK_SET);
+	data.resize(nbyte > 0 ? nbyte : 0);
+	if (nbyte > 0 && fread(&data[0], 1, nbyte, fRTCM) != (size_t)nbyte) data.clear();
+	fclose(fRTCM);
+	return (int)data.size();
+}
+
+static int is_msm7(int type)
+{
+	return type >= 1077 && type <= 1137 && (type % 10) == 7;
+}
+
+/* split the file into frames, keep MSM7 frames (all frames if no MSM7 found) */
+static int get_bench_frames(std::vector<uint8_t>& data, std::vector<bench_frame_t>& frames)
+{
+	std::vector<bench_frame_t> all;
+	rtcm_framer_t framer;
+	rtcm_frame_t frame;
+	bench_frame_t f;
+	rtcm_framer_init(&framer);
+	rtcm_framer_input(&framer, &data[0], (int)data.size());
+	while (rtcm_framer_next(&framer, &frame))
+	{
+		if (frame.crc || frame.buff < &data[0] || frame.buff >= &data[0] + data.size()) continue;
+		f.offset = (int)(frame.buff - &data[0]);
+		f.len = frame.len - 3;
+		all.push_back(f);
+		if (is_msm7(frame.type)) frames.push_back(f);
+	}
+	if (frames.empty()) frames = all;
+	return (int)frames.size();
+}
+
+typedef uint32_t(*crc24q_func_t)(const uint8_t* buff, int len);
+
+/* crc-24q throughput on recorded frames, compare the kernels against the byte-wise table loop */
+static void bench_crc24q(const char* fname)
+{
+	std::vector<uint8_t> data;
+	std::vector<bench_frame_t> frames;
+	const char* names[] = { "bytewise", "slice8", "pclmul", "fast" };
+	crc24q_func_t funcs[] = { crc24q_bytewise, crc24q_slice8, crc24q_clmul, crc24q_fast };
+	size_t i = 0, k = 0;
+	int j = 0, loop = 0, nloop = 0, nerr = 0;
+	double nbyte = 0.0, dt = 0.0, base = 0.0;
+	uint32_t crc = 0, sum = 0;
+	if (!read_bench_file(fname, data) || !get_bench_frames(data, frames))
+	{
+		printf("no rtcm frames in %s\n", fname);
+		return;
+	}
+	for (i = 0; i < frames.size(); ++i) nbyte += frames[i].len;
+	/* about 256 MB per kernel */
+	nloop = (int)(256.0 * 1024 * 1024 / nbyte) + 1;
+	printf("crc24q: %i frames, %.0f bytes, %i loops, cpu kernel %s\n", (int)frames.size(), nbyte, nloop, crc24q_kernel());
+	/* all kernels must match the parity in the frame */
+	for (k = 0; k < sizeof(funcs) / sizeof(funcs[0]); ++k)
+	{
+		for (i = 0; i < frames.size(); ++i)
+		{
+			const uint8_t* p = &data[frames[i].offset];
+			j = frames[i].len;
+			crc = ((uint32_t)p[j] << 16) | ((uint32_t)p[j + 1] << 8) | p[j + 2];
+			if (funcs[k](p, j) != crc) ++nerr;
+		}
+	}
+	if (nerr > 0) printf("crc24q: %i parity mismatches\n", nerr);
+	for (k = 0; k < sizeof(funcs) / sizeof(funcs[0]); ++k)
+	{
+		if (k == 2 && !crc24q_has_clmul()) continue;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (loop = 0; loop < nloop; ++loop)
+		{
+			for (i = 0; i < frames.size(); ++i)
+				sum += funcs[k](&data[frames[i].offset], frames[i].len);
+		}
+		dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (k == 0) base = dt;
+		printf("crc24q %-8s %10.1f MB/s %6.2fx\n", names[k], nbyte * nloop / dt / 1.0e6, dt > 0.0 ? base / dt : 0.0);
+	}
+	printf("crc24q checksum %08X\n", sum);
+}
+
+/* bit extraction one bit at a time (reference, the former getbitu) */
+static uint32_t getbitu_bitwise(const uint8_t* buff, int pos, int len)
+{
+	uint32_t bits = 0;
+	int i;
+	for (i = pos; i < pos + len; i++) bits = (bits << 1) + ((buff[i / 8] >> (7 - i % 8)) & 1u);
+	return bits;
+}
+static int32_t getbits_bitwise(const uint8_t* buff, int pos, int len)
+{
+	uint32_t bits = getbitu_bitwise(buff, pos, len);
+	if (len <= 0 || 32 <= len || !(bits & (1u << (len - 1)))) return (int32_t)bits;
+	return (int32_t)(bits | (~0u << len)); /* extend sign */
+}
+
+/* bit reader regression on recorded frames: every field position and length
+*  of every frame must decode bit-exactly as the bitwise reference (bitstream
+*  cursor and the getbitu/getbits of the decoders), then
+*  compare the sequential field throughput */
+static void bench_bitstream(const char* fname)
+{
+	std::vector<uint8_t> data;
+	std::vector<bench_frame_t> frames;
+	bitstream_t bs;
+	size_t i = 0;
+	int pos = 0, len = 0, nbit = 0, loop = 0, nloop = 0;
+	double nfield = 0.0, dt[2] = { 0 };
+	uint64_t nerr = 0, nerr_get = 0, ncheck = 0;
+	uint32_t sum[2] = { 0 };
+	if (!read_bench_file(fname, data) || !get_bench_frames(data, frames))
+	{
+		printf("no rtcm frames in %s\n", fname);
+		return;
+	}
+	for (i = 0; i < frames.size(); ++i)
+	{
+		const uint8_t* p = &data[frames[i].offset];
+		nbit = (frames[i].len + 3) * 8;
+		bs_init(&bs, p, frames[i].len + 3, 0);
+		for (pos = 0; pos < nbit; ++pos)
+		{
+			for (len = 1; len <= 32 && pos + len <= nbit; ++len, ++ncheck)
+			{
+				bs.pos = pos;
+				if (bs_peeku(&bs, pos, len) != getbitu_bitwise(p, pos, len) || bs_gets(&bs, len) != getbits_bitwise(p, pos, len) || bs.pos != pos + len) ++nerr;
+				if (getbitu(p, pos, len) != getbitu_bitwise(p, pos, len) || getbits(p, pos, len) != getbits_bitwise(p, pos, len)) ++nerr_get;
+			}
+		}
+	}
+	printf("bitstream: %i frames, %.0f fields checked, %.0f mismatches, %.0f getbitu/getbits mismatches\n", (int)frames.size(), (double)ncheck, (double)nerr, (double)nerr_get);
+	/* sequential 15 bit fields as in the msm cell loops */
+	for (i = 0; i < frames.size(); ++i) nfield += (frames[i].len * 8 - 24) / 15;
+	nloop = (int)(2.0e8 / (nfield + 1.0)) + 1;
+	for (int k = 0; k < 2; ++k)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (loop = 0; loop < nloop; ++loop)
+		{
+			for (i = 0; i < frames.size(); ++i)
+			{
+				const uint8_t* p = &data[frames[i].offset];
+				nbit = frames[i].len * 8;
+				if (k == 0)
+				{
+					for (pos = 24; pos + 15 <= nbit; pos += 15) sum[k] += (uint32_t)getbits_bitwise(p, pos, 15);
+				}
+				else
+				{
+					bs_init(&bs, p, frames[i].len + 3, 24);
+					while (bs.pos + 15 <= nbit) sum[k] += (uint32_t)bs_gets(&bs, 15);
+				}
+			}
+		}
+		dt[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	}
+	printf("bitstream bitwise %8.1f Mfield/s\n", nfield * nloop / dt[0] / 1.0e6);
+	printf("bitstream cursor  %8.1f Mfield/s %6.2fx%s\n", nfield * nloop / dt[1] / 1.0e6, dt[1] > 0.0 ? dt[0] / dt[1] : 0.0, sum[0] == sum[1] ? "" : " (checksum mismatch)");
+}
+
+/* message types with the station ID after the type (observations and station messages) */
+static int has_station_id(int type)
+{
+	if (type >= 1071 && type <= 1137 && type % 10 >= 1 && type % 10 <= 7) return 1; /* msm */
+	if (type >= 1001 && type <= 1012) return 1; /* legacy observations, 1005..1008 */
+	return type == 1033 || type == 1230;
+}
+
+/* threaded ingestion throughput, the file is split into one stream per station and fed in
+*  blocks (one block per station in turn) as the caster would do, inline decoding first */
+static void bench_ingest(const char* fname)
+{
+	std::vector<uint8_t> data;
+	std::vector<int> staids;
+	std::vector<std::vector<uint8_t> > streams;
+	std::vector<uint8_t> pending; /* frames before the first station ID */
+	std::vector<int> nthreads;
+	rtcm_framer_t framer;
+	rtcm_frame_t frame;
+	bitstream_t bs;
+	const int block = 1024;
+	size_t i = 0, k = 0, pos = 0, nbyte = 0;
+	int staid = 0, n = 0, more = 0, nthread = 0, ncpu = (int)std::thread::hardware_concurrency();
+	double dt = 0.0, base = 0.0;
+	if (!read_bench_file(fname, data))
+	{
+		printf("no rtcm frames in %s\n", fname);
+		return;
+	}
+	rtcm_framer_init(&framer);
+	rtcm_framer_input(&framer, &data[0], (int)data.size());
+	while (rtcm_framer_next(&framer, &frame))
+	{
+		if (frame.crc || frame.type == 0) continue;
+		if (has_station_id(frame.type))
+		{
+			bs_init(&bs, frame.buff, frame.len, 36);
+			staid = (int)bs_getu(&bs, 12); /* station id after the message type */
+			for (k = 0; k < staids.size() && staids[k] != staid; ++k);
+			if (k == staids.size())
+			{
+				staids.push_back(staid);
+				streams.push_back(std::vector<uint8_t>());
+			}
+			streams[k].insert(streams[k].end(), pending.begin(), pending.end());
+			pending.clear();
+		}
+		else if (staids.empty())
+		{
+			pending.insert(pending.end(), frame.buff, frame.buff + frame.len);
+			nbyte += frame.len;
+			continue;
+		}
+		/* ephemerides go with the stream of the previous station (k) as in the archive */
+		streams[k].insert(streams[k].end(), frame.buff, frame.buff + frame.len);
+		nbyte += frame.len;
+	}
+	if (streams.empty())
+	{
+		printf("no rtcm frames in %s\n", fname);
+		return;
+	}
+	printf("ingest: %i stations, %.0f bytes, %i cpus\n", (int)streams.size(), (double)nbyte, ncpu);
+	set_raw_data_option(0);
+	set_log_data_option(0);
+	nthreads.push_back(0);
+	for (nthread = 1; nthread <= ncpu && nthread <= (int)streams.size(); nthread *= 2) nthreads.push_back(nthread);
+	for (i = 0; i < nthreads.size(); ++i)
+	{
+		system_reset();
+		for (k = 0; k < staids.size(); ++k) del_vrs_base_data(staids[k]);
+		nthread = set_ingest_thread_option(nthreads[i]);
+		if (nthreads[i] > 0 && nthread == 0) continue;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (pos = 0, more = 1; more; pos += block)
+		{
+			more = 0;
+			for (k = 0; k < streams.size(); ++k)
+			{
+				if (pos >= streams[k].size()) continue;
+				n = (int)(streams[k].size() - pos < (size_t)block ? streams[k].size() - pos : block);
+				/* queue full, the network engine (this thread) takes the epochs */
+				while (!set_rtcm_data_buff(staids[k], &streams[k][pos], n, NULL) && nthread > 0) flush_rtcm_data_buff();
+				more = 1;
+			}
+		}
+		flush_rtcm_data_buff();
+		dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (i == 0) base = dt;
+		printf("ingest %2i threads %10.1f MB/s %6.2fx\n", nthread, nbyte / dt / 1.0e6, dt > 0.0 ? base / dt : 0.0);
+	}
+	set_ingest_thread_option(0);
+}
+
+static double bench_rand(double a, double b)
+{
+	return a + (b - a) * rand() / (double)RAND_MAX;
+}
+
+/* synthetic broadcast constellation of an epoch: gps, galileo, beidou meo/igso/geo, qzss */
+static void fill_orbit_soa(orbit_soa_t* soa, int n)
+{
+	int j = 0, type = 0;
+	soa->n = n;
+	for (j = 0; j < n; ++j)
+	{
+		type = j % 6;
+		soa->mu[j] = type == 0 || type == 5 ? 3.9860050E14 : 3.986004418E14;
+		soa->omge[j] = type >= 2 && type <= 4 ? 7.292115E-5 : 7.2921151467E-5;
+		soa->geo[j] = type == 4 ? 1.0 : 0.0;
+		soa->A[j] = type == 0 ? 26560.0E3 : (type == 1 ? 29600.0E3 : (type == 2 ? 27906.0E3 : 42164.0E3));
+		soa->e[j] = type == 5 ? bench_rand(0.07, 0.08) : bench_rand(0.0, 0.02);
+		soa->i0[j] = type == 4 ? bench_rand(0.0, 0.05) : bench_rand(0.9, 1.0);
+		soa->OMG0[j] = bench_rand(-3.14, 3.14);
+		soa->omg[j] = bench_rand(-3.14, 3.14);
+		soa->M0[j] = bench_rand(-3.14, 3.14);
+		soa->deln[j] = bench_rand(-5.0E-9, 5.0E-9);
+		soa->OMGd[j] = bench_rand(-8.0E-9, -7.0E-9);
+		soa->idot[j] = bench_rand(-1.0E-10, 1.0E-10);
+		soa->toes[j] = bench_rand(0.0, 604800.0);
+		soa->tk[j] = bench_rand(-7200.0, 7200.0);
+		soa->tc[j] = soa->tk[j] + bench_rand(-16.0, 16.0);
+		soa->crc[j] = bench_rand(-300.0, 300.0);
+		soa->crs[j] = bench_rand(-100.0, 100.0);
+		soa->cuc[j] = bench_rand(-1.0E-5, 1.0E-5);
+		soa->cus[j] = bench_rand(-1.0E-5, 1.0E-5);
+		soa->cic[j] = bench_rand(-1.0E-7, 1.0E-7);
+		soa->cis[j] = bench_rand(-1.0E-7, 1.0E-7);
+		soa->f0[j] = bench_rand(-1.0E-3, 1.0E-3);
+		soa->f1[j] = bench_rand(-1.0E-11, 1.0E-11);
+		soa->f2[j] = 0.0;
+	}
+}
+
+/* batch orbit kernels against the scalar reference (eph2posvel math), the vector
+*  kernels must agree within 1 mm in position and clock */
+static void bench_orbit(const char* fname)
+{
+	static orbit_soa_t in, ref, out;
+	const int nset = 2000, nloop = 20000;
+	int k = 0, j = 0, a = 0, set = 0, loop = 0, nerr = 0;
+	double dr = 0.0, dv = 0.0, dc = 0.0, dt = 0.0, base = 0.0, sum = 0.0;
+	srand(1);
+	printf("orbit: %i random epochs, cpu kernel %s\n", nset, orbit_simd_name(orbit_simd_kernel()));
+	for (k = ORBIT_KERNEL_AVX2; k <= ORBIT_KERNEL_AVX512; ++k)
+	{
+		if (!orbit_simd_supported(k)) continue;
+		srand(1);
+		dr = dv = dc = 0.0;
+		for (set = 0; set < nset; ++set)
+		{
+			fill_orbit_soa(&in, 1 + rand() % ORBIT_SOA_MAX);
+			ref = in;
+			out = in;
+			orbit_soa_compute(&ref, ORBIT_KERNEL_SCALAR);
+			orbit_soa_compute(&out, k);
+			for (j = 0; j < in.n; ++j)
+			{
+				if (ref.ok[j] != out.ok[j]) ++nerr;
+				for (a = 0; a < 3; ++a)
+				{
+					dr = fmax(dr, fabs(out.rs[a][j] - ref.rs[a][j]));
+					dv = fmax(dv, fabs(out.rs[a + 3][j] - ref.rs[a + 3][j]));
+				}
+				dc = fmax(dc, fabs(out.dts[0][j] - ref.dts[0][j]) * 299792458.0);
+			}
+		}
+		if (dr > 1.0E-3 || dc > 1.0E-3) ++nerr;
+		printf("orbit %-7s max diff pos %.3e m, vel %.3e m/s, clock %.3e m\n", orbit_simd_name(k), dr, dv, dc);
+	}
+	if (nerr > 0) printf("orbit: %i mismatches against the scalar kernel\n", nerr);
+	/* one full batch per call, like the broadcast satellites of an epoch */
+	fill_orbit_soa(&in, ORBIT_SOA_MAX);
+	for (k = ORBIT_KERNEL_SCALAR; k <= ORBIT_KERNEL_AVX512; ++k)
+	{
+		if (!orbit_simd_supported(k)) continue;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (loop = 0; loop < nloop; ++loop)
+		{
+			in.tk[loop % ORBIT_SOA_MAX] += 1.0E-3;
+			orbit_soa_compute(&in, k);
+			sum += in.rs[0][loop % ORBIT_SOA_MAX];
+		}
+		dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (k == ORBIT_KERNEL_SCALAR) base = dt;
+		printf("orbit %-7s %8.1f ns/sat %6.2fx\n", orbit_simd_name(k), dt * 1.0E9 / nloop / ORBIT_SOA_MAX, dt > 0.0 ? base / dt : 0.0);
+	}
+	printf("orbit checksum %.3f\n", sum);
+}
+
+/* synthetic base epoch, n satellites above the horizon of the base with three frequencies */
+static void fill_vrs_epoch(epoch_t* epoch, const double* xyz, int n)
+{
+	const double wave[3] = { 0.19029367, 0.24421021, 0.25482804 };
+	double u[3] = { 0 }, v[3] = { 0 }, up[3] = { 0 }, r = 0.0, d = 0.0;
+	int i = 0, j = 0, f = 0;
+	memset(epoch, 0, sizeof(epoch_t));
+	memcpy(epoch->pos, xyz, sizeof(double) * 3);
+	epoch->wk = 2300;
+	epoch->ws = 302400.0;
+	r = sqrt(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+	for (j = 0; j < 3; ++j) up[j] = xyz[j] / r;
+	for (i = 0; i < n && i < MAX_SAT; ++i)
+	{
+		sat_obs_t* obs = epoch->obs + i;
+		sat_vec_t* vec = epoch->vec + i;
+		do
+		{
+			for (j = 0; j < 3; ++j) u[j] = bench_rand(-1.0, 1.0);
+			r = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+		} while (r < 0.1 || r > 1.0 || (u[0] * up[0] + u[1] * up[1] + u[2] * up[2]) / r < 0.4);
+		for (j = 0; j < 3; ++j) vec->rs[j] = u[j] / r * 26560.0E3;
+		/* velocity normal to the position */
+		for (j = 0; j < 3; ++j) v[j] = bench_rand(-1.0, 1.0);
+		d = (v[0] * u[0] + v[1] * u[1] + v[2] * u[2]) / (r * r);
+		for (j = 0; j < 3; ++j) v[j] -= d * u[j];
+		d = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		for (j = 0; j < 3; ++j) vec->rs[j + 3] = v[j] / d * 3874.0;
+		vec->dts[0] = bench_rand(-1.0E-4, 1.0E-4);
+		vec->sat = obs->sat = i + 1;
+		obs->sys = 1;
+		obs->prn = i + 1;
+		for (j = 0, d = 0.0; j < 3; ++j) d += (vec->rs[j] - xyz[j]) * (vec->rs[j] - xyz[j]);
+		d = sqrt(d);
+		for (f = 0; f < 3; ++f)
+		{
+			obs->wave[f] = wave[f];
+			obs->P[f] = d + bench_rand(-3.0, 3.0);
+			obs->L[f] = d / wave[f] + bench_rand(-1.0E6, 1.0E6);
+			obs->D[f] = (float)bench_rand(-3000.0, 3000.0);
+			obs->SNR[f] = 180;
+			obs->code[f] = 1;
+		}
+	}
+	/* satellite without orbit is dropped by the vrs */
+	if (n > 2) memset(epoch->vec[n / 2].rs, 0, sizeof(double) * 6);
+	epoch->n = n < MAX_SAT ? n : MAX_SAT;
+}
+
+/* vrs generation of a base epoch for many rovers, the scalar kernel on epoch_t against the
+*  batched kernel on the structure of arrays store, the soa base epoch is converted once per
+*  epoch as the network does, soa>epoch writes the vrs epoch_t for the rtcm encoders */
+static void bench_vrs(const char* fname)
+{
+	static epoch_t base, out[3];
+	static epoch_soa_t base_soa, out_soa;
+	const double xyz[3] = { -2853445.0, 4667464.0, 3268291.0 };
+	const int nrove = 500, nloop = 40;
+	const char* names[] = { "aos", "soa", "soa>epoch" };
+	std::vector<double> rove(nrove * 3);
+	int i = 0, j = 0, f = 0, k = 0, loop = 0, n = 0, nerr = 0;
+	double dt = 0.0, base_dt = 0.0, diff = 0.0, sum = 0.0;
+	srand(1);
+	fill_vrs_epoch(&base, xyz, 40);
+	for (i = 0; i < nrove; ++i)
+	{
+		for (j = 0; j < 3; ++j) rove[i * 3 + j] = xyz[j] + bench_rand(-50.0E3, 50.0E3);
+	}
+	printf("vrs: %i satellites, %i rovers, epoch_t %i bytes, epoch_soa_t %i bytes\n", base.n, nrove, (int)sizeof(epoch_t), (int)sizeof(epoch_soa_t));
+	/* same vrs from both stores */
+	epoch2soa(&base, &base_soa);
+	for (i = 0; i < nrove; ++i)
+	{
+		out[0].n = make_vrs_measurement(base.obs, base.vec, base.pos, base.n, &rove[i * 3], out[0].obs, out[0].vec);
+		make_vrs_measurement_soa(&base_soa, &rove[i * 3], &out_soa);
+		soa2epoch(&out_soa, &out[1]);
+		make_vrs_measurement_epoch(&base_soa, &base, &rove[i * 3], &out[2]);
+		if (out[0].n != out[1].n || out[0].n != out[2].n) ++nerr;
+		for (k = 0; k < out[0].n && k < out[1].n && k < out[2].n; ++k)
+		{
+			for (f = 0; f < MAX_FRQ; ++f)
+			{
+				diff = fmax(diff, fabs(out[0].obs[k].P[f] - out[1].obs[k].P[f]));
+				diff = fmax(diff, fabs(out[0].obs[k].L[f] - out[1].obs[k].L[f]));
+				if (memcmp(out[1].obs + k, out[2].obs + k, sizeof(sat_obs_t))) ++nerr;
+			}
+			for (j = 0; j < 3; ++j) diff = fmax(diff, fabs(out[0].vec[k].rs[j] - out[1].vec[k].rs[j]));
+		}
+	}
+	printf("vrs max diff soa/aos %.3e%s\n", diff, nerr ? " (soa and epoch output mismatch)" : "");
+	for (k = 0; k < 3; ++k)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (loop = 0; loop < nloop; ++loop)
+		{
+			base.ws += 1.0;
+			if (k > 0) epoch2soa(&base, &base_soa);
+			for (i = 0; i < nrove; ++i)
+			{
+				if (k == 0)
+				{
+					n = make_vrs_measurement(base.obs, base.vec, base.pos, base.n, &rove[i * 3], out[0].obs, out[0].vec);
+					sum += out[0].obs[n - 1].P[0];
+				}
+				else if (k == 1)
+				{
+					n = make_vrs_measurement_soa(&base_soa, &rove[i * 3], &out_soa);
+					sum += out_soa.P[0][n - 1];
+				}
+				else
+				{
+					n = make_vrs_measurement_epoch(&base_soa, &base, &rove[i * 3], &out[2]);
+					sum += out[2].obs[n - 1].P[0];
+				}
+			}
+		}
+		dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (k == 0) base_dt = dt;
+		printf("vrs %-9s %8.2f us/rove %6.2fx\n", names[k], dt * 1.0E6 / nloop / nrove, dt > 0.0 ? base_dt / dt : 0.0);
+	}
+	printf("vrs checksum %.3f\n", sum);
+}
+
+/* round trip of full msm messages, the encoder of the vrs output (messages of 64 cells, the
+*  satellites over one message in the next) against the decoder, every signal must come back */
+static void bench_msm(const char* fname)
+{
+	typedef struct
+	{
+		int sys, msg, nsat, nsig;
+		int code[2];
+		double freq[2];
+	}msm_case_t;
+	const msm_case_t cases[] = {
+		{ SYS_GAL, 1097, 36, 2, { CODE_L1C, CODE_L7Q }, { 1.57542E9, 1.20714E9 } }, /* 32x2 cells + 4 satellites */
+		{ SYS_GPS, 1077, 32, 2, { CODE_L1C, CODE_L2W }, { 1.57542E9, 1.22760E9 } }, /* 64 cells */
+		{ SYS_GPS, 1074, 32, 2, { CODE_L1C, CODE_L2W }, { 1.57542E9, 1.22760E9 } },
+		{ SYS_GPS, 1077, 32, 1, { CODE_L1C, 0 }, { 1.57542E9, 0.0 } }
+	};
+	static epoch_t epoch;
+	static msm_enc_t enc;
+	static rtcm_t rtcm;
+	static nav_t nav;
+	static uint8_t buff[16384];
+	int c = 0, i = 0, j = 0, k = 0, f = 0, nbyte = 0, nmsg = 0, nsig = 0, nok = 0, nerr = 0;
+	double dP = 0.0, dL = 0.0;
+	srand(1);
+	for (c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); ++c)
+	{
+		const msm_case_t* mc = cases + c;
+		memset(&epoch, 0, sizeof(epoch_t));
+		memset(&enc, 0, sizeof(msm_enc_t));
+		epoch.wk = 2300;
+		epoch.ws = 302400.0;
+		for (i = 0; i < mc->nsat; ++i)
+		{
+			sat_obs_t* obs = epoch.obs + i;
+			double range = bench_rand(2.0E7, 2.6E7);
+			obs->sat = (uint8_t)satno(mc->sys, i + 1);
+			obs->prn = (uint8_t)(i + 1);
+			for (f = 0; f < mc->nsig; ++f)
+			{
+				obs->code[f] = (uint8_t)mc->code[f];
+				obs->P[f] = range + bench_rand(-10.0, 10.0); /* signals of a satellite within the fine range */
+				obs->L[f] = obs->P[f] / (CLIGHT / mc->freq[f]) + bench_rand(-100.0, 100.0);
+				obs->D[f] = (float)bench_rand(-3000.0, 3000.0);
+				obs->SNR[f] = 45000;
+			}
+		}
+		epoch.n = mc->nsat;
+		nbyte = write_msm_epoch(&enc, &nav, &epoch, mc->msg, 1, 0, buff, 0, (int)sizeof(buff));
+		/* decode the messages, the last one completes the epoch (sync flag 0) */
+		memset(&rtcm, 0, sizeof(rtcm_t));
+		rtcm.time = gpst2time(epoch.wk, epoch.ws);
+		for (i = 0; i < nbyte; ++i) input_rtcm3(&rtcm, buff[i], &nav);
+		for (i = 0, nmsg = 0; i + 3 <= nbyte; i += 6 + (((buff[i + 1] & 3) << 8) | buff[i + 2])) ++nmsg;
+		nsig = nok = 0;
+		dP = dL = 0.0;
+		for (i = 0; i < epoch.n; ++i)
+		{
+			for (f = 0; f < mc->nsig; ++f, ++nsig)
+			{
+				for (j = 0; j < rtcm.obs.n && rtcm.obs.data[j].sat != epoch.obs[i].sat; ++j);
+				if (j == rtcm.obs.n) continue;
+				for (k = 0; k < NFREQ + NEXOBS && rtcm.obs.data[j].code[k] != epoch.obs[i].code[f]; ++k);
+				if (k == NFREQ + NEXOBS || rtcm.obs.data[j].P[k] == 0.0) continue;
+				dP = fmax(dP, fabs(rtcm.obs.data[j].P[k] - epoch.obs[i].P[f]));
+				dL = fmax(dL, fabs(rtcm.obs.data[j].L[k] - epoch.obs[i].L[f]));
+				++nok;
+			}
+		}
+		if (nok < nsig) ++nerr;
+		printf("msm %4i %2i satellites x %i signals, %i bytes, %i messages, %i/%i signals decoded, max diff %.4f m %.4f cycle\n",
+			mc->msg, mc->nsat, mc->nsig, nbyte, nmsg, nok, nsig, dP, dL);
+	}
+	printf("msm round trip %s\n", nerr ? "failed" : "ok");
+}
+
+/* framing of a recorded file, fgetc byte by byte (the former replay loop) against the
+   memory mapped replay, the frames are only counted */
+/* entries accepted by the grid queries of the bench (even ids) */
+static int accept_even(void* arg, int id)
+{
+	(void)arg;
+	return (id & 1) == 0;
+}
+
+/* grid index regression and query speed on random sites: grid_nearest and grid_radius must
+*  give the same entries as the linear scan after inserts, moves and removes, dense (shell
+*  search) and sparse (linear scan of the index) */
+static void bench_grid_case(int nsite, double size, double cell, int nquery)
+{
+	grid_index_t grid;
+	std::vector<double> xyz(nsite * 3);
+	std::vector<int> used(nsite, 0), ids(nsite + 1), ref;
+	std::vector<std::pair<double, int> > all;
+	double dist[8] = { 0 }, p[3] = { 0 }, center[3] = { -2853445.0, 4667464.0, 3268291.0 };
+	double maxdist = 0.0, r = 0.0, dt[2] = { 0 }, sum[2] = { 0 };
+	int i = 0, j = 0, q = 0, k = 0, n = 0, nerr[2] = { 0 };
+	grid_init(&grid, cell);
+	for (i = 0; i < nsite; ++i)
+	{
+		for (j = 0; j < 3; ++j) xyz[i * 3 + j] = center[j] + bench_rand(-size, size);
+		used[i] = grid_update(&grid, i, &xyz[i * 3]);
+	}
+	/* move and remove some sites */
+	for (i = 0; i < nsite; i += 7)
+	{
+		for (j = 0; j < 3; ++j) xyz[i * 3 + j] = center[j] + bench_rand(-size, size);
+		used[i] = grid_update(&grid, i, &xyz[i * 3]);
+	}
+	for (i = 3; i < nsite; i += 11)
+	{
+		grid_remove(&grid, i);
+		used[i] = 0;
+	}
+	for (q = 0; q < nquery; ++q)
+	{
+		int accept = q % 3 == 0;
+		for (j = 0; j < 3; ++j) p[j] = center[j] + bench_rand(-1.2 * size, 1.2 * size);
+		k = 1 + q % 8;
+		maxdist = q % 4 == 1 ? bench_rand(0.0, size) : 0.0;
+		all.clear();
+		for (i = 0; i < nsite; ++i)
+		{
+			if (!used[i] || (accept && !accept_even(NULL, i))) continue;
+			double dx = xyz[i * 3] - p[0], dy = xyz[i * 3 + 1] - p[1], dz = xyz[i * 3 + 2] - p[2];
+			double d = sqrt(dx * dx + dy * dy + dz * dz);
+			if (maxdist > 0.0 && d > maxdist) continue;
+			all.push_back(std::make_pair(d, i));
+		}
+		std::sort(all.begin(), all.end());
+		n = grid_nearest(&grid, p, k, maxdist, accept ? accept_even : NULL, NULL, &ids[0], dist);
+		if (n != (int)(all.size() < (size_t)k ? all.size() : (size_t)k)) ++nerr[0];
+		else
+		{
+			for (i = 0; i < n; ++i)
+			{
+				if (fabs(dist[i] - all[i].first) > 1.0E-6 || (ids[i] != all[i].second && fabs(dist[i] - all[i].first) > 0.0)) ++nerr[0];
+			}
+		}
+		/* radius query against the same scan without the filter */
+		r = bench_rand(0.0, 0.5 * size);
+		ref.clear();
+		for (i = 0; i < nsite; ++i)
+		{
+			double dx = xyz[i * 3] - p[0], dy = xyz[i * 3 + 1] - p[1], dz = xyz[i * 3 + 2] - p[2];
+			if (used[i] && sqrt(dx * dx + dy * dy + dz * dz) <= r) ref.push_back(i);
+		}
+		n = grid_radius(&grid, p, r, &ids[0], nsite + 1);
+		std::sort(ids.begin(), ids.begin() + n);
+		if (n != (int)ref.size() || !std::equal(ref.begin(), ref.end(), ids.begin())) ++nerr[1];
+	}
+	/* nearest site, grid and linear scan */
+	for (int m = 0; m < 2; ++m)
+	{
+		srand(1);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (q = 0; q < nquery; ++q)
+		{
+			for (j = 0; j < 3; ++j) p[j] = center[j] + bench_rand(-size, size);
+			if (m == 0)
+			{
+				double best = 1.0E30;
+				for (i = 0; i < nsite; ++i)
+				{
+					if (!used[i]) continue;
+					double dx = xyz[i * 3] - p[0], dy = xyz[i * 3 + 1] - p[1], dz = xyz[i * 3 + 2] - p[2];
+					double d = sqrt(dx * dx + dy * dy + dz * dz);
+					if (d < best) best = d;
+				}
+				sum[m] += best;
+			}
+			else if (grid_nearest(&grid, p, 1, 0.0, NULL, NULL, &ids[0], dist)) sum[m] += dist[0];
+		}
+		dt[m] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	}
+	printf("grid %6i sites %8.0f km %6.0f km cell, %i queries, %i nearest and %i radius mismatches\n", nsite, size / 500.0, cell / 1000.0, nquery, nerr[0], nerr[1]);
+	printf("grid nearest linear %10.1f ns, grid %10.1f ns %6.2fx%s\n", dt[0] / nquery * 1.0e9, dt[1] / nquery * 1.0e9, dt[1] > 0.0 ? dt[0] / dt[1] : 0.0, fabs(sum[0] - sum[1]) < 1.0E-3 ? "" : " (checksum mismatch)");
+	grid_free(&grid);
+}
+
+static void bench_grid(const char* fname)
+{
+	(void)fname;
+	srand(1);
+	bench_grid_case(20, 300000.0, 50000.0, 20000);     /* few stations, linear scan of the index */
+	bench_grid_case(2000, 1000000.0, 50000.0, 20000);  /* base stations of a large network */
+	bench_grid_case(20000, 100000.0, 2500.0, 20000);   /* vrs of the rovers */
+}
+
+static void bench_replay(const char* fname)
+{
+	rtcm_replay_t replay;
+	rtcm_frame_t frame = { 0 };
+	uint8_t buff[RTCM3_MAX_FRAME] = { 0 };
+	uint64_t nbyte = 0, nframe[2] = { 0 }, sum[2] = { 0 };
+	double dt[2] = { 0 };
+	int c = 0, n = 0, len = 0;
+	uint32_t crc = 0;
+	FILE* fp = fopen(fname, "rb");
+	if (!fp)
+	{
+		printf("no file %s\n", fname);
+		return;
+	}
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	while ((c = fgetc(fp)) != EOF)
+	{
+		++nbyte;
+		if (n == 0 && c != 0xD3) continue;
+		buff[n++] = (uint8_t)c;
+		if (n < 3) continue;
+		len = (((buff[1] & 0x03) << 8) | buff[2]) + 6;
+		if (n < len) continue;
+		crc = ((uint32_t)buff[len - 3] << 16) | ((uint32_t)buff[len - 2] << 8) | buff[len - 1];
+		if (crc24q_fast(buff, len - 3) == crc)
+		{
+			++nframe[0];
+			sum[0] += len;
+		}
+		n = 0;
+	}
+	dt[0] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	fclose(fp);
+	t0 = std::chrono::steady_clock::now();
+	if (rtcm_replay_open(&replay, fname, REPLAY_HUGEPAGE))
+	{
+		while (rtcm_replay_next(&replay, &frame))
+		{
+			if (frame.crc) continue;
+			++nframe[1];
+			sum[1] += frame.len;
+		}
+		rtcm_replay_close(&replay);
+	}
+	dt[1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	printf("replay: %.0f bytes, frames %.0f/%.0f, bytes of frames %.0f/%.0f\n", (double)nbyte, (double)nframe[0], (double)nframe[1], (double)sum[0], (double)sum[1]);
+	printf("replay fgetc  %10.1f MB/s\n", dt[0] > 0.0 ? nbyte / dt[0] / 1.0e6 : 0.0);
+	printf("replay mmap   %10.1f MB/s %6.2fx\n", dt[1] > 0.0 ? nbyte / dt[1] / 1.0e6 : 0.0, dt[1] > 0.0 ? dt[0] / dt[1] : 0.0);
+}
+
+extern void engine_bench_main(const char* name, const char* fname)
+{
+	if (!name || !fname) return;
+	if (strcmp(name, "crc24q") == 0)
+	{
+		bench_crc24q(fname);
+	}
+	else if (strcmp(name, "bitstream") == 0)
+	{
+		bench_bitstream(fname);
+	}
+	else if (strcmp(name, "ingest") == 0)
+	{
+		bench_ingest(fname);
+	}
+	else if (strcmp(name, "orbit") == 0)
+	{
+		bench_orbit(fname);
+	}
+	else if (strcmp(name, "vrs") == 0)
+	{
+		bench_vrs(fname);
+	}
+	else if (strcmp(name, "replay") == 0)
+	{
+		bench_replay(fname);
+	}
+	else if (strcmp(name, "msm") == 0)
+	{
+		bench_msm(fname);
+	}
+	else if (strcmp(name, "grid") == 0)
+	{
+		bench_grid(fname);
+	}
+	else
+	{
+		printf("unknown benchmark %s\n", name);
+	}
+}
@@ -0,0 +1,20 @@
+//------------------------------------------------------------------------------
+#ifndef _GNSS_PROC_BENCH_H_
+#define _GNSS_PROC_BENCH_H_
+//------------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	//--------------------------------------------------------------------------
+	/* micro benchmarks on recorded data, name => crc24q, bitstream, ingest, orbit, vrs, replay, msm
+	*  (round trip check of full msm messages), grid (station index against the linear scan)
+	*  project file line: 5,name,rtcm_file_name (orbit, vrs, msm, grid: synthetic data, file not used) */
+	void engine_bench_main(const char* name, const char* fname);
+	//--------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,70 +3,31 @@
 //------------------------------------------------------------------------------
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <fstream>
 #include <cmath>
 #include <ctime>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <map>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <glob.h>
+#endif
 //------------------------------------------------------------------------------
 
 #include "vrs.h"
+#include "rtcm_replay.h"
+#include "gnss_archive.h"
 
 #pragma warning (disable:4996)
 #pragma warning (disable:0266)
 
-#ifndef MAX_RTCM_BUF_LEN
-#define MAX_RTCM_BUF_LEN 1200
-#endif
-
-#ifndef RTCM3PREAMB
-#define RTCM3PREAMB 0xD3        /* rtcm ver.3 frame preamble */
-#endif
-
-static const unsigned int tbl_CRC24Q[] = {
-	0x000000,0x864CFB,0x8AD50D,0x0C99F6,0x93E6E1,0x15AA1A,0x1933EC,0x9F7F17,
-	0xA18139,0x27CDC2,0x2B5434,0xAD18CF,0x3267D8,0xB42B23,0xB8B2D5,0x3EFE2E,
-	0xC54E89,0x430272,0x4F9B84,0xC9D77F,0x56A868,0xD0E493,0xDC7D65,0x5A319E,
-	0x64CFB0,0xE2834B,0xEE1ABD,0x685646,0xF72951,0x7165AA,0x7DFC5C,0xFBB0A7,
-	0x0CD1E9,0x8A9D12,0x8604E4,0x00481F,0x9F3708,0x197BF3,0x15E205,0x93AEFE,
-	0xAD50D0,0x2B1C2B,0x2785DD,0xA1C926,0x3EB631,0xB8FACA,0xB4633C,0x322FC7,
-	0xC99F60,0x4FD39B,0x434A6D,0xC50696,0x5A7981,0xDC357A,0xD0AC8C,0x56E077,
-	0x681E59,0xEE52A2,0xE2CB54,0x6487AF,0xFBF8B8,0x7DB443,0x712DB5,0xF7614E,
-	0x19A3D2,0x9FEF29,0x9376DF,0x153A24,0x8A4533,0x0C09C8,0x00903E,0x86DCC5,
-	0xB822EB,0x3E6E10,0x32F7E6,0xB4BB1D,0x2BC40A,0xAD88F1,0xA11107,0x275DFC,
-	0xDCED5B,0x5AA1A0,0x563856,0xD074AD,0x4F0BBA,0xC94741,0xC5DEB7,0x43924C,
-	0x7D6C62,0xFB2099,0xF7B96F,0x71F594,0xEE8A83,0x68C678,0x645F8E,0xE21375,
-	0x15723B,0x933EC0,0x9FA736,0x19EBCD,0x8694DA,0x00D821,0x0C41D7,0x8A0D2C,
-	0xB4F302,0x32BFF9,0x3E260F,0xB86AF4,0x2715E3,0xA15918,0xADC0EE,0x2B8C15,
-	0xD03CB2,0x567049,0x5AE9BF,0xDCA544,0x43DA53,0xC596A8,0xC90F5E,0x4F43A5,
-	0x71BD8B,0xF7F170,0xFB6886,0x7D247D,0xE25B6A,0x641791,0x688E67,0xEEC29C,
-	0x3347A4,0xB50B5F,0xB992A9,0x3FDE52,0xA0A145,0x26EDBE,0x2A7448,0xAC38B3,
-	0x92C69D,0x148A66,0x181390,0x9E5F6B,0x01207C,0x876C87,0x8BF571,0x0DB98A,
-	0xF6092D,0x7045D6,0x7CDC20,0xFA90DB,0x65EFCC,0xE3A337,0xEF3AC1,0x69763A,
-	0x578814,0xD1C4EF,0xDD5D19,0x5B11E2,0xC46EF5,0x42220E,0x4EBBF8,0xC8F703,
-	0x3F964D,0xB9DAB6,0xB54340,0x330FBB,0xAC70AC,0x2A3C57,0x26A5A1,0xA0E95A,
-	0x9E1774,0x185B8F,0x14C279,0x928E82,0x0DF195,0x8BBD6E,0x872498,0x016863,
-	0xFAD8C4,0x7C943F,0x700DC9,0xF64132,0x693E25,0xEF72DE,0xE3EB28,0x65A7D3,
-	0x5B59FD,0xDD1506,0xD18CF0,0x57C00B,0xC8BF1C,0x4EF3E7,0x426A11,0xC426EA,
-	0x2AE476,0xACA88D,0xA0317B,0x267D80,0xB90297,0x3F4E6C,0x33D79A,0xB59B61,
-	0x8B654F,0x0D29B4,0x01B042,0x87FCB9,0x1883AE,0x9ECF55,0x9256A3,0x141A58,
-	0xEFAAFF,0x69E604,0x657FF2,0xE33309,0x7C4C1E,0xFA00E5,0xF69913,0x70D5E8,
-	0x4E2BC6,0xC8673D,0xC4FECB,0x42B230,0xDDCD27,0x5B81DC,0x57182A,0xD154D1,
-	0x26359F,0xA07964,0xACE092,0x2AAC69,0xB5D37E,0x339F85,0x3F0673,0xB94A88,
-	0x87B4A6,0x01F85D,0x0D61AB,0x8B2D50,0x145247,0x921EBC,0x9E874A,0x18CBB1,
-	0xE37B16,0x6537ED,0x69AE1B,0xEFE2E0,0x709DF7,0xF6D10C,0xFA48FA,0x7C0401,
-	0x42FA2F,0xC4B6D4,0xC82F22,0x4E63D9,0xD11CCE,0x575035,0x5BC9C3,0xDD8538
-};
-
-extern unsigned int crc24q(unsigned char* buff, int len)
-{
-	unsigned int crc = 0;
-	int i;
-
-	for (i = 0; i < len; i++) crc = ((crc << 8) & 0xFFFFFF) ^ tbl_CRC24Q[(crc >> 16) ^ buff[i]];
-	return crc;
-}
-
 extern unsigned int getbitu(unsigned char* buff, int pos, int len)
 {
 	unsigned int bits = 0;
@@ -79,9 +40,7 @@ extern unsigned int getbitu(unsigned char* buff, int pos, int len)
 typedef struct {        /* RTCM control struct type */
 	int staid;          /* station id */
 	int type;
-	int nbyte;          /* number of bytes in message buffer */
 	int len;            /* message length (bytes) */
-	unsigned char buff[MAX_RTCM_BUF_LEN]; /* message buffer */
 	int crc;
 	int sync;
 	int prn;
@@ -91,33 +50,17 @@ typedef struct {        /* RTCM control struct type */
 	int frq;
 } rtcm_buff_t;
 
-static int add_rtcm_to_buff(rtcm_buff_t* rtcm, unsigned char data)
+/* message type, station and time of a complete frame (the span of the replay, not copied) */
+static int decode_rtcm3_type(rtcm_buff_t* rtcm, unsigned char* buff, int len, int crc)
 {
+	int ret = 0, i = 24, type = 0;
 	rtcm->type = 0;
-	rtcm->crc = 0;
 	rtcm->staid = 0;
-
-	if (rtcm->nbyte >= MAX_RTCM_BUF_LEN) rtcm->nbyte = 0;
-	if (rtcm->nbyte == 0) {
-		if (data != RTCM3PREAMB) return 0;
-		rtcm->buff[rtcm->nbyte++] = data;
-		return 0;
-	}
-	rtcm->buff[rtcm->nbyte++] = data;
-	return 1;
-}
-
-static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
-{
-	int ret = 0, i = 24, type = 0;
-	if (add_rtcm_to_buff(rtcm, data) == 0) return 0;
-
-	if (rtcm->nbyte < 3) return 0;
-	rtcm->len = getbitu(rtcm->buff, 14, 10) + 3; /* length without parity */
-	if (rtcm->nbyte < rtcm->len + 3) return 0;
-	rtcm->nbyte = 0;
+	rtcm->crc = crc;
+	rtcm->len = len - 3; /* length without parity */
+	if (len < 8) return 0;
 	i = 24;
-	type = rtcm->type = getbitu(rtcm->buff, i, 12); i += 12;
+	type = rtcm->type = getbitu(buff, i, 12); i += 12;
 
     if (type == 1071 || type == 1072 || type == 1073 || type == 1074 || type == 1075 || type == 1076 || type == 1077 || /* GPS */
 		type == 1081 || type == 1082 || type == 1083 || type == 1084 || type == 1085 || type == 1086 || type == 1087 || /* GLO */
@@ -130,8 +73,9 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 		type == 1009 || type == 1010 || type == 1011 || type == 1012 || /* RTCM 2.x */
 		type == 1005 || type == 1006 || type == 1007 || type == 1008 || type == 1033 || type == 1230)
     {
-        rtcm->staid = getbitu(rtcm->buff, i, 12);// i += 12;
+        rtcm->staid = getbitu(buff, i, 12);// i += 12;
 	}
+    if (crc) return 0; /* only the head of a corrupted frame */
     /* decode rtcm3 message */
     if ((rtcm->type == 1074 || rtcm->type == 1075 || rtcm->type == 1076 || rtcm->type == 1077)|| /* GPS */
         (rtcm->type == 1094 || rtcm->type == 1095 || rtcm->type == 1096 || rtcm->type == 1097)|| /* GAL */
@@ -139,67 +83,59 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
         (rtcm->type == 1114 || rtcm->type == 1115 || rtcm->type == 1116 || rtcm->type == 1117))   /* QZS */
     {
         /* GPS, GAL, SBS, QZS */
-        rtcm->staid = getbitu(rtcm->buff, i, 12);           i += 12;
-        rtcm->ws    = getbitu(rtcm->buff, i, 30) * 0.001;   i += 30;
-        rtcm->sync  = getbitu(rtcm->buff, i,  1);           i +=  1;
+        rtcm->staid = getbitu(buff, i, 12);           i += 12;
+        rtcm->ws    = getbitu(buff, i, 30) * 0.001;   i += 30;
+        rtcm->sync  = getbitu(buff, i,  1);           i +=  1;
         ret = rtcm->sync?0:1;
     }
     if (rtcm->type == 1084 || rtcm->type == 1085 || rtcm->type == 1086 || rtcm->type == 1087)
     {
 		/* GLO */
-        rtcm->staid = getbitu(rtcm->buff, i, 12);				  i += 12;
-        double dow  = getbitu(rtcm->buff, i,  3);           i +=  3;
-        double tod  = getbitu(rtcm->buff, i, 27) * 0.001;   i += 27;
-        rtcm->sync  = getbitu(rtcm->buff, i,  1);                i +=  1;
+        rtcm->staid = getbitu(buff, i, 12);				  i += 12;
+        double dow  = getbitu(buff, i,  3);           i +=  3;
+        double tod  = getbitu(buff, i, 27) * 0.001;   i += 27;
+        rtcm->sync  = getbitu(buff, i,  1);                i +=  1;
         rtcm->ws  = dow * 24.0 * 3600.0 + tod - 3.0 * 3600.0 + 18.0;
         ret = rtcm->sync?0:1;
     }
     if (rtcm->type == 1124 || rtcm->type == 1125 || rtcm->type == 1126 || rtcm->type == 1127)
     {
 		/* BDS */
-        rtcm->staid = getbitu(rtcm->buff, i, 12);           i += 12;
-        rtcm->ws    = getbitu(rtcm->buff, i, 30) * 0.001;   i += 30;
-        rtcm->sync  = getbitu(rtcm->buff,i, 1);             i +=  1;
+        rtcm->staid = getbitu(buff, i, 12);           i += 12;
+        rtcm->ws    = getbitu(buff, i, 30) * 0.001;   i += 30;
+        rtcm->sync  = getbitu(buff,i, 1);             i +=  1;
         rtcm->ws += 14.0; /* BDT -> GPST */
         ret = rtcm->sync?0:1;
     }
     if (rtcm->type == 1019)
     {
-        rtcm->prn   =getbitu(rtcm->buff,i, 6);              i+= 6;
-        rtcm->week  =getbitu(rtcm->buff,i,10);              i+=10;
+        rtcm->prn   =getbitu(buff,i, 6);              i+= 6;
+        rtcm->week  =getbitu(buff,i,10);              i+=10;
         rtcm->week +=2048;
     }
     if (rtcm->type == 1020)
     {
-        rtcm->prn   =getbitu(rtcm->buff,i, 6);              i+= 6;
-        rtcm->frq   =getbitu(rtcm->buff,i, 5)-7;            i+= 5+2+2;
+        rtcm->prn   =getbitu(buff,i, 6);              i+= 6;
+        rtcm->frq   =getbitu(buff,i, 5)-7;            i+= 5+2+2;
     }
     if (rtcm->type == 1042)
     {
-        rtcm->prn   =getbitu(rtcm->buff,i, 6);              i+= 6;
-        rtcm->week  =getbitu(rtcm->buff,i,13);              i+=13;
+        rtcm->prn   =getbitu(buff,i, 6);              i+= 6;
+        rtcm->week  =getbitu(buff,i,13);              i+=13;
         rtcm->week +=1356; /* BDT week to GPS week */
     }
     if (rtcm->type == 1044)
     {
-        rtcm->prn   =getbitu(rtcm->buff,i, 4);              i+= 4+430;
-        rtcm->week  =getbitu(rtcm->buff,i,10);              i+=10;
+        rtcm->prn   =getbitu(buff,i, 4);              i+= 4+430;
+        rtcm->week  =getbitu(buff,i,10);              i+=10;
         rtcm->week  +=2048;
     }		
     if (rtcm->type == 1045|| rtcm->type == 1046)
     {
-        rtcm->prn   =getbitu(rtcm->buff,i, 6);              i+= 6;
-        rtcm->week  =getbitu(rtcm->buff,i,12);              i+=12; /* gst-week */
+        rtcm->prn   =getbitu(buff,i, 6);              i+= 6;
+        rtcm->week  =getbitu(buff,i,12);              i+=12; /* gst-week */
         rtcm->week +=1024 ; /* gal-week = gst-week + 1024 */
     }
-	/* check parity */
-	if (crc24q(rtcm->buff, rtcm->len) != getbitu(rtcm->buff, rtcm->len * 8, 24)) {
-		rtcm->crc = 1;
-	}
-	else 
-	{
-		rtcm->crc = 0;
-	}
 	return ret;// rtcm->len + 3;
 }
 	//--------------------------------------------------------------------------
@@ -226,6 +162,10 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 		int nloc = 0;
 		vdate_t vdate = { 0 };
 		std::vector<vxyz_t> vxyz;
+		std::vector<std::string> names; /* rtcm files of the batch (hourly files, wildcards, index files) */
+		double shard = 0.0, warmup = BATCH_WARMUP, hours = 0.0;
+		int nthread = 0, staid = -1;
+		vdate_t window = { 0 };
 
 		while (fINI && !feof(fINI))
 		{
@@ -246,6 +186,7 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 			if (strstr(keystr, "rtcm"))
 			{
 				int num = sscanf(buffer + nloc + 1, "%s", logfname);
+				if (num > 0) names.push_back(logfname);
 				continue;
 			}
 			if (strstr(keystr, "date"))
@@ -260,6 +201,32 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 				}
 				continue;
 			}
+			if (strstr(keystr, "shard"))
+			{
+				int num = sscanf(buffer + nloc + 1, "%lf", &shard);
+				continue;
+			}
+			if (strstr(keystr, "warmup"))
+			{
+				int num = sscanf(buffer + nloc + 1, "%lf", &warmup);
+				continue;
+			}
+			if (strstr(keystr, "thread"))
+			{
+				int num = sscanf(buffer + nloc + 1, "%i", &nthread);
+				continue;
+			}
+			if (strstr(keystr, "station"))
+			{
+				int num = sscanf(buffer + nloc + 1, "%i", &staid);
+				continue;
+			}
+			if (strstr(keystr, "window"))
+			{
+				int num = sscanf(buffer + nloc + 1, "%i %i %i %i %lf", &window.year, &window.mon, &window.day, &window.hour, &hours);
+				if (num < 5) hours = 0.0;
+				continue;
+			}
 			if (strstr(keystr, "rove"))
 			{
 				vxyz_t cur_rove = { 0 };
@@ -272,34 +239,98 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 			}
 		}
 		if (fINI) fclose(fINI);
-		engine_pp_main_rtcm(logfname, &vdate, (vxyz_t*)(&vxyz[0]), vxyz.size());
+		size_t len = strlen(logfname);
+		std::vector<const char*> fnames;
+		for (size_t i = 0; i < names.size(); ++i) fnames.push_back(names[i].c_str());
+		if (shard > 0.0 || names.size() > 1 || strchr(logfname, '*') || strchr(logfname, '?'))
+			engine_pp_batch_rtcm(&fnames[0], (int)fnames.size(), &vdate, (vxyz_t*)(&vxyz[0]), vxyz.size(), shard, warmup, nthread);
+		else if (len > 4 && strcmp(logfname + len - 4, ".idx") == 0)
+			engine_pp_index_rtcm(logfname, &vdate, (vxyz_t*)(&vxyz[0]), vxyz.size(), staid, &window, hours);
+		else
+			engine_pp_main_rtcm(logfname, &vdate, (vxyz_t*)(&vxyz[0]), vxyz.size());
 		return;
 	}
 
+	/* vrs output of the rovers after each epoch, written once per new vrs epoch, checksum (fnv-1a) for the regression,
+	   fVRS, nbyte and sum can be NULL (warm-up of a shard, only the last vrs epoch is kept) */
+	static void output_vrs_data(FILE* fVRS, int nxyz, std::vector<std::vector<uint8_t> >& last, uint64_t* nbyte, uint64_t* sum)
+	{
+		for (int i = 0; i < nxyz; ++i)
+		{
+			int n = 0;
+			const uint8_t* data = get_vrs_rove_data(i + 1, &n);
+			if (!data || n <= 0) continue;
+			if (last[i].size() == (size_t)n && memcmp(&last[i][0], data, n) == 0) continue; /* same vrs epoch */
+			last[i].assign(data, data + n);
+			for (int j = 0; sum && j < n; ++j)
+			{
+				*sum ^= data[j];
+				*sum *= 1099511628211ULL;
+			}
+			if (nbyte) *nbyte += n;
+			if (fVRS) fwrite(data, 1, n, fVRS);
+		}
+	}
+
+	/* frame (crc passed) to the engine, the messages without station ID (ephemerides) go with the station
+	   of the previous frame (the archive keeps the frames of one station block together), the ones before
+	   the first station wait for it, return the station ID of the frame */
+	static int input_rtcm_frame(const rtcm_buff_t* rtcm, rtcm_frame_t* frame, int staid, std::vector<std::vector<uint8_t> >& pending)
+	{
+		if (rtcm->staid > 0) staid = rtcm->staid;
+		if (staid == 0)
+		{
+			pending.push_back(std::vector<uint8_t>(frame->buff, frame->buff + frame->len));
+		}
+		else
+		{
+			for (size_t i = 0; i < pending.size(); ++i)
+				set_rtcm_data_frame(staid, &pending[i][0], (int)pending[i].size(), NULL);
+			pending.clear();
+			set_rtcm_data_frame(staid, frame->buff, frame->len, NULL);
+		}
+		return staid;
+	}
+
 	void engine_pp_main_rtcm(const char* fname, vdate_t* date, vxyz_t* vxyz, int nxyz)
 	{
-		FILE *fRTCM = fopen(fname, "rb"); if (!fRTCM) return;
+		/* the file is mapped and framed once, each frame goes to the engine as a span of the mapping */
+		rtcm_replay_t replay;
+		size_t len = strlen(fname);
+		if (len > 4 && strcmp(fname + len - 4, ".idx") == 0)
+		{
+			/* segment archive, all stations of the hour */
+			engine_pp_index_rtcm(fname, date, vxyz, nxyz, -1, NULL, 0.0);
+			return;
+		}
+		if (!rtcm_replay_open(&replay, fname, REPLAY_HUGEPAGE)) return;
 		//--------------------------------------------------------------------------	   
 		clock_t st = clock();
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
 		//--------------------------------------------------------------------------	   
 		FILE * fLOG = fopen("rtk.log", "w");
+		FILE * fVRS = nxyz > 0 ? fopen("vrs.rtcm3", "wb") : NULL;
+		std::vector<std::vector<uint8_t> > vrs_last(nxyz);
+		uint64_t vrs_bytes = 0, vrs_sum = 1469598103934665603ULL;
 		//--------------------------------------------------------------------------	
 		rtcm_buff_t rtcm_buffer = { 0 };
-		int data = 0;
+		rtcm_frame_t frame = { 0 };
 		unsigned long numOfpacket = 0;
 		unsigned long numofcrc = 0;
 		unsigned long numofepoch = 0;
+		int staid = 0;
+		std::vector<std::vector<uint8_t> > pending; /* frames before the first station ID */
 		double ws = 0.0;
 		set_raw_data_option(0); /* turn off raw data output */
 		set_log_data_option(0); /* turn off log data output */
+		set_replay_time_option(1); /* virtual clock from the data, the output does not depend on the host clock */
 		set_appr_time(date->year, date->mon, date->day, date->hour);
 		for (int i = 0; i < nxyz; ++i)
 			add_vrs_rover_data(i + 1, vxyz[i].xyz);
 		//--------------------------------------------------------------------------	
-		while (fRTCM && !feof(fRTCM))
+		while (rtcm_replay_next(&replay, &frame))
 		{
-			if ((data = fgetc(fRTCM)) == EOF) break;
-			int ret = input_rtcm3_type(&rtcm_buffer, (unsigned char)data);
+			int ret = decode_rtcm3_type(&rtcm_buffer, frame.buff, frame.len, frame.crc);
 			if (rtcm_buffer.type > 0)
 			{
 				if (rtcm_buffer.crc == 1)
@@ -312,24 +343,30 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 				else
 				{
 					/* pass crc check, decode the rtcm data */
-					printf("%4i,%4i,%4i,%10.3f,%4i,%u\n", rtcm_buffer.type, rtcm_buffer.staid, rtcm_buffer.len + 3, rtcm_buffer.ws, rtcm_buffer.week, numofepoch);
 					if (fLOG) fprintf(fLOG, "%4i,%4i,%4i,%10.3f,%4i,%u\n", rtcm_buffer.type, rtcm_buffer.staid, rtcm_buffer.len + 3, rtcm_buffer.ws, rtcm_buffer.week, numofepoch);
 				}
 				if (fabs(rtcm_buffer.ws - ws) > 0.001)
 				{
+					/* new epoch, the vrs of the previous epoch is complete */
+					output_vrs_data(fVRS, nxyz, vrs_last, &vrs_bytes, &vrs_sum);
+					ws = rtcm_buffer.ws;
 					++numofepoch;
 					if (numofepoch % 3600 == 0)
 					{
 						system_status_output(fLOG);
 					}
 				}
-				/* API interface option 1 */
-				ret = set_rtcm_data_buff(rtcm_buffer.staid, rtcm_buffer.buff, rtcm_buffer.len + 3, NULL);
+				/* API interface option 2, the frame is already checked */
+				if (rtcm_buffer.crc == 0)
+					staid = input_rtcm_frame(&rtcm_buffer, &frame, staid, pending);
 				++numOfpacket;
 			}
 		}
+		output_vrs_data(fVRS, nxyz, vrs_last, &vrs_bytes, &vrs_sum);
+		double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
 		//----------------------------------------------------------------------
 		printf("%s,%6u,%6u,%10.3f\n", fname, numOfpacket, numofcrc, double((clock() - st)) / CLOCKS_PER_SEC);
+		printf("%s,%6u epochs,%10.1f epochs/s,%llu vrs bytes,%016llX vrs checksum\n", fname, numofepoch, dt > 0.0 ? numofepoch / dt : 0.0, (unsigned long long)vrs_bytes, (unsigned long long)vrs_sum);
 		//----------------------------------------------------------------------
 		/* system status for each packets */
 		system_status_output(fLOG);
@@ -337,11 +374,604 @@ static int input_rtcm3_type(rtcm_buff_t* rtcm, unsigned char data)
 		system_exit();
 		//----------------------------------------------------------------------
 		if (fLOG) fprintf(fLOG, "%s,%6u,%6u,%10.3f\n", fname, numOfpacket, numofcrc, double((clock() - st)) / CLOCKS_PER_SEC);
-		if (fRTCM) fclose(fRTCM);
+		if (fLOG) fprintf(fLOG, "%s,%6u epochs,%10.1f epochs/s,%llu vrs bytes,%016llX vrs checksum\n", fname, numofepoch, dt > 0.0 ? numofepoch / dt : 0.0, (unsigned long long)vrs_bytes, (unsigned long long)vrs_sum);
+		set_replay_time_option(0);
+		rtcm_replay_close(&replay);
+		if (fVRS) fclose(fVRS);
 		if (fLOG) fclose(fLOG);
 		//----------------------------------------------------------------------
 		return;
 	}
+
+	/*--------------------------------------------------------------------------
+	  batch reprocessing of an archive in time shards, each shard runs on its own engine (thread) from
+	  a warm-up before the shard (ephemerides, lock state and the vrs cache of the rovers) and writes
+	  the vrs output of the epochs of the shard only, the outputs are merged in time order
+	--------------------------------------------------------------------------*/
+	typedef struct
+	{
+		double start;      /* first epoch of the shard (gps seconds) */
+		double warm;       /* time of the first warm-up frame (gps seconds), 0: start of the archive */
+		size_t file;       /* file of the first warm-up frame */
+		int64_t offset;    /* byte offset of the first warm-up frame (record of the index) */
+		uint64_t first;    /* index of the first warm-up frame */
+		uint64_t begin;    /* index of the first frame of the shard */
+		uint64_t end;      /* index of the first frame of the next shard */
+		unsigned long numofepoch;
+		unsigned long numofcrc;
+		uint64_t nbyte;    /* vrs bytes */
+		double dt;         /* process time (s) */
+		int ok;
+		std::vector<std::vector<uint8_t> > keep; /* newest ephemerides and station messages before the warm-up */
+	}shard_t;
+
+	/* gps seconds of the date (days from 1980/1/6, leap seconds not used, the date is approximate) */
+	static double date2gpst(int year, int mon, int day, int hour)
+	{
+		int y = mon <= 2 ? year - 1 : year;
+		int era = (y >= 0 ? y : y - 399) / 400;
+		int yoe = y - era * 400;
+		int doy = (153 * (mon > 2 ? mon - 3 : mon + 9) + 2) / 5 + day - 1;
+		int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		double days = era * 146097.0 + doe - 719468.0 - 3657.0; /* 1970/1/1 -> 1980/1/6 */
+		return days * 86400.0 + hour * 3600.0;
+	}
+
+	/* date (hour) of the gps seconds */
+	static void gpst2date(double t, vdate_t* date)
+	{
+		long z = (long)floor(t / 86400.0) + 3657 + 719468;
+		long era = z / 146097;
+		long doe = z - era * 146097;
+		long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		long mp = (5 * doy + 2) / 153;
+		date->day = (int)(doy - (153 * mp + 2) / 5 + 1);
+		date->mon = (int)(mp < 10 ? mp + 3 : mp - 9);
+		date->year = (int)(yoe + era * 400 + (date->mon <= 2 ? 1 : 0));
+		date->hour = (int)floor((t - floor(t / 86400.0) * 86400.0) / 3600.0);
+	}
+
+	/* time of the seconds of week nearest to the reference time */
+	static double resolve_week_time(double ws, double tref)
+	{
+		double t = floor(tref / 604800.0) * 604800.0 + ws;
+		if (t < tref - 302400.0) t += 604800.0;
+		else if (t > tref + 302400.0) t -= 604800.0;
+		return t;
+	}
+
+	/* key of the messages kept for the shards (ephemeris of a satellite, station info), 0: not kept */
+	static int keep_key(const rtcm_buff_t* rtcm)
+	{
+		switch (rtcm->type)
+		{
+		case 1019: case 1020: case 1042: case 1044: case 1045: case 1046:
+			return rtcm->type * 4096 + rtcm->prn;
+		case 1005: case 1006: case 1007: case 1008: case 1033: case 1230:
+			return rtcm->type * 4096 + rtcm->staid;
+		}
+		return 0;
+	}
+
+	/* compare the file names with the digit runs as numbers (the hourly files are named by the local
+	   time without zero padding of month and day) */
+	static bool name_less(const std::string& a, const std::string& b)
+	{
+		size_t i = 0, j = 0;
+		while (i < a.size() && j < b.size())
+		{
+			if (isdigit((unsigned char)a[i]) && isdigit((unsigned char)b[j]))
+			{
+				size_t i0 = i, j0 = j;
+				while (i0 < a.size() && a[i0] == '0') ++i0;
+				while (j0 < b.size() && b[j0] == '0') ++j0;
+				for (i = i0; i < a.size() && isdigit((unsigned char)a[i]); ++i);
+				for (j = j0; j < b.size() && isdigit((unsigned char)b[j]); ++j);
+				if (i - i0 != j - j0) return i - i0 < j - j0;
+				int c = a.compare(i0, i - i0, b, j0, j - j0);
+				if (c != 0) return c < 0;
+				continue;
+			}
+			if (a[i] != b[j]) return a[i] < b[j];
+			++i;
+			++j;
+		}
+		return a.size() - i < b.size() - j;
+	}
+
+	/* files of the name, a name with wildcards (* ?) gives the matching files in name order */
+	static void expand_names(const char* name, std::vector<std::string>& names)
+	{
+		std::vector<std::string> found;
+		if (!strchr(name, '*') && !strchr(name, '?'))
+		{
+			names.push_back(name);
+			return;
+		}
+#ifdef _WIN32
+		WIN32_FIND_DATAA fd;
+		std::string dir(name);
+		size_t pos = dir.find_last_of("/\\");
+		dir = pos == std::string::npos ? std::string() : dir.substr(0, pos + 1);
+		HANDLE h = FindFirstFileA(name, &fd);
+		if (h != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) found.push_back(dir + fd.cFileName);
+			} while (FindNextFileA(h, &fd));
+			FindClose(h);
+		}
+#else
+		glob_t g;
+		if (glob(name, 0, NULL, &g) == 0)
+		{
+			for (size_t i = 0; i < g.gl_pathc; ++i) found.push_back(g.gl_pathv[i]);
+		}
+		globfree(&g);
+#endif
+		std::sort(found.begin(), found.end(), name_less);
+		names.insert(names.end(), found.begin(), found.end());
+	}
+
+	/* time order of the records (index file, record) of the segment indices */
+	struct batch_time_less
+	{
+		const std::vector<archive_idx_t*>* idx;
+		batch_time_less(const std::vector<archive_idx_t*>* idx) : idx(idx) {}
+		bool operator()(const std::pair<int, int>& a, const std::pair<int, int>& b) const
+		{
+			const archive_idx_t* x = (*idx)[a.first] + a.second;
+			const archive_idx_t* y = (*idx)[b.first] + b.second;
+			return x->sec < y->sec || (x->sec == y->sec && x->ms < y->ms);
+		}
+	};
+
+	/* archive of the batch, rtcm files in time order (hourly files of the raw data) or the segment
+	   indices of raw data option 2 (all records in time order), shared by the shards */
+	typedef struct
+	{
+		std::vector<std::string> names;
+		int index;                             /* 1: segment indices */
+		std::vector<archive_idx_t*> idx;       /* records of each index file */
+		std::vector<std::pair<int, int> > rec; /* (index file, record) in time order */
+	}batch_archive_t;
+
+	/* reader of the archive, each shard has its own */
+	typedef struct
+	{
+		const batch_archive_t* ar;
+		size_t file;                                       /* rtcm file of the replay */
+		int open;                                          /* 1: replay of the file open */
+		rtcm_replay_t replay;
+		size_t k;                                          /* next record of the indices */
+		std::map<std::pair<int, int>, rtcm_replay_t> seg;  /* mapped segment of (index file, station) */
+	}batch_source_t;
+
+	/* archive of the names (files, wildcards, index files), return the number of files */
+	static int batch_archive_open(batch_archive_t* ar, const char** fnames, int nfile)
+	{
+		int i = 0, n = 0;
+		for (i = 0; i < nfile; ++i) expand_names(fnames[i], ar->names);
+		ar->index = 0;
+		for (i = 0; i < (int)ar->names.size(); ++i)
+		{
+			const std::string& name = ar->names[i];
+			if (name.size() > 4 && name.compare(name.size() - 4, 4, ".idx") == 0) ar->index = 1;
+		}
+		if (!ar->index) return (int)ar->names.size();
+		for (i = 0; i < (int)ar->names.size(); ++i)
+		{
+			archive_idx_t* idx = archive_index_load(ar->names[i].c_str(), &n);
+			ar->idx.push_back(idx);
+			for (int k = 0; idx && k < n; ++k) ar->rec.push_back(std::make_pair(i, k));
+		}
+		std::stable_sort(ar->rec.begin(), ar->rec.end(), batch_time_less(&ar->idx));
+		return (int)ar->names.size();
+	}
+
+	static void batch_archive_close(batch_archive_t* ar)
+	{
+		for (size_t i = 0; i < ar->idx.size(); ++i)
+			if (ar->idx[i]) archive_index_free(ar->idx[i]);
+		ar->idx.clear();
+		ar->rec.clear();
+	}
+
+	static void batch_source_init(batch_source_t* src, const batch_archive_t* ar)
+	{
+		src->ar = ar;
+		src->file = 0;
+		src->open = 0;
+		src->k = 0;
+	}
+
+	static void batch_source_close(batch_source_t* src)
+	{
+		std::map<std::pair<int, int>, rtcm_replay_t>::iterator it;
+		if (src->open) rtcm_replay_close(&src->replay);
+		src->open = 0;
+		for (it = src->seg.begin(); it != src->seg.end(); ++it)
+			rtcm_replay_close(&it->second);
+		src->seg.clear();
+	}
+
+	/* next frame of the archive, staid: station of the index record (0: from the frames),
+	   return 1: frame, 0: end of the archive */
+	static int batch_source_next(batch_source_t* src, rtcm_frame_t* frame, int* staid)
+	{
+		const batch_archive_t* ar = src->ar;
+		std::map<std::pair<int, int>, rtcm_replay_t>::iterator it;
+		char segname[1024] = { 0 };
+		*staid = 0;
+		if (!ar->index)
+		{
+			while (1)
+			{
+				if (!src->open)
+				{
+					if (src->file >= ar->names.size()) return 0;
+					if (!rtcm_replay_open(&src->replay, ar->names[src->file].c_str(), 0))
+					{
+						++src->file;
+						continue;
+					}
+					src->open = 1;
+				}
+				if (rtcm_replay_next(&src->replay, frame)) return 1;
+				rtcm_replay_close(&src->replay); /* the next hour */
+				src->open = 0;
+				++src->file;
+			}
+		}
+		for (; src->k < ar->rec.size(); ++src->k)
+		{
+			const archive_idx_t* rec = ar->idx[ar->rec[src->k].first] + ar->rec[src->k].second;
+			std::pair<int, int> key(ar->rec[src->k].first, rec->staid);
+			if ((it = src->seg.find(key)) == src->seg.end())
+			{
+				rtcm_replay_t replay;
+				if (!archive_segment_name(ar->names[key.first].c_str(), rec->staid, "rtcm3", segname, sizeof(segname))) segname[0] = '\0';
+				rtcm_replay_open(&replay, segname, 0); /* missing segment (no data), its frames are skipped */
+				it = src->seg.insert(std::make_pair(key, replay)).first;
+			}
+			if (!it->second.data || (uint64_t)rec->offset + rec->len > it->second.size) continue;
+			frame->buff = it->second.data + rec->offset;
+			frame->len = rec->len;
+			frame->type = rec->type;
+			frame->crc = 0;
+			*staid = rec->staid;
+			++src->k;
+			return 1;
+		}
+		return 0;
+	}
+
+	/* position of the frame just returned (file, byte offset or record), offset -1: across two windows */
+	static void batch_source_pos(const batch_source_t* src, const rtcm_frame_t* frame, size_t* file, int64_t* offset)
+	{
+		*file = src->file;
+		*offset = src->ar->index ? (int64_t)src->k - 1 : rtcm_replay_offset(&src->replay, frame);
+	}
+
+	/* restart at a position of batch_source_pos, return 1: ok, 0: error */
+	static int batch_source_seek(batch_source_t* src, size_t file, int64_t offset)
+	{
+		if (src->ar->index)
+		{
+			src->k = (size_t)offset;
+			return 1;
+		}
+		if (src->open) rtcm_replay_close(&src->replay);
+		src->open = 0;
+		src->file = file;
+		if (file >= src->ar->names.size()) return 0;
+		if (!rtcm_replay_open(&src->replay, src->ar->names[file].c_str(), 0)) return 0;
+		src->open = 1;
+		return rtcm_replay_seek(&src->replay, (uint64_t)offset);
+	}
+
+	/* split the archive into shards of len seconds, the frames are indexed in the order of the replay,
+	   the time of a frame is the newest epoch time so far (the stations are not exactly in time order) */
+	static int index_shards(const batch_archive_t* ar, const vdate_t* date, double len, double warmup, std::vector<shard_t>& shards)
+	{
+		batch_source_t src;
+		rtcm_buff_t rtcm_buffer = { 0 };
+		rtcm_frame_t frame = { 0 };
+		std::vector<shard_t> warm; /* warm-up start of each shard (offset, first, warm, keep) */
+		std::map<int, std::vector<uint8_t> > keep; /* newest message of each key */
+		std::map<int, std::vector<uint8_t> >::iterator it;
+		shard_t cur = shard_t();
+		int key = 0;
+		double ws = 0.0, t0 = 0.0, tmax = date2gpst(date->year, date->mon, date->day, date->hour), t = 0.0;
+		uint64_t idx = 0;
+		int64_t offset = 0;
+		size_t file = 0;
+		int staid = 0;
+		shards.clear();
+		batch_source_init(&src, ar);
+		warm.push_back(cur); /* the first shard starts with the archive */
+		for (idx = 0; batch_source_next(&src, &frame, &staid); ++idx)
+		{
+			decode_rtcm3_type(&rtcm_buffer, frame.buff, frame.len, frame.crc);
+			if (rtcm_buffer.crc == 0 && (key = keep_key(&rtcm_buffer)) != 0) keep[key].assign(frame.buff, frame.buff + frame.len);
+			if (rtcm_buffer.type <= 0 || fabs(rtcm_buffer.ws - ws) <= 0.001) continue;
+			ws = rtcm_buffer.ws;
+			t = resolve_week_time(ws, tmax);
+			if (shards.empty())
+			{
+				t0 = tmax = t;
+				while (t0 + warm.size() * len - warmup <= t0) warm.push_back(warm[0]); /* warm-up from the start of the archive */
+			}
+			if (t > tmax) tmax = t;
+			batch_source_pos(&src, &frame, &file, &offset);
+			if (offset < 0) continue; /* across two windows, the next epoch */
+			while (tmax >= t0 + warm.size() * len - warmup)
+			{
+				cur.file = file;
+				cur.offset = offset;
+				cur.first = idx;
+				cur.warm = tmax;
+				cur.keep.clear();
+				for (it = keep.begin(); it != keep.end(); ++it) cur.keep.push_back(it->second);
+				warm.push_back(cur);
+			}
+			while (tmax >= t0 + shards.size() * len)
+			{
+				cur = warm[shards.size()];
+				cur.start = t0 + shards.size() * len;
+				cur.begin = shards.empty() ? 0 : idx; /* the frames before the first epoch go with the first shard */
+				cur.end = UINT64_MAX;
+				if (!shards.empty()) shards.back().end = idx;
+				shards.push_back(cur);
+			}
+		}
+		batch_source_close(&src);
+		return (int)shards.size();
+	}
+
+	/* process one shard on its own engine, the vrs output of the shard goes to fvrs */
+	static void process_shard(const batch_archive_t* ar, const vdate_t* date, vxyz_t* vxyz, int nxyz, shard_t* shard, const char* fvrs)
+	{
+		batch_source_t src;
+		rtcm_buff_t rtcm_buffer = { 0 };
+		rtcm_frame_t frame = { 0 };
+		std::vector<std::vector<uint8_t> > vrs_last(nxyz);
+		std::vector<std::vector<uint8_t> > pending; /* frames before the first station ID */
+		vdate_t appr = *date;
+		uint64_t idx = 0;
+		double ws = 0.0;
+		int staid = 0, rec_staid = 0;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		engine_t* engine = engine_new();
+		FILE* fVRS = NULL;
+		if (!engine) return;
+		batch_source_init(&src, ar);
+		if (!batch_source_seek(&src, shard->file, shard->offset) || !(fVRS = fopen(fvrs, "wb")))
+		{
+			batch_source_close(&src);
+			engine_free(engine);
+			return;
+		}
+		engine_select(engine); /* the calls of this thread go to the engine of the shard */
+		set_raw_data_option(0); /* the archive files of the engines would have the same names */
+		set_log_data_option(0);
+		set_replay_time_option(1);
+		if (shard->warm > 0.0) gpst2date(shard->warm, &appr);
+		set_appr_time(appr.year, appr.mon, appr.day, appr.hour);
+		for (int i = 0; i < nxyz; ++i)
+			add_vrs_rover_data(i + 1, vxyz[i].xyz);
+		for (size_t i = 0; i < shard->keep.size(); ++i)
+		{
+			/* ephemerides and station messages of the archive before the warm-up */
+			frame.buff = &shard->keep[i][0];
+			frame.len = (int)shard->keep[i].size();
+			decode_rtcm3_type(&rtcm_buffer, frame.buff, frame.len, 0);
+			staid = input_rtcm_frame(&rtcm_buffer, &frame, staid, pending);
+		}
+		rtcm_buffer.ws = 0.0;
+		for (idx = shard->first; idx < shard->end && batch_source_next(&src, &frame, &rec_staid); ++idx)
+		{
+			decode_rtcm3_type(&rtcm_buffer, frame.buff, frame.len, frame.crc);
+			if (rtcm_buffer.type <= 0) continue;
+			if (rtcm_buffer.crc == 1 && idx >= shard->begin) ++shard->numofcrc;
+			if (fabs(rtcm_buffer.ws - ws) > 0.001)
+			{
+				/* new epoch, the output of the warm-up only updates the last vrs epoch of the rovers */
+				if (idx >= shard->begin)
+				{
+					output_vrs_data(fVRS, nxyz, vrs_last, &shard->nbyte, NULL);
+					++shard->numofepoch;
+				}
+				else
+				{
+					output_vrs_data(NULL, nxyz, vrs_last, NULL, NULL);
+				}
+				ws = rtcm_buffer.ws;
+			}
+			if (rtcm_buffer.crc == 0)
+				staid = input_rtcm_frame(&rtcm_buffer, &frame, rec_staid > 0 ? rec_staid : staid, pending); /* station of the index record */
+		}
+		if (shard->end == UINT64_MAX) output_vrs_data(fVRS, nxyz, vrs_last, &shard->nbyte, NULL); /* end of the archive */
+		engine_free(engine); /* system_exit of the engine, the default engine is selected again */
+		batch_source_close(&src);
+		fclose(fVRS);
+		shard->dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		shard->ok = 1;
+	}
+
+	void engine_pp_batch_rtcm(const char** fnames, int nfile, vdate_t* date, vxyz_t* vxyz, int nxyz, double shard, double warmup, int nthread)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		batch_archive_t ar;
+		std::vector<shard_t> shards;
+		std::vector<std::thread> threads;
+		std::atomic<int> next(0);
+		char fvrs[1024] = { 0 };
+		uint8_t buff[65536];
+		unsigned long numofepoch = 0, numofcrc = 0;
+		uint64_t vrs_bytes = 0, vrs_sum = 1469598103934665603ULL;
+		int i = 0, n = 0, nshard = 0, nfail = 0;
+		if (!batch_archive_open(&ar, fnames, nfile))
+		{
+			printf("no rtcm file\n");
+			return;
+		}
+		const char* fname = ar.names[0].c_str(); /* name of the report */
+		if (shard <= 0.0) shard = 1.0E12; /* one shard, sequential replay of the files */
+		if (!(nshard = index_shards(&ar, date, shard, warmup > 0.0 ? warmup : 0.0, shards)))
+		{
+			batch_archive_close(&ar);
+			return;
+		}
+		if (nthread <= 0) nthread = (int)std::thread::hardware_concurrency();
+		if (nthread <= 0) nthread = 1;
+		if (nthread > nshard) nthread = nshard;
+		for (i = 0; i < nthread; ++i)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				char fname_vrs[1024];
+				for (int k = next++; k < nshard; k = next++)
+				{
+					sprintf(fname_vrs, "vrs.rtcm3.%i", k);
+					process_shard(&ar, date, vxyz, nxyz, &shards[k], fname_vrs);
+				}
+			}));
+		}
+		for (i = 0; i < nthread; ++i) threads[i].join();
+		/* merge the vrs output of the shards in time order */
+		FILE* fVRS = nxyz > 0 ? fopen("vrs.rtcm3", "wb") : NULL;
+		for (i = 0; i < nshard; ++i)
+		{
+			sprintf(fvrs, "vrs.rtcm3.%i", i);
+			FILE* fSHD = fopen(fvrs, "rb");
+			while (fSHD && (n = (int)fread(buff, 1, sizeof(buff), fSHD)) > 0)
+			{
+				for (int j = 0; j < n; ++j)
+				{
+					vrs_sum ^= buff[j];
+					vrs_sum *= 1099511628211ULL;
+				}
+				vrs_bytes += n;
+				if (fVRS) fwrite(buff, 1, n, fVRS);
+			}
+			if (fSHD) fclose(fSHD);
+			remove(fvrs);
+			if (!shards[i].ok) ++nfail;
+			numofepoch += shards[i].numofepoch;
+			numofcrc += shards[i].numofcrc;
+			printf("%s,%4i shard,%12.1f start,%6u epochs,%8llu warm-up frames,%llu vrs bytes,%10.3f s%s\n", fname, i, shards[i].start, shards[i].numofepoch,
+				(unsigned long long)(shards[i].begin - shards[i].first), (unsigned long long)shards[i].nbyte, shards[i].dt, shards[i].ok ? "" : ",failed");
+		}
+		if (fVRS) fclose(fVRS);
+		batch_archive_close(&ar);
+		double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		printf("%s,%4i files,%6u,%4i shards,%4i threads,%4i failed,%10.3f\n", fname, (int)ar.names.size(), numofcrc, nshard, nthread, nfail, dt);
+		printf("%s,%6u epochs,%10.1f epochs/s,%llu vrs bytes,%016llX vrs checksum\n", fname, numofepoch, dt > 0.0 ? numofepoch / dt : 0.0, (unsigned long long)vrs_bytes, (unsigned long long)vrs_sum);
+	}
+
+	/*--------------------------------------------------------------------------
+	  replay of a segment archive (raw data option 2) by its index, only the segment files of the
+	  selected stations are mapped and the frames are read at their offsets in time order (the index
+	  groups the frames of each ingestion worker by batch), before the time window only the station
+	  and ephemeris messages are replayed
+	--------------------------------------------------------------------------*/
+	/* time order of the index records, the records of the same time keep the index order */
+	struct index_time_less
+	{
+		const archive_idx_t* idx;
+		index_time_less(const archive_idx_t* idx) : idx(idx) {}
+		bool operator()(int a, int b) const
+		{
+			return idx[a].sec < idx[b].sec || (idx[a].sec == idx[b].sec && idx[a].ms < idx[b].ms);
+		}
+	};
+
+	void engine_pp_index_rtcm(const char* fname, vdate_t* date, vxyz_t* vxyz, int nxyz, int staid, vdate_t* start, double hours)
+	{
+		int n = 0, m = 0;
+		archive_idx_t* idx = archive_index_load(fname, &n);
+		if (!idx) return;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		uint32_t sec0 = 0, sec1 = 0;
+		if (start && hours > 0.0)
+		{
+			double t = date2gpst(start->year, start->mon, start->day, start->hour);
+			sec0 = (uint32_t)t;
+			sec1 = (uint32_t)(t + hours * 3600.0);
+		}
+		std::vector<int> sel(n + 1);
+		m = archive_index_select(idx, n, staid, 0, sec1, &sel[0]);
+		sel.resize(m);
+		std::stable_sort(sel.begin(), sel.end(), index_time_less(idx));
+		std::map<int, rtcm_replay_t> seg; /* mapped segment file of each station */
+		std::map<int, rtcm_replay_t>::iterator it;
+		char segname[255] = { 0 };
+		FILE* fVRS = nxyz > 0 ? fopen("vrs.rtcm3", "wb") : NULL;
+		std::vector<std::vector<uint8_t> > vrs_last(nxyz);
+		uint64_t vrs_bytes = 0, vrs_sum = 1469598103934665603ULL;
+		rtcm_buff_t rtcm_buffer = { 0 };
+		unsigned long numOfpacket = 0;
+		unsigned long numofmiss = 0;
+		unsigned long numofepoch = 0;
+		double ws = 0.0;
+		set_raw_data_option(0); /* turn off raw data output */
+		set_log_data_option(0); /* turn off log data output */
+		set_replay_time_option(1); /* virtual clock from the data, the output does not depend on the host clock */
+		set_appr_time(date->year, date->mon, date->day, date->hour);
+		for (int i = 0; i < nxyz; ++i)
+			add_vrs_rover_data(i + 1, vxyz[i].xyz);
+		for (int k = 0; k < m; ++k)
+		{
+			const archive_idx_t* rec = idx + sel[k];
+			if ((it = seg.find(rec->staid)) == seg.end())
+			{
+				rtcm_replay_t replay;
+				if (!archive_segment_name(fname, rec->staid, "rtcm3", segname, sizeof(segname))) segname[0] = '\0';
+				rtcm_replay_open(&replay, segname, 0); /* missing segment (no data), its frames are counted */
+				it = seg.insert(std::make_pair((int)rec->staid, replay)).first;
+			}
+			if (!it->second.data || (uint64_t)rec->offset + rec->len > it->second.size)
+			{
+				++numofmiss;
+				continue;
+			}
+			uint8_t* buff = it->second.data + rec->offset;
+			decode_rtcm3_type(&rtcm_buffer, buff, rec->len, 0);
+			if (rtcm_buffer.type != rec->type)
+			{
+				++numofmiss; /* segment does not match the index */
+				continue;
+			}
+			if (rec->sec < sec0)
+			{
+				/* before the window, only the station and ephemeris messages */
+				if (keep_key(&rtcm_buffer)) set_rtcm_data_frame(rec->staid, buff, rec->len, NULL);
+				continue;
+			}
+			if (fabs(rtcm_buffer.ws - ws) > 0.001)
+			{
+				/* new epoch, the vrs of the previous epoch is complete */
+				output_vrs_data(fVRS, nxyz, vrs_last, &vrs_bytes, &vrs_sum);
+				ws = rtcm_buffer.ws;
+				++numofepoch;
+			}
+			set_rtcm_data_frame(rec->staid, buff, rec->len, NULL);
+			++numOfpacket;
+		}
+		output_vrs_data(fVRS, nxyz, vrs_last, &vrs_bytes, &vrs_sum);
+		double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		printf("%s,%6lu,%6lu missing,%4i stations,%6i records\n", fname, numOfpacket, numofmiss, (int)seg.size(), n);
+		printf("%s,%6lu epochs,%10.1f epochs/s,%llu vrs bytes,%016llX vrs checksum\n", fname, numofepoch, dt > 0.0 ? numofepoch / dt : 0.0, (unsigned long long)vrs_bytes, (unsigned long long)vrs_sum);
+		system_exit();
+		set_replay_time_option(0);
+		for (it = seg.begin(); it != seg.end(); ++it)
+			rtcm_replay_close(&it->second);
+		archive_index_free(idx);
+		if (fVRS) fclose(fVRS);
+	}
 	//--------------------------------------------------------------------------
 #pragma warning (default:4996)
 #pragma warning (default:0266)
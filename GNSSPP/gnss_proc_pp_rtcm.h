@@ -18,10 +18,22 @@ extern "C" {
 	{
 		double xyz[3];
 	}vxyz_t;
+	#define BATCH_WARMUP 1800.0 /* default warm-up before each shard (s) */
 	//--------------------------------------------------------------------------
 	/* main function to process the data */
 	void engine_pp_main_rtcm(const char *fname, vdate_t *date, vxyz_t *vxyz, int nxyz);
-	/* configure file to process the data */
+	/* batch reprocessing of a (multi-day) archive in parallel time shards of shard seconds (0: one shard),
+	*  the archive is the rtcm files in time order (hourly files, wildcards * ? in name order) or the index
+	*  files <time>.idx of segment archives (raw data option 2, all records in time order), each shard
+	*  runs on its own engine from warmup seconds before the shard (ephemerides and lock state), nthread
+	*  shards at a time (0: one for each cpu), the vrs output of the shards is merged in time order */
+	void engine_pp_batch_rtcm(const char** fnames, int nfile, vdate_t* date, vxyz_t* vxyz, int nxyz, double shard, double warmup, int nthread);
+	/* replay of a segment archive (raw data option 2) by its index file <time>.idx, station staid (-1: all),
+	*  the hours from start (NULL or hours 0: all), the observations before start are not replayed */
+	void engine_pp_index_rtcm(const char* fname, vdate_t* date, vxyz_t* vxyz, int nxyz, int staid, vdate_t* start, double hours);
+	/* configure file to process the data, rtcm = <file> (one line per file, wildcards or <time>.idx),
+	*  shard = <seconds>, warmup = <seconds>, thread = <n> (batch of several files, wildcards or shards),
+	*  station = <id>, window = <year> <mon> <day> <hour> <hours> (replay of one segment archive) */
 	void engine_pp_main_ini(const char* fname);
 	//--------------------------------------------------------------------------
 